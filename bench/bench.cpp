@@ -0,0 +1,379 @@
+/*
+ * bench - Micro and macro benchmarks of the library on a set of files:
+ * opening a library, building its resource tree, lookups that hit and
+ * miss with numeric and string ids, extraction of single resources (raw,
+ * RT_BITMAP as .bmp, RT_GROUP_ICON as .ico) and of the whole tree.
+ *
+ * Every benchmark is run for a number of samples; a sample repeats the
+ * operation until it has run for at least the minimum time. The report
+ * has the per operation time of the fastest, median and slowest sample,
+ * the operator new calls and bytes per operation (the library's malloc
+ * calls for file and extraction buffers are not counted) and the peak
+ * RSS of the process after each file. read_library opens the library
+ * with a depth limit of 0, which stops before the root directory is
+ * listed: it times reading the file and its headers without the tree.
+ *
+ * Usage: libwres_bench [--json report.json] [--samples n] [--min-time ms] [file or directory...]
+ *
+ * Directories are searched for files, so a generated corpus can be
+ * passed as a whole. Without paths, the files of test/pe are used.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "../wres/winlibrary.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+static std::atomic<size_t> allocation_count { 0 };
+static std::atomic<size_t> allocation_bytes { 0 };
+
+void* operator new(size_t size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+	if(void *p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+struct BenchResult
+{
+	std::string name;
+	size_t operations = 0;
+	double minNs = 0, medianNs = 0, maxNs = 0;
+	double allocations = 0, allocatedBytes = 0;
+	size_t bytes = 0;
+};
+
+struct FileReport
+{
+	std::string path;
+	size_t size = 0;
+	bool valid = false;
+	size_t resources = 0;
+	std::vector<BenchResult> results;
+	long peakRssKb = 0;
+};
+
+struct BenchOptions
+{
+	int samples = 5;
+	double minTimeMs = 50;
+};
+
+static long peak_rss_kb()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+/*
+ * Runs op samples times for at least the minimum time each. op returns
+ * false if the operation failed, which ends the benchmark without a result.
+ */
+static bool run_bench(const BenchOptions& options, const std::string& name, size_t bytes,
+					  const std::function<bool()>& op, std::vector<BenchResult>& results)
+{
+	if(!op())
+	{
+		printf("  %-24s failed\n", name.c_str());
+		return false;
+	}
+
+	BenchResult result;
+	result.name = name;
+	result.bytes = bytes;
+	std::vector<double> sampleNs;
+	size_t allocations = allocation_count.load(), allocated = allocation_bytes.load();
+	for(int s = 0; s < options.samples; s++)
+	{
+		size_t count = 0;
+		auto start = bench_clock::now();
+		double elapsed;
+		do
+		{
+			if(!op())
+				return false;
+			count++;
+			elapsed = std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+		}
+		while(elapsed < options.minTimeMs);
+		sampleNs.push_back(elapsed * 1e6 / count);
+		result.operations += count;
+	}
+	std::sort(sampleNs.begin(), sampleNs.end());
+	result.minNs = sampleNs.front();
+	result.medianNs = sampleNs[sampleNs.size() / 2];
+	result.maxNs = sampleNs.back();
+	result.allocations = (double)(allocation_count.load() - allocations) / result.operations;
+	result.allocatedBytes = (double)(allocation_bytes.load() - allocated) / result.operations;
+
+	printf("  %-24s %12.0f ns/op (min %.0f, max %.0f), %8.1f allocs/op, %10.0f bytes/op\n", name.c_str(),
+		   result.medianNs, result.minNs, result.maxNs, result.allocations, result.allocatedBytes);
+	results.push_back(result);
+	return true;
+}
+
+/*
+ * Looks up the keys in turn, each lookup being one operation. If missing is
+ * set, it replaces the name of every key, so the lookups fail.
+ */
+static bool lookup_bench(const BenchOptions& options, const std::string& name, const wres::WinLibrary& library,
+						 const std::vector<const wres::WinResource*>& keys, const char *missing,
+						 std::vector<BenchResult>& results)
+{
+	if(keys.empty())
+		return false;
+	size_t k = 0;
+	// converted once, so that the string is not counted as an allocation of the lookup
+	const std::string missingName = missing != nullptr ? missing : "";
+	return run_bench(options, name, 0, [&]()
+	{
+		const wres::WinResource *key = keys[k];
+		k = k + 1 == keys.size() ? 0 : k + 1;
+		if(missing != nullptr)
+			return library.findResource(key->type(), missingName, key->language()) == nullptr;
+		return library.findResource(key->type(), key->name(), key->language()) == key;
+	}, results);
+}
+
+static void bench_file(const BenchOptions& options, const std::string& path, const std::string& outdir, FileReport& report)
+{
+	report.path = path;
+	report.size = std::filesystem::file_size(path);
+	printf("%s (%zu bytes)\n", path.c_str(), report.size);
+
+	run_bench(options, "open", report.size, [&]()
+	{
+		wres::WinLibrary library(path);
+		return library.isValid();
+	}, report.results);
+
+	// the depth limit fails the tree before it is built; that status is expected
+	wres::ParseLimits noTree;
+	noTree.maxDepth = 0;
+	run_bench(options, "read_library", report.size, [&]()
+	{
+		wres::WinLibrary library(path, noTree);
+		return library.isValid();
+	}, report.results);
+
+	wres::WinLibrary library(path);
+	report.valid = library.isValid();
+	if(!report.valid)
+	{
+		printf("  not a valid library\n");
+		report.peakRssKb = peak_rss_kb();
+		return;
+	}
+	std::vector<wres::WinResource*> resources = library.collectResources(&library.root());
+	report.resources = resources.size();
+
+	run_bench(options, "build_tree", report.size, [&]()
+	{
+		return library.buildResourceTree(&library.root());
+	}, report.results);
+	// the rebuilt tree has new resources
+	resources = library.collectResources(&library.root());
+
+	// lookups by the ids of the library's own resources, and by the same keys with a missing name
+	const wres::WinLibrary& constLibrary = library;
+	std::vector<const wres::WinResource*> numericKeys, stringKeys;
+	for(auto r : resources)
+	{
+		int32_t id;
+		(parse_int32(r->name().c_str(), &id) ? numericKeys : stringKeys).push_back(r);
+	}
+	lookup_bench(options, "find_numeric_hit", constLibrary, numericKeys, nullptr, report.results);
+	lookup_bench(options, "find_string_hit", constLibrary, stringKeys, nullptr, report.results);
+	lookup_bench(options, "find_numeric_miss", constLibrary, numericKeys, "65535", report.results);
+	lookup_bench(options, "find_string_miss", constLibrary, stringKeys, "WRES_BENCH_MISSING", report.results);
+
+	wres::WinResource *largest = nullptr, *bitmap = nullptr, *groupIcon = nullptr;
+	for(auto r : resources)
+	{
+		if(largest == nullptr || r->size() > largest->size())
+			largest = r;
+		if(bitmap == nullptr && r->type() == "2")
+			bitmap = r;
+		if(groupIcon == nullptr && r->type() == "14")
+			groupIcon = r;
+	}
+	if(largest != nullptr)
+		run_bench(options, "extract_raw", largest->size(), [&]()
+		{
+			return library.extractResource(largest, outdir, true);
+		}, report.results);
+	if(bitmap != nullptr)
+		run_bench(options, "extract_bmp", bitmap->size(), [&]()
+		{
+			return library.extractResource(bitmap, outdir);
+		}, report.results);
+	if(groupIcon != nullptr)
+		run_bench(options, "extract_ico", groupIcon->size(), [&]()
+		{
+			return library.extractResource(groupIcon, outdir);
+		}, report.results);
+
+	size_t treeBytes = 0;
+	for(auto r : resources)
+		treeBytes += r->size();
+	run_bench(options, "extract_tree", treeBytes, [&]()
+	{
+		return library.extractResource(&library.root(), outdir);
+	}, report.results);
+	run_bench(options, "extract_tree_ordered", treeBytes, [&]()
+	{
+		return library.extractResource(&library.root(), outdir, false, true);
+	}, report.results);
+
+	report.peakRssKb = peak_rss_kb();
+	printf("  %zu resources, peak RSS %ld KiB\n", report.resources, report.peakRssKb);
+}
+
+static void write_json_string(FILE *out, const std::string& s)
+{
+	fputc('"', out);
+	for(unsigned char c : s)
+	{
+		if(c == '"' || c == '\\')
+			fprintf(out, "\\%c", c);
+		else if(c < 0x20)
+			fprintf(out, "\\u%04x", c);
+		else
+			fputc(c, out);
+	}
+	fputc('"', out);
+}
+
+static bool write_json(const std::string& path, const BenchOptions& options, const std::vector<FileReport>& reports)
+{
+	FILE *out = fopen(path.c_str(), "w");
+	if(out == nullptr)
+		return false;
+	fprintf(out, "{\n  \"format\": 1,\n  \"samples\": %d,\n  \"min_time_ms\": %g,\n", options.samples, options.minTimeMs);
+#if WRES_IMAGE_CODECS
+	fprintf(out, "  \"image_codecs\": true,\n");
+#else
+	fprintf(out, "  \"image_codecs\": false,\n");
+#endif
+	fprintf(out, "  \"peak_rss_kb\": %ld,\n  \"files\": [", peak_rss_kb());
+	for(size_t f = 0; f < reports.size(); f++)
+	{
+		const FileReport &report = reports[f];
+		fprintf(out, "%s\n    {\n      \"path\": ", f ? "," : "");
+		write_json_string(out, report.path);
+		fprintf(out, ",\n      \"size\": %zu,\n      \"valid\": %s,\n      \"resources\": %zu,\n"
+				"      \"peak_rss_kb\": %ld,\n      \"benchmarks\": [",
+				report.size, report.valid ? "true" : "false", report.resources, report.peakRssKb);
+		for(size_t i = 0; i < report.results.size(); i++)
+		{
+			const BenchResult &r = report.results[i];
+			fprintf(out, "%s\n        { \"name\": ", i ? "," : "");
+			write_json_string(out, r.name);
+			fprintf(out, ", \"operations\": %zu, \"ns_per_op\": { \"min\": %.1f, \"median\": %.1f, \"max\": %.1f }, "
+					"\"allocations_per_op\": %.2f, \"allocated_bytes_per_op\": %.1f, \"bytes\": %zu }",
+					r.operations, r.minNs, r.medianNs, r.maxNs, r.allocations, r.allocatedBytes, r.bytes);
+		}
+		fprintf(out, "\n      ]\n    }");
+	}
+	fprintf(out, "\n  ]\n}\n");
+	return fclose(out) == 0;
+}
+
+int main(int argc, char **argv)
+{
+	BenchOptions options;
+	std::string jsonPath;
+	std::vector<std::string> inputs;
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--json") && i + 1 < argc)
+			jsonPath = argv[++i];
+		else if(!strcmp(argv[i], "--samples") && i + 1 < argc)
+			options.samples = std::max(1, atoi(argv[++i]));
+		else if(!strcmp(argv[i], "--min-time") && i + 1 < argc)
+			options.minTimeMs = std::max(0.0, atof(argv[++i]));
+		else
+			inputs.push_back(argv[i]);
+	}
+	if(inputs.empty())
+		inputs.push_back("../../test/pe");
+
+	std::vector<std::string> paths;
+	for(auto &input : inputs)
+	{
+		// common/ defines is_directory() as a macro, so test the status type
+		std::error_code error;
+		std::filesystem::file_type type = std::filesystem::status(input, error).type();
+		if(type == std::filesystem::file_type::directory)
+		{
+			std::vector<std::string> found;
+			for(auto &entry : std::filesystem::recursive_directory_iterator(input, error))
+				if(entry.is_regular_file())
+					found.push_back(entry.path().string());
+			std::sort(found.begin(), found.end());
+			paths.insert(paths.end(), found.begin(), found.end());
+		}
+		else if(type == std::filesystem::file_type::regular)
+			paths.push_back(input);
+		else
+			printf("Skipping %s: not a file or directory\n", input.c_str());
+	}
+	if(paths.empty())
+	{
+		printf("No input files\n");
+		return 1;
+	}
+
+	std::filesystem::path outdir = std::filesystem::temp_directory_path() /
+		("libwres_bench_" + std::to_string(getpid()));
+	std::filesystem::create_directories(outdir);
+
+	std::vector<FileReport> reports(paths.size());
+	for(size_t i = 0; i < paths.size(); i++)
+	{
+		bench_file(options, paths[i], outdir.string(), reports[i]);
+		// keep the extracted files of one library from piling up
+		std::error_code error;
+		std::filesystem::remove_all(outdir, error);
+		std::filesystem::create_directories(outdir, error);
+	}
+	std::error_code error;
+	std::filesystem::remove_all(outdir, error);
+
+	printf("Peak RSS %ld KiB\n", peak_rss_kb());
+	if(!jsonPath.empty())
+	{
+		if(!write_json(jsonPath, options, reports))
+		{
+			printf("Failed to write %s\n", jsonPath.c_str());
+			return 1;
+		}
+		printf("Report written to %s\n", jsonPath.c_str());
+	}
+	return 0;
+}
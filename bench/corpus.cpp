@@ -0,0 +1,617 @@
+#include "corpus.h"
+#include <algorithm>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+
+#define RT_BITMAP_ID        2
+#define RT_ICON_ID          3
+#define RT_STRING_ID        6
+#define RT_RCDATA_ID        10
+#define RT_GROUP_ICON_ID    14
+#define LANGUAGE_FIRST      1033
+
+#define PACKTHEM_VERSION    4
+#define TMT_COLOR           204
+#define TMT_TEXTCOLOR       3803
+
+#define FILE_ALIGNMENT      0x200
+#define SECTION_ALIGNMENT   0x1000
+#define HEADERS_SIZE        0x200
+#define RSRC_RVA            0x1000
+
+/* A type, name or language of the tree: a UTF-16 string if name is set, a number otherwise */
+struct ResourceId
+{
+	std::u16string name;
+	uint16_t number = 0;
+
+	ResourceId(uint16_t n) : number(n) {}
+	ResourceId(const std::string& s) : name(s.begin(), s.end()) {}
+	ResourceId(const std::u16string& s) : name(s) {}
+
+	/* Directory order: names first, sorted, then numbers in ascending order */
+	bool operator<(const ResourceId& other) const
+	{
+		if(name.empty() != other.name.empty())
+			return !name.empty();
+		return name.empty() ? number < other.number : name < other.name;
+	}
+};
+
+typedef std::map<uint16_t, size_t> LanguageMap;
+typedef std::map<ResourceId, LanguageMap> NameMap;
+typedef std::map<ResourceId, NameMap> TypeMap;
+
+static void put16(std::vector<uint8_t>& v, size_t at, uint16_t x)
+{
+	v[at] = (uint8_t)x;
+	v[at + 1] = (uint8_t)(x >> 8);
+}
+
+static void put32(std::vector<uint8_t>& v, size_t at, uint32_t x)
+{
+	put16(v, at, (uint16_t)x);
+	put16(v, at + 2, (uint16_t)(x >> 16));
+}
+
+static void put64(std::vector<uint8_t>& v, size_t at, uint64_t x)
+{
+	put32(v, at, (uint32_t)x);
+	put32(v, at + 4, (uint32_t)(x >> 32));
+}
+
+static void append_be32(std::vector<uint8_t>& v, uint32_t x)
+{
+	for(int i = 3; i >= 0; i--)
+		v.push_back((uint8_t)(x >> (8 * i)));
+}
+
+static size_t align_up(size_t x, size_t alignment)
+{
+	return (x + alignment - 1) / alignment * alignment;
+}
+
+static uint32_t next_random(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static uint32_t crc32(const uint8_t *data, size_t size)
+{
+	static uint32_t table[256];
+	if(table[1] == 0)
+	{
+		for(uint32_t n = 0; n < 256; n++)
+		{
+			uint32_t c = n;
+			for(int k = 0; k < 8; k++)
+				c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+	}
+	uint32_t crc = 0xFFFFFFFF;
+	for(size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFF;
+}
+
+static void append_png_chunk(std::vector<uint8_t>& png, const char *type, const std::vector<uint8_t>& data)
+{
+	append_be32(png, (uint32_t)data.size());
+	size_t start = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data.begin(), data.end());
+	append_be32(png, crc32(png.data() + start, png.size() - start));
+}
+
+/* An RGBA PNG whose image data is stored without compression */
+static std::vector<uint8_t> make_png(uint32_t width, uint32_t height, uint32_t& random)
+{
+	std::vector<uint8_t> raw;
+	for(uint32_t y = 0; y < height; y++)
+	{
+		raw.push_back(0);
+		uint32_t color = next_random(random);
+		for(uint32_t x = 0; x < width * 4; x++)
+			raw.push_back((uint8_t)(color >> (8 * (x & 3))) ^ (uint8_t)x);
+	}
+
+	std::vector<uint8_t> zlib = { 0x78, 0x01 };
+	for(size_t pos = 0; pos < raw.size(); )
+	{
+		size_t length = std::min<size_t>(raw.size() - pos, 0xFFFF);
+		zlib.push_back(pos + length == raw.size() ? 1 : 0);
+		zlib.push_back((uint8_t)length);
+		zlib.push_back((uint8_t)(length >> 8));
+		zlib.push_back((uint8_t)~length);
+		zlib.push_back((uint8_t)(~length >> 8));
+		zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + length);
+		pos += length;
+	}
+	uint32_t a = 1, b = 0;
+	for(uint8_t c : raw)
+	{
+		a = (a + c) % 65521;
+		b = (b + a) % 65521;
+	}
+	append_be32(zlib, (b << 16) | a);
+
+	std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<uint8_t> header;
+	append_be32(header, width);
+	append_be32(header, height);
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+	append_png_chunk(png, "IHDR", header);
+	append_png_chunk(png, "IDAT", zlib);
+	append_png_chunk(png, "IEND", std::vector<uint8_t>());
+	return png;
+}
+
+/* Size of a 32 bit DIB, with the AND mask of an icon image if icon is set */
+static size_t dib_size(uint32_t width, uint32_t height, bool icon)
+{
+	return 40 + (size_t)width * height * 4 + (icon ? (size_t)(width + 31) / 32 * 4 * height : 0);
+}
+
+static std::vector<uint8_t> make_dib(uint32_t width, uint32_t height, bool icon, uint32_t& random)
+{
+	std::vector<uint8_t> dib(dib_size(width, height, icon), 0);
+	put32(dib, 0, 40);
+	put32(dib, 4, width);
+	// icon images declare the height of the color and mask bitmaps together
+	put32(dib, 8, icon ? height * 2 : height);
+	put16(dib, 12, 1);
+	put16(dib, 14, 32);
+	put32(dib, 20, width * height * 4);
+	for(size_t i = 40; i < 40 + (size_t)width * height * 4; i += 4)
+		put32(dib, i, next_random(random) | 0xFF000000);
+	return dib;
+}
+
+/* RT_STRING block: 16 length prefixed UTF-16 strings, some of them empty */
+static std::vector<uint8_t> make_string_block(uint16_t block, uint16_t language)
+{
+	std::vector<uint8_t> data;
+	for(uint32_t i = 0; i < 16; i++)
+	{
+		uint32_t id = (uint32_t)(block - 1) * 16 + i;
+		std::string text = i % 4 == 3 ? std::string() : "String " + std::to_string(id) + " (" + std::to_string(language) + ")";
+		data.push_back((uint8_t)text.size());
+		data.push_back((uint8_t)(text.size() >> 8));
+		for(char c : text)
+		{
+			data.push_back((uint8_t)c);
+			data.push_back(0);
+		}
+	}
+	return data;
+}
+
+/* GRPICONDIR of a 16x16 and a 32x32 image with the ids firstIcon and firstIcon + 1 */
+static std::vector<uint8_t> make_group_icon(uint16_t firstIcon)
+{
+	std::vector<uint8_t> group(6 + 2 * 14, 0);
+	put16(group, 2, 1);
+	put16(group, 4, 2);
+	for(int i = 0; i < 2; i++)
+	{
+		uint32_t size = i == 0 ? 16 : 32;
+		size_t entry = 6 + i * 14;
+		group[entry] = (uint8_t)size;
+		group[entry + 1] = (uint8_t)size;
+		put16(group, entry + 4, 1);
+		put16(group, entry + 6, 32);
+		put32(group, entry + 8, (uint32_t)dib_size(size, size, true));
+		put16(group, entry + 12, (uint16_t)(firstIcon + i));
+	}
+	return group;
+}
+
+/* Appends text as null terminated UTF-16LE, padded with zeros to a multiple of alignment */
+static void append_utf16(std::vector<uint8_t>& v, const std::string& text, size_t alignment)
+{
+	for(char c : text)
+	{
+		v.push_back((uint8_t)c);
+		v.push_back(0);
+	}
+	v.insert(v.end(), align_up(text.size() * 2 + 2, alignment) - text.size() * 2, 0);
+}
+
+static const char *const theme_classes[] =
+{
+	"globals", "documentation", "Button", "Edit", "ListView", "TreeView", "Window", "Explorer::Button"
+};
+
+/* CMAP: the class names, each padded to 8 bytes */
+static std::vector<uint8_t> make_class_map()
+{
+	std::vector<uint8_t> cmap;
+	for(const char *name : theme_classes)
+		append_utf16(cmap, name, 8);
+	return cmap;
+}
+
+/* BCMAP: a count and the base class of each class; Explorer::Button derives from Button */
+static std::vector<uint8_t> make_base_class_map()
+{
+	const size_t count = sizeof(theme_classes) / sizeof(theme_classes[0]);
+	std::vector<uint8_t> bcmap(4 + 4 * count, 0xFF);
+	put32(bcmap, 0, (uint32_t)count);
+	put32(bcmap, 4 + 4 * (count - 1), 2);
+	return bcmap;
+}
+
+/* VMAP: the variant, size and color names, each a length in characters and the text padded to 4 bytes */
+static std::vector<uint8_t> make_variant_map()
+{
+	std::vector<uint8_t> vmap;
+	for(const char *name : { "Normal", "NormalSize", "NormalColor" })
+	{
+		vmap.resize(vmap.size() + 4);
+		put32(vmap, vmap.size() - 4, (uint32_t)strlen(name) + 1);
+		append_utf16(vmap, name, 4);
+	}
+	return vmap;
+}
+
+/* VARIANT: one text color property per class, a 32 byte record and the value padded to 8 bytes */
+static std::vector<uint8_t> make_variant(uint32_t& random)
+{
+	std::vector<uint8_t> variant;
+	for(uint32_t c = 0; c < sizeof(theme_classes) / sizeof(theme_classes[0]); c++)
+	{
+		size_t at = variant.size();
+		variant.resize(at + 40, 0);
+		put32(variant, at, TMT_TEXTCOLOR);
+		put32(variant, at + 4, TMT_COLOR);
+		put32(variant, at + 8, c);
+		put32(variant, at + 28, 4);
+		put32(variant, at + 32, next_random(random) & 0xFFFFFF);
+	}
+	return variant;
+}
+
+/* A name that is unique for index and at least length characters long */
+static std::u16string make_name(size_t index, size_t length)
+{
+	std::string digits = "R" + std::to_string(index);
+	std::u16string name(digits.begin(), digits.end());
+	while(name.size() < length)
+		name.push_back((char16_t)('A' + (name.size() + index) % 26));
+	return name;
+}
+
+/*
+ * Lays out the resource section: all directories first, then the data
+ * entries, the names and the data itself, as linkers do.
+ */
+static std::vector<uint8_t> build_section(const TypeMap& types, const std::vector<std::vector<uint8_t>>& blobs)
+{
+	auto directory_size = [](size_t entries) { return 16 + 8 * entries; };
+	size_t directories = directory_size(types.size()), dataEntries = 0;
+	for(auto &type : types)
+	{
+		directories += directory_size(type.second.size());
+		for(auto &name : type.second)
+		{
+			directories += directory_size(name.second.size());
+			dataEntries += name.second.size();
+		}
+	}
+	size_t namesAt = directories + 16 * dataEntries, namesSize = 0;
+	auto count_name = [&](const ResourceId& id) { if(!id.name.empty()) namesSize += 2 + 2 * id.name.size(); };
+	for(auto &type : types)
+	{
+		count_name(type.first);
+		for(auto &name : type.second)
+			count_name(name.first);
+	}
+	size_t dataAt = align_up(namesAt + namesSize, 8), dataSize = 0;
+	for(auto &blob : blobs)
+		dataSize += align_up(blob.size(), 8);
+
+	std::vector<uint8_t> section(dataAt + dataSize, 0);
+	size_t nextDirectory = 0, nextEntry = directories, nextName = namesAt, nextData = dataAt;
+	auto write_directory = [&](size_t entries, size_t named)
+	{
+		size_t at = nextDirectory;
+		// linkers stamp the directories; readers must not take it for a data entry
+		put32(section, at + 4, 0x5F5E1000);
+		put16(section, at + 12, (uint16_t)named);
+		put16(section, at + 14, (uint16_t)(entries - named));
+		nextDirectory += directory_size(entries);
+		return at + 16;
+	};
+	auto write_id = [&](size_t at, const ResourceId& id)
+	{
+		if(id.name.empty())
+		{
+			put32(section, at, id.number);
+			return;
+		}
+		put32(section, at, 0x80000000 | (uint32_t)nextName);
+		put16(section, nextName, (uint16_t)id.name.size());
+		for(size_t i = 0; i < id.name.size(); i++)
+			put16(section, nextName + 2 + 2 * i, id.name[i]);
+		nextName += 2 + 2 * id.name.size();
+	};
+	auto named_count = [](const auto& map)
+	{
+		size_t named = 0;
+		for(auto &item : map)
+			named += !item.first.name.empty();
+		return named;
+	};
+
+	// directories are written breadth first, so the offsets of the children are known in advance
+	size_t typeEntry = write_directory(types.size(), named_count(types));
+	size_t childDirectory = directory_size(types.size());
+	for(auto &type : types)
+	{
+		write_id(typeEntry, type.first);
+		put32(section, typeEntry + 4, 0x80000000 | (uint32_t)childDirectory);
+		typeEntry += 8;
+		childDirectory += directory_size(type.second.size());
+	}
+	for(auto &type : types)
+	{
+		size_t nameEntry = write_directory(type.second.size(), named_count(type.second));
+		for(auto &name : type.second)
+		{
+			write_id(nameEntry, name.first);
+			put32(section, nameEntry + 4, 0x80000000 | (uint32_t)childDirectory);
+			nameEntry += 8;
+			childDirectory += directory_size(name.second.size());
+		}
+	}
+	for(auto &type : types)
+	{
+		for(auto &name : type.second)
+		{
+			size_t languageEntry = write_directory(name.second.size(), 0);
+			for(auto &language : name.second)
+			{
+				const std::vector<uint8_t> &blob = blobs[language.second];
+				put32(section, languageEntry, language.first);
+				put32(section, languageEntry + 4, (uint32_t)nextEntry);
+				languageEntry += 8;
+				put32(section, nextEntry, (uint32_t)(RSRC_RVA + nextData));
+				put32(section, nextEntry + 4, (uint32_t)blob.size());
+				nextEntry += 16;
+				std::copy(blob.begin(), blob.end(), section.begin() + nextData);
+				nextData += align_up(blob.size(), 8);
+			}
+		}
+	}
+	return section;
+}
+
+/* Wraps the resource section into a DLL with no code */
+static std::vector<uint8_t> build_image(const std::vector<uint8_t>& section, bool pe32Plus)
+{
+	size_t rawSize = align_up(section.size(), FILE_ALIGNMENT);
+	std::vector<uint8_t> image(HEADERS_SIZE + rawSize, 0);
+
+	// DOS header, directly followed by the NT headers
+	put16(image, 0, 0x5A4D);
+	put16(image, 2, 0x90);
+	put16(image, 4, 3);
+	put16(image, 8, 4);
+	put16(image, 12, 0xFFFF);
+	put16(image, 16, 0xB8);
+	put16(image, 24, 0x40);
+	put32(image, 60, 0x40);
+
+	size_t pe = 0x40;
+	put32(image, pe, 0x00004550);
+	size_t optionalSize = pe32Plus ? 240 : 224;
+	put16(image, pe + 4, pe32Plus ? 0x8664 : 0x14C);
+	put16(image, pe + 6, 1);
+	put16(image, pe + 20, (uint16_t)optionalSize);
+	put16(image, pe + 22, pe32Plus ? 0x2022 : 0x2102);
+
+	size_t optional = pe + 24;
+	size_t imageSize = align_up(RSRC_RVA + section.size(), SECTION_ALIGNMENT);
+	put16(image, optional, pe32Plus ? 0x20B : 0x10B);
+	image[optional + 2] = 14;
+	put32(image, optional + 8, (uint32_t)rawSize);
+	if(pe32Plus)
+		put64(image, optional + 24, 0x180000000ULL);
+	else
+		put32(image, optional + 28, 0x10000000);
+	put32(image, optional + 32, SECTION_ALIGNMENT);
+	put32(image, optional + 36, FILE_ALIGNMENT);
+	put16(image, optional + 40, 6);
+	put16(image, optional + 48, 6);
+	put32(image, optional + 56, (uint32_t)imageSize);
+	put32(image, optional + 60, HEADERS_SIZE);
+	put16(image, optional + 68, 2);
+	put16(image, optional + 70, 0x140);
+	size_t directories = optional + (pe32Plus ? 112 : 96);
+	put32(image, directories - 4, 16);
+	// the resource directory is the third entry
+	put32(image, directories + 16, RSRC_RVA);
+	put32(image, directories + 20, (uint32_t)section.size());
+
+	size_t header = optional + optionalSize;
+	memcpy(&image[header], ".rsrc", 5);
+	put32(image, header + 8, (uint32_t)section.size());
+	put32(image, header + 12, RSRC_RVA);
+	put32(image, header + 16, (uint32_t)rawSize);
+	put32(image, header + 20, HEADERS_SIZE);
+	put32(image, header + 36, 0x40000040);
+
+	std::copy(section.begin(), section.end(), image.begin() + HEADERS_SIZE);
+	return image;
+}
+
+std::vector<uint8_t> generate_library(const CorpusSpec& spec)
+{
+	TypeMap types;
+	std::vector<std::vector<uint8_t>> blobs;
+	uint32_t random = spec.seed ? spec.seed : 1;
+	auto add = [&](const ResourceId& type, const ResourceId& name, uint16_t language, std::vector<uint8_t> data)
+	{
+		types[type][name][language] = blobs.size();
+		blobs.push_back(std::move(data));
+	};
+
+	ResourceId rcdataType = spec.theme ? ResourceId("STREAM") : ResourceId(RT_RCDATA_ID);
+	ResourceId pngType = spec.theme ? ResourceId("IMAGE") : ResourceId("PNG");
+	size_t counters[5] = { 0 };
+	uint32_t nextIcon = 1;
+	for(size_t i = 0; i < spec.resources && !spec.mix.empty(); i++)
+	{
+		CorpusPayload kind = spec.mix[i % spec.mix.size()];
+		// icon images have 16 bit ids too; groups that do not fit become raw data
+		if(kind == CorpusPayload::Icons && nextIcon + 2 > 0x10000)
+			kind = CorpusPayload::RCData;
+		size_t index = ++counters[(int)kind];
+		bool numeric = kind == CorpusPayload::Strings || spec.nameLength == 0;
+		// numbers are 16 bit as well, names take over past them
+		ResourceId name = numeric && index <= 0xFFFF ? ResourceId((uint16_t)index)
+		                                             : ResourceId(make_name(index, spec.nameLength));
+		if(kind == CorpusPayload::Strings && index > 0xFFFF)
+			continue;
+
+		for(unsigned l = 0; l < std::max(1u, spec.languages); l++)
+		{
+			uint16_t language = (uint16_t)(LANGUAGE_FIRST + l);
+			switch(kind)
+			{
+				case CorpusPayload::RCData:
+				{
+					std::vector<uint8_t> data(spec.payloadSize);
+					for(size_t b = 0; b < data.size(); b += 4)
+					{
+						uint32_t r = next_random(random);
+						memcpy(&data[b], &r, std::min<size_t>(4, data.size() - b));
+					}
+					add(rcdataType, name, language, std::move(data));
+					break;
+				}
+				case CorpusPayload::PNG:
+				{
+					uint32_t size = 8 + next_random(random) % 25;
+					add(pngType, name, language, make_png(size, size, random));
+					break;
+				}
+				case CorpusPayload::DIB:
+				{
+					uint32_t size = 8 + next_random(random) % 25;
+					add(ResourceId(RT_BITMAP_ID), name, language, make_dib(size, size, false, random));
+					break;
+				}
+				case CorpusPayload::Strings:
+					add(ResourceId(RT_STRING_ID), name, language, make_string_block((uint16_t)index, language));
+					break;
+				case CorpusPayload::Icons:
+					add(ResourceId(RT_ICON_ID), ResourceId((uint16_t)nextIcon), language, make_dib(16, 16, true, random));
+					add(ResourceId(RT_ICON_ID), ResourceId((uint16_t)(nextIcon + 1)), language, make_dib(32, 32, true, random));
+					add(ResourceId(RT_GROUP_ICON_ID), name, language, make_group_icon((uint16_t)nextIcon));
+					break;
+			}
+		}
+		if(kind == CorpusPayload::Icons)
+			nextIcon += 2;
+	}
+	if(spec.theme)
+	{
+		// the resources ThemeLibrary parses when opening a theme
+		add(ResourceId("PACKTHEM_VERSION"), ResourceId(1), 0, { PACKTHEM_VERSION, 0 });
+		add(ResourceId("CMAP"), ResourceId("CMAP"), 0, make_class_map());
+		add(ResourceId("BCMAP"), ResourceId("BCMAP"), 0, make_base_class_map());
+		add(ResourceId("VMAP"), ResourceId("VMAP"), 0, make_variant_map());
+		add(ResourceId("VARIANT"), ResourceId("NORMAL"), 0, make_variant(random));
+	}
+	return build_image(build_section(types, blobs), spec.pe32Plus);
+}
+
+bool write_library(const std::string& path, const CorpusSpec& spec)
+{
+	std::vector<uint8_t> image = generate_library(spec);
+	FILE *out = fopen(path.c_str(), "wb");
+	if(out == nullptr)
+		return false;
+	bool ok = fwrite(image.data(), 1, image.size(), out) == image.size();
+	return fclose(out) == 0 && ok;
+}
+
+bool parse_payload_mix(const std::string& list, std::vector<CorpusPayload>& mix)
+{
+	static const std::pair<const char*, CorpusPayload> names[] = {
+		{ "rcdata", CorpusPayload::RCData }, { "png", CorpusPayload::PNG }, { "dib", CorpusPayload::DIB },
+		{ "strings", CorpusPayload::Strings }, { "icons", CorpusPayload::Icons }
+	};
+	mix.clear();
+	size_t start = 0;
+	while(start <= list.size())
+	{
+		size_t end = list.find(',', start);
+		if(end == std::string::npos)
+			end = list.size();
+		std::string item = list.substr(start, end - start);
+		bool found = false;
+		for(auto &name : names)
+		{
+			if(item == name.first)
+			{
+				mix.push_back(name.second);
+				found = true;
+			}
+		}
+		if(!found)
+			return false;
+		start = end + 1;
+	}
+	return !mix.empty();
+}
+
+std::vector<std::pair<std::string, CorpusSpec>> standard_corpus()
+{
+	std::vector<std::pair<std::string, CorpusSpec>> corpus;
+	CorpusSpec spec;
+	corpus.push_back({ "pe32_1k.dll", spec });
+
+	spec.pe32Plus = true;
+	spec.resources = 10000;
+	corpus.push_back({ "pe32plus_10k.dll", spec });
+
+	spec.resources = 100000;
+	spec.payloadSize = 64;
+	spec.mix = { CorpusPayload::RCData, CorpusPayload::Strings };
+	corpus.push_back({ "pe32plus_100k.dll", spec });
+
+	spec = CorpusSpec();
+	spec.resources = 500;
+	spec.languages = 64;
+	spec.mix = { CorpusPayload::RCData, CorpusPayload::PNG, CorpusPayload::Strings };
+	corpus.push_back({ "fanout_64.dll", spec });
+
+	spec = CorpusSpec();
+	spec.resources = 2000;
+	// longer names are cut by the library and do not fit in file names when extracted
+	spec.nameLength = 200;
+	spec.mix = { CorpusPayload::RCData, CorpusPayload::PNG, CorpusPayload::DIB, CorpusPayload::Icons };
+	corpus.push_back({ "long_names.dll", spec });
+
+	spec = CorpusSpec();
+	spec.pe32Plus = true;
+	spec.resources = 100;
+	spec.payloadSize = 1 << 20;
+	spec.mix = { CorpusPayload::RCData };
+	corpus.push_back({ "section_100mb.dll", spec });
+
+	spec = CorpusSpec();
+	spec.theme = true;
+	spec.resources = 2000;
+	spec.nameLength = 24;
+	spec.mix = { CorpusPayload::PNG, CorpusPayload::RCData, CorpusPayload::Strings };
+	corpus.push_back({ "synthetic.msstyles", spec });
+	return corpus;
+}
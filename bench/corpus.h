@@ -0,0 +1,57 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Kinds of resources a synthetic library is made of */
+enum class CorpusPayload
+{
+	RCData,     /* RT_RCDATA, or "STREAM" in themes: payloadSize bytes of noise */
+	PNG,        /* "PNG", or "IMAGE" in themes: small RGBA PNG images */
+	DIB,        /* RT_BITMAP: 32 bit DIBs */
+	Strings,    /* RT_STRING: blocks of 16 strings */
+	Icons       /* RT_GROUP_ICON with a 16x16 and a 32x32 RT_ICON image each */
+};
+
+/*
+ * Describes a synthetic library. resources is the number of names that are
+ * created, spread over the kinds in mix in turn; each name gets languages
+ * languages. Names are numeric, or if nameLength is set, UTF-16 strings of
+ * that many characters (string tables and icon images always use numbers).
+ * A theme uses the string types of an msstyles file and gets the resources
+ * ThemeLibrary needs: PACKTHEM_VERSION, a CMAP and BCMAP of a few classes,
+ * a VMAP and a NORMAL VARIANT with a text color for each class.
+ */
+struct CorpusSpec
+{
+	bool pe32Plus = false;
+	bool theme = false;
+	size_t resources = 1000;
+	unsigned languages = 1;
+	size_t nameLength = 0;
+	size_t payloadSize = 256;
+	std::vector<CorpusPayload> mix = { CorpusPayload::RCData, CorpusPayload::PNG, CorpusPayload::DIB,
+	                                   CorpusPayload::Strings, CorpusPayload::Icons };
+	uint32_t seed = 1;
+};
+
+/*
+ * Returns a PE32 or PE32+ DLL with a single .rsrc section holding the
+ * resources of spec. The output only depends on spec.
+ */
+std::vector<uint8_t> generate_library(const CorpusSpec& spec);
+bool write_library(const std::string& path, const CorpusSpec& spec);
+
+/* Parses a comma separated list of rcdata, png, dib, strings and icons */
+bool parse_payload_mix(const std::string& list, std::vector<CorpusPayload>& mix);
+
+/*
+ * The libraries written by libwres_gencorpus --corpus: resource counts from
+ * 1k to 100k, language fan-out, long names, a 100 MB section and a theme.
+ */
+std::vector<std::pair<std::string, CorpusSpec>> standard_corpus();
+
+#endif // CORPUS_H
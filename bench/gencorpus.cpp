@@ -0,0 +1,101 @@
+/*
+ * gencorpus - Writes synthetic PE libraries for benchmarks and stress
+ * tests, so that scaling can be measured without shipping large files.
+ *
+ * Usage: libwres_gencorpus --corpus directory
+ *        libwres_gencorpus [options] output
+ *
+ * --corpus writes the standard set of libraries (see standard_corpus())
+ * into the directory. Otherwise a single library is written:
+ *
+ *   --pe32plus           PE32+ instead of PE32
+ *   --theme              an msstyles theme: IMAGE and STREAM types, class and variant maps
+ *   --resources n        number of names (1000)
+ *   --languages n        languages per name (1)
+ *   --name-length n      UTF-16 names of n characters instead of numbers
+ *   --payload-size n     bytes of each raw data resource (256)
+ *   --mix list           comma separated rcdata, png, dib, strings, icons (all)
+ *   --seed n             seed of the generated content (1)
+ */
+
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "corpus.h"
+
+static void usage()
+{
+	printf("Usage: libwres_gencorpus --corpus directory\n"
+		   "       libwres_gencorpus [--pe32plus] [--theme] [--resources n] [--languages n] [--name-length n]\n"
+		   "                         [--payload-size n] [--mix rcdata,png,dib,strings,icons] [--seed n] output\n");
+}
+
+int main(int argc, char **argv)
+{
+	CorpusSpec spec;
+	std::string corpus, output;
+	for(int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if(!strcmp(argv[i], "--corpus") && hasValue)
+			corpus = argv[++i];
+		else if(!strcmp(argv[i], "--pe32plus"))
+			spec.pe32Plus = true;
+		else if(!strcmp(argv[i], "--theme"))
+			spec.theme = true;
+		else if(!strcmp(argv[i], "--resources") && hasValue)
+			spec.resources = strtoul(argv[++i], nullptr, 10);
+		else if(!strcmp(argv[i], "--languages") && hasValue)
+			spec.languages = strtoul(argv[++i], nullptr, 10);
+		else if(!strcmp(argv[i], "--name-length") && hasValue)
+			spec.nameLength = strtoul(argv[++i], nullptr, 10);
+		else if(!strcmp(argv[i], "--payload-size") && hasValue)
+			spec.payloadSize = strtoul(argv[++i], nullptr, 10);
+		else if(!strcmp(argv[i], "--seed") && hasValue)
+			spec.seed = strtoul(argv[++i], nullptr, 10);
+		else if(!strcmp(argv[i], "--mix") && hasValue)
+		{
+			if(!parse_payload_mix(argv[++i], spec.mix))
+			{
+				printf("Invalid payload mix: %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if(argv[i][0] != '-' && output.empty())
+			output = argv[i];
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+
+	if(!corpus.empty())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(corpus, error);
+		for(auto &library : standard_corpus())
+		{
+			std::string path = (std::filesystem::path(corpus) / library.first).string();
+			if(!write_library(path, library.second))
+			{
+				printf("Failed to write %s\n", path.c_str());
+				return 1;
+			}
+			printf("%s (%ju bytes)\n", path.c_str(), (uintmax_t)std::filesystem::file_size(path, error));
+		}
+		return 0;
+	}
+	if(output.empty())
+	{
+		usage();
+		return 1;
+	}
+	if(!write_library(output, spec))
+	{
+		printf("Failed to write %s\n", output.c_str());
+		return 1;
+	}
+	return 0;
+}
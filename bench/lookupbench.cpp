@@ -0,0 +1,80 @@
+/*
+ * lookupbench - Measures resource lookups per second on one shared
+ * WinLibrary as the number of reader threads grows. The readers only use
+ * the const API, without any locking.
+ *
+ * Usage: libwres_lookupbench [library] [lookups per thread] [max threads]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "../wres/winlibrary.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+struct LookupKey
+{
+	std::string type, name, language;
+	const wres::WinResource *expected;
+};
+
+int main(int argc, char **argv)
+{
+	std::string path = argc > 1 ? argv[1] : "../../test/pe/aero11_seven.msstyles";
+	size_t lookups = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200000;
+	unsigned maxThreads = argc > 3 ? atoi(argv[3]) : std::max(8u, std::thread::hardware_concurrency());
+
+	const wres::WinLibrary library(path);
+	if(!library.isValid())
+	{
+		printf("Failed to open %s\n", path.c_str());
+		return 1;
+	}
+
+	std::vector<LookupKey> keys;
+	for(auto r : library.collectResources(&library.root()))
+		keys.push_back({ r->type(), r->name(), r->language(), r });
+	printf("%zu resources, %zu lookups per thread, %u hardware threads\n", keys.size(), lookups,
+		   std::thread::hardware_concurrency());
+
+	double single = 0;
+	size_t failures = 0;
+	for(unsigned threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		std::atomic<size_t> misses { 0 };
+		std::atomic<bool> go { false };
+		std::vector<std::thread> readers;
+		for(unsigned t = 0; t < threads; t++)
+		{
+			readers.emplace_back([&, t]()
+			{
+				while(!go.load(std::memory_order_acquire))
+					std::this_thread::yield();
+				size_t local = 0;
+				// every thread walks the keys from a different starting point
+				for(size_t i = 0, k = t * 7919 % keys.size(); i < lookups; i++, k = k + 1 == keys.size() ? 0 : k + 1)
+				{
+					const LookupKey &key = keys[k];
+					if(library.findResource(key.type, key.name, key.language) != key.expected)
+						local++;
+				}
+				misses += local;
+			});
+		}
+		auto start = bench_clock::now();
+		go.store(true, std::memory_order_release);
+		for(auto &reader : readers)
+			reader.join();
+		double seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+		double rate = threads * lookups / seconds;
+		if(threads == 1)
+			single = rate;
+		failures += misses;
+		printf("%3u threads: %12.0f lookups/s, %5.2fx of one thread (%3.0f%% efficiency)\n", threads, rate,
+			   rate / single, 100 * rate / (single * threads));
+	}
+	printf("%zu failed lookups\n", failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+/*
+ * pngbench - Compares the built-in PNG decoder against libpng on the
+ * IMAGE resources of an msstyles theme.
+ *
+ * Usage: libwres_pngbench [theme.msstyles] [iterations]
+ */
+
+#include <chrono>
+#include <string.h>
+#include <png.h>
+#include "../wres/winlibrary.h"
+#include "../wres/imageinfo.h"
+#include "../wres/pngdecoder.h"
+#include "../wres/threadpool.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+static double elapsed_ms(bench_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+	std::string path = argc > 1 ? argv[1] : "../../test/pe/aero11_seven.msstyles";
+	int iterations = argc > 2 ? atoi(argv[2]) : 10;
+
+	wres::WinLibrary theme(path);
+	if(!theme.isValid())
+	{
+		printf("Failed to open %s\n", path.c_str());
+		return 1;
+	}
+
+	wres::ImageIndex index;
+	index.build(theme, theme.findResource(std::string("IMAGE"), std::string(""), std::string("")));
+
+	std::vector<wres::PngDecodeJob> jobs;
+	std::vector<std::vector<uint8_t>> ours, reference;
+	size_t pixels = 0, compressed = 0;
+	for(auto &entry : index.entries())
+	{
+		if(entry.info.format != wres::ContentType::PNG)
+			continue;
+		wres::PngDecodeJob job;
+		job.data = (const uint8_t*)entry.resource->offset();
+		job.size = entry.resource->size();
+		job.output.width = entry.info.width;
+		job.output.height = entry.info.height;
+		job.output.stride = (size_t)entry.info.width * 4;
+		job.output.format = wres::PixelFormat::RGBA;
+		job.output.premultiplied = false;
+		ours.emplace_back(job.output.stride * job.output.height);
+		reference.emplace_back(job.output.stride * job.output.height);
+		jobs.push_back(job);
+		pixels += (size_t)entry.info.width * entry.info.height;
+		compressed += job.size;
+	}
+	for(size_t i = 0; i < jobs.size(); i++)
+		jobs[i].output.pixels = ours[i].data();
+
+	printf("%zu PNG images, %zu pixels, %zu compressed bytes, %d iterations\n",
+		   jobs.size(), pixels, compressed, iterations);
+
+	// libpng through the simplified API, RGBA output
+	auto start = bench_clock::now();
+	size_t failures = 0;
+	for(int it = 0; it < iterations; it++)
+	{
+		for(size_t i = 0; i < jobs.size(); i++)
+		{
+			png_image image;
+			memset(&image, 0, sizeof(image));
+			image.version = PNG_IMAGE_VERSION;
+			if(!png_image_begin_read_from_memory(&image, jobs[i].data, jobs[i].size))
+			{
+				failures++;
+				continue;
+			}
+			image.format = PNG_FORMAT_RGBA;
+			if(!png_image_finish_read(&image, nullptr, reference[i].data(), jobs[i].output.stride, nullptr))
+				failures++;
+			png_image_free(&image);
+		}
+	}
+	double libpng_ms = elapsed_ms(start) / iterations;
+
+	start = bench_clock::now();
+	size_t decoded = 0;
+	for(int it = 0; it < iterations; it++)
+	{
+		decoded = 0;
+		for(auto &job : jobs)
+			decoded += wres::decode_png(job.data, job.size, job.output);
+	}
+	double wres_ms = elapsed_ms(start) / iterations;
+
+	size_t mismatches = 0;
+	for(size_t i = 0; i < jobs.size(); i++)
+	{
+		if(memcmp(ours[i].data(), reference[i].data(), ours[i].size()) != 0)
+			mismatches++;
+	}
+
+	for(auto &job : jobs)
+	{
+		job.output.format = wres::PixelFormat::BGRA;
+		job.output.premultiplied = true;
+	}
+	start = bench_clock::now();
+	for(int it = 0; it < iterations; it++)
+	{
+		for(auto &job : jobs)
+			wres::decode_png(job.data, job.size, job.output);
+	}
+	double premul_ms = elapsed_ms(start) / iterations;
+
+	start = bench_clock::now();
+	size_t batch_decoded = 0;
+	for(int it = 0; it < iterations; it++)
+		batch_decoded = wres::decode_png_batch(jobs);
+	double batch_ms = elapsed_ms(start) / iterations;
+
+	printf("libpng (RGBA):                 %8.3f ms, %zu failures\n", libpng_ms, failures);
+	printf("wres (RGBA):                   %8.3f ms, %zu decoded, %zu differ from libpng\n", wres_ms, decoded, mismatches);
+	printf("wres (BGRA premultiplied):     %8.3f ms\n", premul_ms);
+	printf("wres batch (%2u threads):       %8.3f ms, %zu decoded\n",
+		   wres::ThreadPool::global().threadCount(), batch_ms, batch_decoded);
+	printf("Speedup over libpng: %.2fx single-threaded, %.2fx batch\n", libpng_ms / wres_ms, libpng_ms / batch_ms);
+
+	return mismatches == 0 && decoded == jobs.size() ? 0 : 1;
+}
@@ -31,8 +31,9 @@ struct MessageHeader {
 };
 
 void (*program_termination_hook)(void) = NULL;
-static char *error_message = NULL;
-static struct MessageHeader *message_header = NULL;
+/* per thread, so that libraries can be parsed from several threads */
+static thread_local char *error_message = NULL;
+static thread_local struct MessageHeader *message_header = NULL;
 
 static inline const char *
 get_message_header(void)
@@ -63,20 +64,23 @@ v_warn_errno(const char *msg, va_list ap)
 }
 
 /**
- * Free all global memory allocated by the error facilities
- * provided here.
+ * Free all memory allocated by the error facilities
+ * provided here for the calling thread.
  */
 void
 free_error(void)
 {
-	struct MessageHeader *hdr;
+	struct MessageHeader *hdr, *old;
 
-	for (hdr = message_header; hdr != NULL; hdr = hdr->old) {
+	for (hdr = message_header; hdr != NULL; hdr = old) {
+		old = hdr->old;
 		free(hdr->message);
 		free(hdr);
 	}
+	message_header = NULL;
 	if (error_message != NULL)
 		free(error_message);
+	error_message = NULL;
 }
 
 /**
@@ -226,7 +230,7 @@ restore_message_header(void)
 }
 
 /**
- * Set a global error message.
+ * Set the error message of the calling thread.
  */
 void
 set_error(const char *format, ...)
@@ -86,6 +86,14 @@ typedef struct {
     uint32_t clr_important;
 } Win32BitmapInfoHeader;
 
+/* Win32BitmapInfoHeader compression values */
+#define BI_RGB          0
+#define BI_RLE8         1
+#define BI_RLE4         2
+#define BI_BITFIELDS    3
+#define BI_JPEG         4
+#define BI_PNG          5
+
 typedef struct {
     uint8_t blue;
     uint8_t green;
@@ -150,6 +158,9 @@ typedef struct {
 #define RT_MESSAGELIST   11
 #define RT_GROUP_CURSOR  12
 #define RT_GROUP_ICON    14
+#define RT_VERSION       16
+#define RT_ANICURSOR     21
+#define RT_ANIICON       22
 
 typedef struct {
     union {
@@ -379,6 +390,39 @@ typedef struct {
     uint16_t number_of_id_entries;
 } Win32ImageResourceDirectory;
 
+/* VS_FIXEDFILEINFO, the value of the VS_VERSION_INFO node */
+#define VS_FFI_SIGNATURE 0xFEEF04BD
+
+typedef struct {
+    uint32_t signature;
+    uint32_t struct_version;
+    uint32_t file_version_ms;
+    uint32_t file_version_ls;
+    uint32_t product_version_ms;
+    uint32_t product_version_ls;
+    uint32_t file_flags_mask;
+    uint32_t file_flags;
+    uint32_t file_os;
+    uint32_t file_type;
+    uint32_t file_subtype;
+    uint32_t file_date_ms;
+    uint32_t file_date_ls;
+} Win32FixedFileInfo;
+
+/* RT_MESSAGELIST data: MESSAGE_RESOURCE_DATA, its blocks and entries */
+#define MESSAGE_RESOURCE_UNICODE 0x0001
+
+typedef struct {
+    uint32_t low_id;
+    uint32_t high_id;
+    uint32_t offset_to_entries;
+} Win32MessageResourceBlock;
+
+typedef struct {
+    uint16_t length;
+    uint16_t flags;
+} Win32MessageResourceEntry;
+
 #pragma pack()
 
 #endif /* WIN32_H */
@@ -17,10 +17,32 @@
  */
 
 #include <filesystem>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <thread>
 #include <string.h>
 #include "../wres/wresutil.h"
 #include "../wres/winlibrary.h"
 #include "../wres/winresource.h"
+#include "../wres/imageinfo.h"
+#include "../wres/stringtable.h"
+#include "../wres/versioninfo.h"
+#include "../wres/messagetable.h"
+#include "../wres/templateview.h"
+#include "../wres/themeproperties.h"
+#include "../wres/themeclasses.h"
+#include "../wres/themelibrary.h"
+#include "../wres/muilibrary.h"
+#include "../wres/anicursor.h"
+#include "../wres/boundedspan.h"
+#include "../wres/log.h"
+#include "../bench/corpus.h"
+#if WRES_IMAGE_CODECS
+#include "../wres/pngdecoder.h"
+#include "../wres/dibdecoder.h"
+#include "../wres/thumbnail.h"
+#endif
 
 int main (int argc, char **argv)
 {
@@ -166,6 +188,764 @@ int main (int argc, char **argv)
 		printf("Extraction failure!\n");
 	}
 
+	printf("Extracting resources in file order test:\n");
+
+	std::filesystem::create_directories("./ordered");
+	auto ordered = theme.collectResources(images, true);
+	bool sorted = std::is_sorted(ordered.begin(), ordered.end(), [](const wres::WinResource *a, const wres::WinResource *b)
+	{
+		return a->offset() < b->offset();
+	});
+	printf("%zu resources, %s\n", ordered.size(), sorted ? "in offset order" : "out of order");
+	if(theme.extractResource(images, "./ordered/", false, true))
+	{
+		printf("Extraction success!\n");
+	}
+	else
+	{
+		printf("Extraction failure!\n");
+	}
+
+	printf("Content classification test:\n");
+
+	auto printContentTypes = [](wres::WinLibrary &a)
+	{
+		std::map<std::string, int> counts;
+		for(auto r : a.collectResources(&a.root()))
+			counts[wres::content_type_to_string(r->contentType())]++;
+		for(auto &c : counts)
+			printf("%s: %d\n", c.first.c_str(), c.second);
+	};
+	printContentTypes(testfi);
+	printContentTypes(theme);
+
+	printf("Image header index test:\n");
+
+	wres::ImageIndex imageIndex;
+	if(imageIndex.build(theme, images))
+	{
+		printf("Indexed %zu images\n", imageIndex.size());
+		auto info = imageIndex.find(std::string("1342"));
+		if(!info)
+			info = imageIndex.find(std::string("508"));
+		if(info)
+		{
+			printf("%s: %ux%u, depth %u, color type %u\n", wres::content_type_to_string(info->format),
+				   info->width, info->height, info->bitDepth, info->colorType);
+		}
+	}
+	else
+	{
+		printf("Indexing failure!\n");
+	}
+	wres::ImageIndex iconIndex;
+	iconIndex.build(testfi, testfi.findResource(std::string("3"), std::string(""), std::string("")));
+	for(auto &entry : iconIndex.entries())
+	{
+		printf("Icon %s: %s %ux%u, %u bpp\n", entry.resource->name().c_str(), wres::content_type_to_string(entry.info.format),
+			   entry.info.width, entry.info.height, entry.info.bitDepth);
+	}
+	size_t fitting = 0;
+	for(auto &entry : imageIndex.entries())
+		fitting += wres::image_payload_fits(entry.info, entry.resource->size());
+	// a bare BITMAPINFOHEADER that claims 16384x16384 at 32 bits
+	uint8_t hugeDib[40] = { 40, 0, 0, 0, 0, 0x40, 0, 0, 0, 0x40, 0, 0, 1, 0, 32, 0 };
+	wres::ImageInfo hugeInfo;
+	wres::read_image_info(hugeDib, sizeof(hugeDib), &hugeInfo);
+	printf("%zu of %zu images fit their data, huge header: %s\n", fitting, imageIndex.size(),
+	       wres::image_payload_fits(hugeInfo, sizeof(hugeDib)) ? "fits" : "rejected");
+
+	printf("Icon selection test:\n");
+
+	auto iconGroup = testfi.findResource(std::string("14"), std::string("1"), std::string(""));
+	const int iconSizes[][3] = { { 16, 96, 32 }, { 32, 96, 4 }, { 32, 144, 32 }, { 24, 96, 32 }, { 256, 96, 32 } };
+	for(auto &s : iconSizes)
+	{
+		auto view = testfi.selectIcon(iconGroup, s[0], s[1], s[2]);
+		if(view.isValid())
+		{
+			printf("%dpx at %d dpi, %d bpp: icon %s, %s %ux%u, %u bpp\n", s[0], s[1], s[2], view.resource->name().c_str(),
+				   wres::content_type_to_string(view.format), view.width, view.height, view.bitCount);
+		}
+		else
+		{
+			printf("%dpx at %d dpi, %d bpp: no icon\n", s[0], s[1], s[2]);
+		}
+	}
+
+	printf("String table test:\n");
+
+	wres::StringTable strings(testfi);
+	auto stringLanguages = strings.languages();
+	printf("%zu languages\n", stringLanguages.size());
+	size_t nonEmpty = 0;
+	for(uint32_t id = 1040; id < 1104; id++)
+	{
+		std::u16string_view text = strings.find(id);
+		std::string_view utf8 = strings.findUtf8(id);
+		if(text.empty())
+			continue;
+		if(nonEmpty++ < 4)
+			printf("%u: %zu UTF-16 units, \"%.*s\"\n", id, text.size(), (int)utf8.size(), utf8.data());
+	}
+	printf("%zu strings\n", nonEmpty);
+	size_t translated = 0;
+	for(auto &language : stringLanguages)
+		translated += !strings.findUtf8(1042, language).empty();
+	printf("1042 is translated into %zu languages\n", translated);
+
+	printf("Version info test:\n");
+
+	wres::VersionInfo version;
+	if(version.load(theme))
+	{
+		printf("File version %s, product version %s\n", version.fileVersion().c_str(), version.productVersion().c_str());
+		printf("FileVersion: %s\n", version.valueUtf8("FileVersion").c_str());
+		printf("CompanyName: %s\n", version.valueUtf8("CompanyName").c_str());
+		printf("%zu string tables, %zu translations\n", version.stringBlocks().size(), version.translations().size());
+	}
+	else
+	{
+		printf("No version info!\n");
+	}
+	wres::VersionInfo fileVersion;
+	if(fileVersion.loadFile("../../test/pe/aero11_seven.msstyles") && fileVersion.fileVersion() == version.fileVersion() &&
+	   fileVersion.valueUtf8("FileVersion") == version.valueUtf8("FileVersion"))
+		printf("Version only mode matches\n");
+	else
+		printf("Version only mode failed!\n");
+
+	std::vector<wres::VersionScanJob> versionJobs(2);
+	versionJobs[0].path = "../../test/pe/winemine.exe";
+	versionJobs[1].path = "../../test/pe/aero11_seven.msstyles";
+	printf("%zu of %zu files have version info\n", wres::scan_versions(versionJobs), versionJobs.size());
+
+	printf("Message table test:\n");
+
+	// two blocks, stored out of order: 0x10-0x11 (ANSI) and 0x02 (Unicode)
+	static const uint8_t messageData[] =
+	{
+		2, 0, 0, 0,
+		0x10, 0, 0, 0, 0x11, 0, 0, 0, 28, 0, 0, 0,
+		0x02, 0, 0, 0, 0x02, 0, 0, 0, 48, 0, 0, 0,
+		12, 0, 0, 0, 'H', 'e', 'l', 'l', 'o', 0, 0, 0,
+		8, 0, 0, 0, 'B', 'y', 'e', 0,
+		12, 0, 1, 0, 'W', 0, 'i', 0, 'd', 0, 0, 0,
+	};
+	wres::MessageTable messages;
+	messages.parse(messageData, sizeof(messageData));
+	auto printMessages = [&]()
+	{
+		for(uint32_t id : { 0x02, 0x10, 0x11, 0x12 })
+		{
+			wres::MessageView m = messages.lookup(id);
+			if(!m.isValid())
+				printf("0x%x: not found\n", id);
+			else if(m.unicode)
+				printf("0x%x: %zu UTF-16 units\n", id, m.utf16().size());
+			else
+				printf("0x%x: \"%.*s\"\n", id, (int)m.ansi().size(), m.ansi().data());
+		}
+	};
+	printf("%zu messages\n", messages.size());
+	printMessages();
+	messages.buildIndex();
+	printf("With index:\n");
+	printMessages();
+	// blocks that all share the same entry area
+	std::vector<uint8_t> sharedEntries(4 + 1000 * 12 + 4000, 0);
+	sharedEntries[0] = 0xE8;
+	sharedEntries[1] = 0x03;
+	for(uint32_t i = 0; i < 1000; i++)
+	{
+		uint8_t *block = sharedEntries.data() + 4 + i * 12;
+		uint32_t lowId = i * 0x10000, highId = lowId + 999, offset = 4 + 1000 * 12;
+		memcpy(block, &lowId, 4);
+		memcpy(block + 4, &highId, 4);
+		memcpy(block + 8, &offset, 4);
+	}
+	wres::MessageTable sharedTable;
+	sharedTable.parse(sharedEntries.data(), sharedEntries.size());
+	printf("Shared entry areas: %zu ids for %zu bytes, index %s\n", sharedTable.size(), sharedEntries.size(),
+	       sharedTable.buildIndex() ? "built" : "failed");
+	printf("winemine has a message table: %s\n", wres::MessageTable().load(testfi) ? "yes" : "no");
+	// the same table at an odd address: Unicode text can not be viewed
+	std::vector<uint8_t> oddMessages(sizeof(messageData) + 1);
+	memcpy(oddMessages.data() + 1, messageData, sizeof(messageData));
+	wres::MessageTable oddTable;
+	oddTable.parse(oddMessages.data() + 1, sizeof(messageData));
+	printf("At an odd address: 0x2 has %zu UTF-16 units, 0x10 is \"%.*s\"\n", oddTable.lookup(0x02).utf16().size(),
+	       (int)oddTable.lookup(0x10).ansi().size(), oddTable.lookup(0x10).ansi().data());
+
+	printf("Dialog and menu test:\n");
+
+	auto toUtf8 = [](std::u16string_view text)
+	{
+		std::string s;
+		wres::append_utf16le_as_utf8(s, (const uint8_t*)text.data(), text.size());
+		return s;
+	};
+	wres::WinResource *dialogs = testfi.findResource(std::string("5"), std::string(""), std::string(""));
+	size_t dialogCount = 0, controlCount = 0;
+	for(auto r : testfi.collectResources(dialogs))
+	{
+		wres::DialogView dialog((const uint8_t*)r->offset(), r->size());
+		if(!dialog.isValid())
+			continue;
+		dialogCount++;
+		size_t items = 0;
+		for(auto &item : dialog)
+		{
+			(void)item;
+			items++;
+		}
+		controlCount += items;
+		if(r->name() == "1" && r->language() == "1033")
+		{
+			printf("Dialog \"%s\", %s %u, %zu of %u items\n", toUtf8(dialog.header().title).c_str(),
+			       toUtf8(dialog.header().typeface).c_str(), dialog.header().pointSize, items, dialog.header().itemCount);
+			for(auto &item : dialog)
+			{
+				if(item.windowClass.hasOrdinal)
+					printf("  0x%x class 0x%x \"%s\"\n", item.id, item.windowClass.ordinal, toUtf8(item.title.name).c_str());
+				else
+					printf("  0x%x class %s \"%s\"\n", item.id, toUtf8(item.windowClass.name).c_str(), toUtf8(item.title.name).c_str());
+			}
+		}
+	}
+	printf("%zu dialogs, %zu controls\n", dialogCount, controlCount);
+
+	wres::WinResource *menu = testfi.findResource(std::string("4"), std::string("1"), std::string("1033"));
+	wres::MenuView menuView(menu ? (const uint8_t*)menu->offset() : nullptr, menu ? menu->size() : 0);
+	for(auto &item : menuView)
+	{
+		if(item.isSeparator())
+			printf("%*s----\n", item.depth * 2, "");
+		else
+			printf("%*s%s 0x%x%s\n", item.depth * 2, "", toUtf8(item.text).c_str(), item.id, item.isPopup ? " (popup)" : "");
+	}
+	// truncated copies must stop early without reading past the end
+	size_t truncatedItems = 0;
+	for(size_t size = 0; menu && size < menu->size(); size++)
+	{
+		std::vector<uint8_t> copy((const uint8_t*)menu->offset(), (const uint8_t*)menu->offset() + size);
+		for(auto &item : wres::MenuView(copy.data(), copy.size()))
+		{
+			(void)item;
+			truncatedItems++;
+		}
+	}
+	printf("%zu items in truncated menus\n", truncatedItems);
+
+	printf("Theme property test:\n");
+
+	for(const char *type : { "VARIANT", "RMAP", "AMAP" })
+	{
+		wres::WinResource *map = theme.findResource(std::string(type), std::string(""), std::string(""));
+		auto maps = theme.collectResources(map);
+		if(maps.empty())
+			continue;
+		wres::PropertyTable table;
+		bool parsed = table.parse((const uint8_t*)maps[0]->offset(), maps[0]->size());
+		size_t found = 0;
+		for(auto &p : table.properties())
+			found += table.find(p.classId, p.partId, p.stateId, p.nameId) != nullptr;
+		printf("%s: %s, %zu properties, %zu found\n", type, parsed ? "parsed" : "failed", table.size(), found);
+		if(strcmp(type, "RMAP") == 0)
+		{
+			const wres::ThemeProperty *p = table.find(0, 0, 0, 600);
+			printf("RMAP 600: \"%s\"\n", p ? toUtf8(p->stringValue()).c_str() : "not found");
+		}
+		else if(strcmp(type, "VARIANT") == 0)
+		{
+			const wres::ThemeProperty *p = table.find(4, 0, 0, 2431);
+			printf("VARIANT 4/0/0/2431: type %u, 0x%08x\n", p ? p->type : 0, p ? (uint32_t)p->intValue() : 0);
+			p = table.resolve(36, 1, 5, 3001);
+			printf("VARIANT 36/1/5/3001 resolves to state %u, image %u\n", p ? p->stateId : 0, p ? p->reference : 0);
+		}
+	}
+	wres::WinResource *vmap = theme.findResource(std::string("VMAP"), std::string("VMAP"), std::string("0"));
+	std::vector<std::u16string_view> variants;
+	if(vmap && wres::read_variant_map((const uint8_t*)vmap->offset(), vmap->size(), variants))
+	{
+		for(auto &name : variants)
+			printf("Variant %s\n", toUtf8(name).c_str());
+	}
+
+	printf("Theme class test:\n");
+
+	wres::WinResource *cmap = theme.findResource(std::string("CMAP"), std::string("CMAP"), std::string("0"));
+	wres::WinResource *bcmap = theme.findResource(std::string("BCMAP"), std::string("BCMAP"), std::string("0"));
+	wres::ClassMap classes;
+	if(cmap && bcmap && classes.parse((const uint8_t*)cmap->offset(), cmap->size(), (const uint8_t*)bcmap->offset(), bcmap->size()))
+	{
+		printf("%zu classes\n", classes.size());
+		for(const char *name : { "globals", "ButtonStyle", "buttonstyle", "Explorer::Button", "NoSuchClass" })
+		{
+			int32_t index = classes.find(name);
+			int32_t base = index < 0 ? -1 : classes.baseClass(index);
+			std::string_view baseName = base < 0 ? std::string_view("-") : classes.name(base);
+			printf("%s: %d, base %.*s\n", name, index, (int)baseName.size(), baseName.data());
+		}
+		size_t roundTrips = 0;
+		for(uint32_t i = 0; i < classes.size(); i++)
+			roundTrips += classes.find(classes.name(i)) == (int32_t)i;
+		printf("%zu names map back to their index\n", roundTrips);
+	}
+	else
+	{
+		printf("Class map failed!\n");
+	}
+
+	printf("Theme library test:\n");
+
+	wres::ThemeLibrary themeLibrary("../../test/pe/aero11_seven.msstyles", "", true);
+	if(themeLibrary.isValid())
+	{
+		printf("Version %u, %zu classes, %zu variants, %zu RMAP and %zu AMAP properties, %zu images\n",
+		       themeLibrary.packthemVersion(), themeLibrary.classes().size(), themeLibrary.variants().size(),
+		       themeLibrary.rmap().size(), themeLibrary.amap().size(), themeLibrary.images().size());
+		int32_t button = themeLibrary.classes().find("Button");
+		const wres::PropertyTable *normal = themeLibrary.variant("NORMAL");
+		const wres::ThemeProperty *image = button < 0 || normal == nullptr ? nullptr : normal->resolve(button, 1, 2, 3001);
+		printf("Button 1/2 image: %u\n", image ? image->reference : 0);
+		const wres::PropertyTable *defaultVariant = themeLibrary.variant();
+		const wres::ThemeProperty *font = defaultVariant ? defaultVariant->find(5, 0, 0, 801) : nullptr;
+		std::string_view fontName = font ? themeLibrary.strings().findUtf8(font->reference) : std::string_view();
+		printf("Caption font: %.*s\n", (int)fontName.size(), fontName.data());
+		const wres::ThemeOpenTimings &t = themeLibrary.timings();
+		if(t.total >= t.open + t.parse + t.images - 0.001)
+			printf("Timings add up\n");
+	}
+	else
+	{
+		printf("Theme library failed!\n");
+	}
+
+	printf("MUI test:\n");
+
+	// a configuration with RT_STRING (6) and "MUI" moved to the satellite
+	std::vector<uint8_t> muiData(0x84, 0);
+	auto put32 = [&](size_t offset, uint32_t v) { for(int i = 0; i < 4; i++) muiData[offset + i] = (uint8_t)(v >> (i * 8)); };
+	auto putList = [&](size_t field, const std::vector<uint8_t>& list)
+	{
+		put32(field, (uint32_t)muiData.size());
+		put32(field + 4, (uint32_t)list.size());
+		muiData.insert(muiData.end(), list.begin(), list.end());
+	};
+	put32(0x00, MUI_SIGNATURE);
+	put32(0x10, MUI_FILETYPE_MUI);
+	putList(0x6C, { 6, 0, 0, 0 });
+	putList(0x64, { 'M', 0, 'U', 0, 'I', 0, 0, 0, 0, 0 });
+	putList(0x74, { 'd', 0, 'e', 0, '-', 0, 'D', 0, 'E', 0, 0, 0 });
+	put32(0x04, (uint32_t)muiData.size());
+	wres::MuiConfig muiConfig;
+	if(wres::parse_mui_config(muiData.data(), muiData.size(), &muiConfig))
+		printf("File type 0x%x, %zu id types (%u), name type %s, language %s\n", muiConfig.fileType, muiConfig.muiIdTypes.size(),
+		       muiConfig.muiIdTypes.empty() ? 0 : muiConfig.muiIdTypes[0], muiConfig.muiNameTypes.empty() ? "-" : muiConfig.muiNameTypes[0].c_str(),
+		       muiConfig.language.c_str());
+	else
+		printf("MUI configuration failed!\n");
+
+	// a copy of winemine as its own satellite
+	std::filesystem::create_directories("mui/de-DE");
+	std::filesystem::copy_file("../../test/pe/winemine.exe", "mui/winemine.exe", std::filesystem::copy_options::overwrite_existing);
+	std::filesystem::copy_file("../../test/pe/winemine.exe", "mui/de-DE/winemine.exe.mui", std::filesystem::copy_options::overwrite_existing);
+	wres::MuiLibrary muiLibrary("mui/winemine.exe", { "fr-FR", "de-DE" });
+	wres::MuiResource found = muiLibrary.findResource("6", "66", "");
+	printf("String block 66 from the %s, satellite opened: %s\n", found.localized ? "satellite" : "main file",
+	       muiLibrary.satellitePath().empty() ? "no" : "yes");
+	found = muiLibrary.findResource("99", "", "");
+	printf("Type 99: %s, satellite %s\n", found.isValid() ? "found" : "not found", muiLibrary.satellitePath().c_str());
+	std::vector<wres::MuiResource> muiIcons = muiLibrary.collectResources("3");
+	size_t satelliteIcons = std::count_if(muiIcons.begin(), muiIcons.end(), [](const wres::MuiResource& r) { return r.localized; });
+	printf("%zu icons, %zu from the satellite\n", muiIcons.size(), satelliteIcons);
+
+	printf("NE test:\n");
+
+	// a minimal Win16 file: an RT_STRING block and a named TEXT/README resource
+	std::vector<uint8_t> ne(0x240, 0);
+	auto put16 = [&](size_t offset, uint16_t v) { ne[offset] = (uint8_t)v; ne[offset + 1] = (uint8_t)(v >> 8); };
+	auto putText = [&](size_t offset, const char *text) { memcpy(&ne[offset], text, strlen(text)); };
+	putText(0x00, "MZ");
+	put16(0x3C, 0x40);
+	putText(0x40, "NE");
+	const size_t rsrctab = 0x40, table = 0x40 + rsrctab;
+	put16(0x40 + 0x24, rsrctab);
+	put16(0x40 + 0x26, rsrctab + 57);
+	put16(table, 4);
+	put16(table + 2, 0x8000 | RT_STRING);
+	put16(table + 4, 1);
+	put16(table + 10, 0x20);
+	put16(table + 12, 3);
+	put16(table + 16, 0x8001);
+	put16(table + 22, 44);
+	put16(table + 24, 1);
+	put16(table + 30, 0x23);
+	put16(table + 32, 1);
+	put16(table + 36, 49);
+	putText(table + 44, "\x04TEXT\x06README");
+	putText(table + 57, "\x08WINEMINE");
+	putText(0x230, "Hello from NE");
+	FILE *neFile = fopen("ne_test.exe", "wb");
+	fwrite(ne.data(), 1, ne.size(), neFile);
+	fclose(neFile);
+
+	wres::WinLibrary neLibrary(std::string("ne_test.exe"));
+	printf("Valid: %s, PE: %s, module %s\n", neLibrary.isValid() ? "true" : "false",
+	       neLibrary.isPEBinary() ? "true" : "false", neLibrary.moduleName().c_str());
+	for(auto r : neLibrary.collectResources(&neLibrary.root()))
+		printf("%s/%s/%s: %zu bytes at 0x%x\n", r->type().c_str(), r->name().c_str(), r->language().c_str(),
+		       r->size(), (uint32_t)(r->offset() - neLibrary.data()));
+	wres::WinResource *readme = neLibrary.findResource(std::string("TEXT"), std::string("README"), std::string("0"));
+	printf("README: %s\n", readme ? readme->offset() : "not found");
+	put16(table, 17);
+	neFile = fopen("ne_shift.exe", "wb");
+	fwrite(ne.data(), 1, ne.size(), neFile);
+	fclose(neFile);
+	wres::WinLibrary neShift(std::string("ne_shift.exe"));
+	printf("Alignment shift 17: %s\n", wres::format_parse_status(neShift.status(), "ne_shift.exe"));
+
+	printf("Parse status test:\n");
+
+	printf("%s\n", wres::format_parse_status(testfi.status(), "winemine.exe"));
+	wres::WinLibrary missing(std::string("does_not_exist.exe"));
+	printf("%s\n", wres::format_parse_status(missing.status(), "does_not_exist.exe"));
+	printf("Missing file loaded: %s\n", missing.isLoaded() ? "true" : "false");
+	// claim 0xffff entries in the root resource directory of a copy of winemine
+	std::ifstream winemineFile("../../test/pe/winemine.exe", std::ios::binary);
+	std::vector<char> winemineData((std::istreambuf_iterator<char>(winemineFile)), std::istreambuf_iterator<char>());
+	std::vector<char> truncatedData(winemineData);
+	const char *rootDirectory = (const char*)testfi.firstResource();
+	auto rootAt = std::search(truncatedData.begin(), truncatedData.end(), rootDirectory, rootDirectory + 16);
+	rootAt[14] = rootAt[15] = (char)0xff;
+	FILE *truncatedFile = fopen("truncated.exe", "wb");
+	fwrite(truncatedData.data(), 1, truncatedData.size(), truncatedFile);
+	fclose(truncatedFile);
+	wres::WinLibrary truncated(std::string("truncated.exe"));
+	printf("Valid: %s, %s\n", truncated.isValid() ? "true" : "false",
+	       wres::format_parse_status(truncated.status(), "truncated.exe"));
+
+	printf("Parse limits test:\n");
+
+	wres::ParseLimits fewNodes;
+	fewNodes.maxNodes = 10;
+	wres::ParseLimits smallImage;
+	smallImage.maxAllocation = 4096;
+	wres::ParseLimits fewBytes;
+	fewBytes.maxDeclaredBytes = 1000;
+	for(auto &limits : { fewNodes, smallImage, fewBytes })
+	{
+		wres::WinLibrary limited(std::string("../../test/pe/winemine.exe"), limits);
+		printf("%zu resources, %s\n", limited.isValid() ? limited.collectResources(&limited.root()).size() : 0,
+		       wres::format_parse_status(limited.status()));
+	}
+	// point the second type of a copy of winemine at the directory of the first one
+	std::vector<char> sharedData(winemineData);
+	rootAt = std::search(sharedData.begin(), sharedData.end(), rootDirectory, rootDirectory + 16);
+	std::copy(rootAt + 20, rootAt + 24, rootAt + 28);
+	FILE *sharedFile = fopen("shared.exe", "wb");
+	fwrite(sharedData.data(), 1, sharedData.size(), sharedFile);
+	fclose(sharedFile);
+	wres::WinLibrary sharedLibrary(std::string("shared.exe"));
+	printf("%zu resources, %s\n", sharedLibrary.collectResources(&sharedLibrary.root()).size(),
+	       wres::format_parse_status(sharedLibrary.status()));
+
+	printf("Concurrent access test:\n");
+
+	// a fresh library, so that the lazily computed values are computed concurrently
+	const wres::WinLibrary sharedTheme(std::string("../../test/pe/aero11_seven.msstyles"));
+	const wres::StringTable sharedStrings(sharedTheme);
+	std::vector<const wres::WinResource*> sharedResources = sharedTheme.collectResources(&sharedTheme.root());
+	// find() reads the resource directly, findUtf8() builds the shared index
+	uint16_t sharedStringId = 0;
+	while(sharedStringId < 0xffff && sharedStrings.find(sharedStringId).empty())
+		sharedStringId++;
+	std::string sharedString = toUtf8(sharedStrings.find(sharedStringId));
+	const unsigned accessThreads = 8;
+	std::vector<size_t> mismatchCounts(accessThreads, 0);
+	std::vector<std::thread> accessors;
+	for(unsigned t = 0; t < accessThreads; t++)
+	{
+		accessors.emplace_back([&, t]()
+		{
+			for(int round = 0; round < 4; round++)
+			{
+				for(size_t i = t; i < sharedResources.size() + t; i++)
+				{
+					const wres::WinResource *r = sharedResources[i % sharedResources.size()];
+					if(sharedTheme.findResource(r->type(), r->name(), r->language()) != r)
+						mismatchCounts[t]++;
+					r->contentType();
+					r->getExtractExtension();
+				}
+				if(sharedStrings.findUtf8(sharedStringId) != sharedString)
+					mismatchCounts[t]++;
+			}
+		});
+	}
+	for(auto &accessor : accessors)
+		accessor.join();
+	size_t accessMismatches = 0;
+	for(size_t count : mismatchCounts)
+		accessMismatches += count;
+	size_t pngResources = 0;
+	for(auto r : sharedResources)
+		pngResources += r->contentType() == wres::ContentType::PNG;
+	printf("%u threads, %zu resources: %zu mismatches, %zu PNG resources, string %u: %s\n", accessThreads,
+	       sharedResources.size(), accessMismatches, pngResources, sharedStringId, sharedString.c_str());
+
+	printf("Bounded span test:\n");
+
+	const uint8_t spanBytes[8] = { 1, 0, 2, 0, 3, 0, 4, 0 };
+	wres::BoundedSpan<> span(spanBytes, sizeof(spanBytes));
+	printf("Last word: %s, past the end: %s, overflowing count: %s\n",
+	       span.array<uint16_t>(6, 1).isValid() ? "valid" : "invalid",
+	       span.sub(6, 4).isValid() ? "valid" : "invalid",
+	       span.array<uint32_t>(0, SIZE_MAX / 2).isValid() ? "valid" : "invalid");
+	wres::BoundedSpan<wres::TrustedBounds> trusted(spanBytes, sizeof(spanBytes));
+	printf("Trusted read: %u\n", trusted.sub(4, 4).le32(0));
+
+	printf("ANI test:\n");
+
+	// two frames built from the winemine icons: an .ico with all images and a .cur with the first one
+	std::vector<wres::WinResource*> aniImages = testfi.collectResources(
+		testfi.findResource(std::string("3"), std::string(""), std::string("")));
+	auto append32 = [](std::vector<uint8_t>& v, uint32_t x) { for(int i = 0; i < 4; i++) v.push_back((uint8_t)(x >> (8 * i))); };
+	auto append16 = [](std::vector<uint8_t>& v, uint16_t x) { v.push_back((uint8_t)x); v.push_back((uint8_t)(x >> 8)); };
+	auto makeIconFile = [&](uint16_t type, size_t count)
+	{
+		std::vector<uint8_t> file;
+		append16(file, 0);
+		append16(file, type);
+		append16(file, (uint16_t)count);
+		size_t offset = 6 + 16 * count;
+		for(size_t i = 0; i < count; i++)
+		{
+			wres::ImageInfo info;
+			wres::read_image_info((const uint8_t*)aniImages[i]->offset(), aniImages[i]->size(), &info, true);
+			file.push_back((uint8_t)info.width);
+			file.push_back((uint8_t)info.height);
+			file.push_back(0);
+			file.push_back(0);
+			append16(file, type == 1 ? 1 : 3);
+			append16(file, type == 1 ? info.bitDepth : 4);
+			append32(file, (uint32_t)aniImages[i]->size());
+			append32(file, (uint32_t)offset);
+			offset += aniImages[i]->size();
+		}
+		for(size_t i = 0; i < count; i++)
+			file.insert(file.end(), aniImages[i]->offset(), aniImages[i]->offset() + aniImages[i]->size());
+		return file;
+	};
+	auto appendChunk = [&](std::vector<uint8_t>& v, const char *id, const std::vector<uint8_t>& data)
+	{
+		v.insert(v.end(), id, id + 4);
+		append32(v, (uint32_t)data.size());
+		v.insert(v.end(), data.begin(), data.end());
+		if(data.size() & 1)
+			v.push_back(0);
+	};
+	std::vector<uint8_t> anih, rate, seq, info, frames, ani;
+	for(uint32_t x : { 36u, 2u, 3u, 0u, 0u, 0u, 0u, 30u, (uint32_t)(ANI_FLAG_ICON | ANI_FLAG_SEQUENCE) })
+		append32(anih, x);
+	for(uint32_t x : { 10u, 20u })
+		append32(rate, x);
+	for(uint32_t x : { 0u, 1u, 0u })
+		append32(seq, x);
+	info = { 'I', 'N', 'F', 'O' };
+	appendChunk(info, "INAM", std::vector<uint8_t>({ 'M', 'i', 'n', 'e', 's', 0 }));
+	frames = { 'f', 'r', 'a', 'm' };
+	appendChunk(frames, "icon", makeIconFile(1, aniImages.size()));
+	appendChunk(frames, "icon", makeIconFile(2, 1));
+	ani = { 'A', 'C', 'O', 'N' };
+	appendChunk(ani, "LIST", info);
+	appendChunk(ani, "anih", anih);
+	appendChunk(ani, "rate", rate);
+	appendChunk(ani, "seq ", seq);
+	appendChunk(ani, "LIST", frames);
+	std::vector<uint8_t> riff;
+	appendChunk(riff, "RIFF", ani);
+
+	wres::AniCursor aniCursor(riff.data(), riff.size());
+	printf("Valid: %s, title %.*s, %zu frames, %zu steps\n", aniCursor.isValid() ? "true" : "false",
+	       (int)aniCursor.title().size(), aniCursor.title().data(), aniCursor.frameCount(), aniCursor.stepCount());
+	for(size_t step = 0; step < aniCursor.stepCount(); step++)
+		printf("Step %zu: frame %d for %u jiffies\n", step, aniCursor.frameForStep(step), aniCursor.rate(step));
+	for(int size : { 16, 32 })
+	{
+		wres::IconView image = aniCursor.selectFrameImage(0, size);
+		printf("Frame 0 at %d: %ux%u, %u bits, %zu bytes\n", size, image.width, image.height, image.bitCount, image.size);
+	}
+	wres::IconView cursorImage = aniCursor.selectFrameImage(1, 32);
+	printf("Frame 1: %ux%u, hotspot %u,%u\n", cursorImage.width, cursorImage.height, cursorImage.hotspotX, cursorImage.hotspotY);
+	for(size_t length = 0; length < riff.size(); length += 7)
+		aniCursor.parse(riff.data(), length);
+	printf("Truncated data parsed\n");
+
+	printf("Log test:\n");
+
+	std::vector<std::string> logged;
+	wres::set_log_sink([](wres::LogLevel level, const char *message, void *userData)
+	{
+		((std::vector<std::string>*)userData)->push_back(std::to_string((int)level) + " " + message);
+	}, &logged);
+	wres::WinLibrary absent(std::string("missing.exe"));
+	wres::set_log_level(wres::LogLevel::Error);
+	absent.findResource(std::string("3"), std::string(""), std::string(""));
+	wres::set_log_level(wres::LogLevel::Warning);
+	absent.findResource(std::string("3"), std::string(""), std::string(""));
+	wres::set_log_sink(nullptr);
+	for(auto &message : logged)
+		printf("%s\n", message.c_str());
+
+	printf("Synthetic library test:\n");
+
+	CorpusSpec syntheticSpec;
+	syntheticSpec.resources = 500;
+	syntheticSpec.languages = 3;
+	syntheticSpec.nameLength = 300;
+	for(bool pe32Plus : { false, true })
+	{
+		syntheticSpec.pe32Plus = pe32Plus;
+		write_library("synthetic.dll", syntheticSpec);
+		const wres::WinLibrary synthetic(std::string("synthetic.dll"));
+		std::vector<const wres::WinResource*> syntheticResources = synthetic.collectResources(&synthetic.root());
+		size_t found = 0;
+		for(auto r : syntheticResources)
+			found += synthetic.findResource(r->type(), r->name(), r->language()) == r;
+		const wres::WinResource *syntheticGroup = synthetic.findResource(std::string("14"), std::string(""), std::string(""));
+		wres::IconView syntheticIcon = synthetic.selectIcon(&syntheticGroup->children()[0], 16);
+		wres::StringTable syntheticStrings(synthetic);
+		printf("%s: %s, %zu resources, %zu found, icon %ux%u, string 17: %s\n", pe32Plus ? "PE32+" : "PE32",
+		       wres::format_parse_status(synthetic.status()), syntheticResources.size(), found,
+		       syntheticIcon.width, syntheticIcon.height, std::string(syntheticStrings.findUtf8(17, "1034")).c_str());
+	}
+	syntheticSpec.theme = true;
+	write_library("synthetic.msstyles", syntheticSpec);
+	wres::ThemeLibrary syntheticTheme("synthetic.msstyles");
+	if(syntheticTheme.isValid())
+	{
+		const wres::ClassMap &syntheticClasses = syntheticTheme.classes();
+		int32_t derived = syntheticClasses.find("Explorer::Button");
+		int32_t base = derived < 0 ? -1 : syntheticClasses.baseClass(derived);
+		std::string_view baseName = base < 0 ? std::string_view("-") : syntheticClasses.name(base);
+		const wres::PropertyTable *normal = syntheticTheme.variant("NORMAL");
+		printf("Theme: version %u, %zu classes, %zu variant names, Explorer::Button derives from %.*s, text color: %s\n",
+		       syntheticTheme.packthemVersion(), syntheticClasses.size(), syntheticTheme.variantNames().size(),
+		       (int)baseName.size(), baseName.data(), normal && derived >= 0 && normal->find(derived, 0, 0, 3803) ? "yes" : "no");
+	}
+	else
+	{
+		printf("Synthetic theme failed!\n");
+	}
+
+#if WRES_IMAGE_CODECS
+	printf("PNG decoding test:\n");
+
+	std::vector<wres::PngDecodeJob> pngJobs;
+	std::vector<std::vector<uint8_t>> pngPixels;
+	for(auto &entry : imageIndex.entries())
+	{
+		if(entry.info.format != wres::ContentType::PNG)
+			continue;
+		wres::PngDecodeJob job;
+		job.data = (const uint8_t*)entry.resource->offset();
+		job.size = entry.resource->size();
+		job.output.width = entry.info.width;
+		job.output.height = entry.info.height;
+		job.output.stride = (size_t)entry.info.width * 4;
+		pngPixels.emplace_back(job.output.stride * job.output.height);
+		pngJobs.push_back(job);
+	}
+	for(size_t i = 0; i < pngJobs.size(); i++)
+		pngJobs[i].output.pixels = pngPixels[i].data();
+	printf("Decoded %zu of %zu PNG images\n", wres::decode_png_batch(pngJobs), pngJobs.size());
+
+
+	printf("DIB decoding test:\n");
+
+	for(auto r : testfi.collectResources(&testfi.root()))
+	{
+		wres::ImageInfo info;
+		bool icon = r->type() == "3";
+		if((r->type() != "2" && !icon) || !wres::read_image_info((const uint8_t*)r->offset(), r->size(), &info, icon))
+			continue;
+		std::vector<uint8_t> pixels((size_t)info.width * info.height * 4);
+		wres::ImageBuffer buffer;
+		buffer.pixels = pixels.data();
+		buffer.width = info.width;
+		buffer.height = info.height;
+		buffer.stride = (size_t)info.width * 4;
+		bool ok = icon ? wres::decode_icon_image((const uint8_t*)r->offset(), r->size(), buffer)
+		               : wres::decode_dib((const uint8_t*)r->offset(), r->size(), buffer);
+		printf("%s %s: %ux%u %s\n", r->typeAsString().c_str(), r->name().c_str(), info.width, info.height,
+			   ok ? "decoded" : "failed");
+	}
+
+	printf("PNG export test:\n");
+
+	std::filesystem::create_directories("./png");
+	if(testfi.extractResource(testfi.findResource(std::string("2"), std::string(""), std::string("")), "./png", false, false, true) &&
+	   testfi.extractResource(testfi.findResource(std::string("14"), std::string(""), std::string("")), "./png", false, true, true))
+	{
+		size_t exported = 0, valid = 0;
+		for(auto &file : std::filesystem::directory_iterator("./png"))
+		{
+			std::vector<uint8_t> data(file.file_size());
+			FILE *f = fopen(file.path().c_str(), "rb");
+			if(f == nullptr)
+				continue;
+			data.resize(fread(data.data(), 1, data.size(), f));
+			fclose(f);
+			exported++;
+			wres::ImageInfo info;
+			if(!wres::read_image_info(data.data(), data.size(), &info) || info.format != wres::ContentType::PNG)
+				continue;
+			std::vector<uint8_t> pixels((size_t)info.width * info.height * 4);
+			wres::ImageBuffer buffer;
+			buffer.pixels = pixels.data();
+			buffer.width = info.width;
+			buffer.height = info.height;
+			buffer.stride = (size_t)info.width * 4;
+			valid += wres::decode_png(data.data(), data.size(), buffer);
+		}
+		printf("Exported %zu PNG files, %zu decode again\n", exported, valid);
+	}
+	else
+	{
+		printf("Export failure!\n");
+	}
+
+	printf("Thumbnail test:\n");
+
+	auto renderThumbnails = [](wres::WinLibrary &a, const std::vector<wres::WinResource*> &resources)
+	{
+		std::vector<wres::ThumbnailJob> jobs(resources.size());
+		std::vector<uint8_t> pixels(resources.size() * 48 * 48 * 4);
+		for(size_t i = 0; i < jobs.size(); i++)
+		{
+			jobs[i].resource = resources[i];
+			jobs[i].output.pixels = pixels.data() + i * 48 * 48 * 4;
+			jobs[i].output.width = 48;
+			jobs[i].output.height = 48;
+			jobs[i].output.stride = 48 * 4;
+		}
+		printf("Rendered %zu of %zu thumbnails\n", wres::render_thumbnails(a, jobs), jobs.size());
+	};
+	std::vector<wres::WinResource*> thumbResources;
+	for(auto r : testfi.collectResources(&testfi.root()))
+	{
+		if(r->type() == "2" || r->type() == "14")
+			thumbResources.push_back(r);
+	}
+	renderThumbnails(testfi, thumbResources);
+	thumbResources.clear();
+	for(auto &entry : imageIndex.entries())
+		thumbResources.push_back(entry.resource);
+	renderThumbnails(theme, thumbResources);
+
+#endif
 	/*
 
 	printf("Extracting raw data test:\n");
@@ -0,0 +1,212 @@
+#include "anicursor.h"
+#include "imageinfo.h"
+#include <string.h>
+#include <algorithm>
+
+namespace wres
+{
+
+#define ANI_HEADER_SIZE     36
+/* Sizes of the .ico/.cur file header and directory entries as stored */
+#define ICO_DIR_SIZE        6
+#define ICO_ENTRY_SIZE      16
+
+/* One chunk header of a RIFF stream */
+struct RiffChunk
+{
+    const uint8_t *id = nullptr;
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+};
+
+/*
+ * Reads the chunk at *pos and moves *pos past it and its pad byte. Returns
+ * false at the end of the data or if the chunk does not fit.
+ */
+static bool next_chunk(const uint8_t *data, size_t size, size_t *pos, RiffChunk *chunk)
+{
+    if (*pos + 8 > size)
+        return false;
+    size_t length = read_le32(data + *pos + 4);
+    if (length > size - *pos - 8)
+        return false;
+    chunk->id = data + *pos;
+    chunk->data = data + *pos + 8;
+    chunk->size = length;
+    *pos += 8 + length + (length & 1);
+    return true;
+}
+
+static bool is_fourcc(const uint8_t *id, const char *fourcc)
+{
+    return memcmp(id, fourcc, 4) == 0;
+}
+
+/* Bits per pixel of an image whose directory entry does not say */
+static uint16_t image_bit_count(const ImageInfo& info)
+{
+    // icon PNGs are 32 bit RGBA in practice
+    return info.format == ContentType::PNG ? 32 : info.bitDepth;
+}
+
+/* Returns an INFO string without its trailing null characters */
+static std::string_view info_string(const RiffChunk& chunk)
+{
+    size_t length = chunk.size;
+    while (length > 0 && chunk.data[length - 1] == 0)
+        length--;
+    return std::string_view((const char*)chunk.data, length);
+}
+
+bool AniCursor::parse(const uint8_t *data, size_t size)
+{
+    *this = AniCursor();
+    if (data == nullptr || size < 12 || !is_fourcc(data, "RIFF") || !is_fourcc(data + 8, "ACON"))
+        return false;
+    // the declared RIFF size may only shrink the data
+    size = std::min<size_t>(size, (size_t)read_le32(data + 4) + 8);
+
+    bool hasHeader = false;
+    RiffChunk chunk;
+    for (size_t pos = 12; next_chunk(data, size, &pos, &chunk); )
+    {
+        if (is_fourcc(chunk.id, "anih"))
+        {
+            if (chunk.size < ANI_HEADER_SIZE)
+                return false;
+            // cbSize is not checked, some writers leave it at 0
+            m_header.frames = read_le32(chunk.data + 4);
+            m_header.steps = read_le32(chunk.data + 8);
+            m_header.width = read_le32(chunk.data + 12);
+            m_header.height = read_le32(chunk.data + 16);
+            m_header.bitCount = read_le32(chunk.data + 20);
+            m_header.planes = read_le32(chunk.data + 24);
+            m_header.displayRate = read_le32(chunk.data + 28);
+            m_header.flags = read_le32(chunk.data + 32);
+            hasHeader = true;
+        }
+        else if (is_fourcc(chunk.id, "rate"))
+        {
+            m_rate = chunk.data;
+            m_rateCount = chunk.size / 4;
+        }
+        else if (is_fourcc(chunk.id, "seq "))
+        {
+            m_seq = chunk.data;
+            m_seqCount = chunk.size / 4;
+        }
+        else if (is_fourcc(chunk.id, "LIST") && chunk.size >= 4)
+        {
+            parse_list(chunk.data, chunk.size);
+        }
+    }
+    m_isValid = hasHeader && !m_frames.empty();
+    return m_isValid;
+}
+
+void AniCursor::parse_list(const uint8_t *data, size_t size)
+{
+    bool frames = is_fourcc(data, "fram");
+    bool info = is_fourcc(data, "INFO");
+    if (frames)
+        m_frames.reserve(std::min<size_t>(m_header.frames, (size - 4) / 8));
+    RiffChunk chunk;
+    for (size_t pos = 4; next_chunk(data, size, &pos, &chunk); )
+    {
+        if (frames && is_fourcc(chunk.id, "icon"))
+            m_frames.push_back({ chunk.data, chunk.size });
+        else if (info && is_fourcc(chunk.id, "INAM"))
+            m_title = info_string(chunk);
+        else if (info && is_fourcc(chunk.id, "IART"))
+            m_artist = info_string(chunk);
+    }
+}
+
+AniFrame AniCursor::frame(size_t i) const
+{
+    return i < m_frames.size() ? m_frames[i] : AniFrame();
+}
+
+size_t AniCursor::stepCount() const
+{
+    if (m_seq != nullptr)
+        return m_header.steps ? std::min<size_t>(m_header.steps, m_seqCount) : m_seqCount;
+    return m_header.steps ? std::min<size_t>(m_header.steps, m_frames.size()) : m_frames.size();
+}
+
+int AniCursor::frameForStep(size_t step) const
+{
+    if (step >= stepCount())
+        return -1;
+    size_t index = m_seq != nullptr ? read_le32(m_seq + step * 4) : step;
+    return index < m_frames.size() ? (int)index : -1;
+}
+
+uint32_t AniCursor::rate(size_t step) const
+{
+    return step < m_rateCount ? read_le32(m_rate + step * 4) : m_header.displayRate;
+}
+
+IconView AniCursor::selectFrameImage(size_t frame, int desiredSize, int dpi, int bitDepth) const
+{
+    IconView view;
+    if (frame >= m_frames.size() || desiredSize <= 0)
+        return view;
+    const uint8_t *data = m_frames[frame].data;
+    size_t size = m_frames[frame].size;
+    ImageInfo info;
+
+    if (!(m_header.flags & ANI_FLAG_ICON))
+    {
+        if (!read_image_info(data, size, &info, true))
+            return view;
+        view.data = data;
+        view.size = size;
+        view.bitCount = image_bit_count(info);
+    }
+    else
+    {
+        // an .ico or .cur file; the chunk may be unaligned, so read it bytewise
+        if (size < ICO_DIR_SIZE || read_le16(data) != 0)
+            return view;
+        uint16_t type = read_le16(data + 2);
+        if (type != 1 && type != 2)
+            return view;
+        size_t count = std::min<size_t>(read_le16(data + 4),
+                                        (size - ICO_DIR_SIZE) / ICO_ENTRY_SIZE);
+
+        IconMatcher matcher(desiredSize, dpi, bitDepth);
+        for (size_t i = 0; i < count; i++)
+        {
+            const uint8_t *entry = data + ICO_DIR_SIZE + i * ICO_ENTRY_SIZE;
+            // cursors keep their hotspot where icons keep the bit count
+            int bits = type == 1 ? read_le16(entry + offsetof(Win32CursorIconFileDirEntry, hotspot_y)) : 0;
+            matcher.offer((int)i, entry[offsetof(Win32CursorIconFileDirEntry, width)],
+                          entry[offsetof(Win32CursorIconFileDirEntry, height)],
+                          entry[offsetof(Win32CursorIconFileDirEntry, color_count)], bits);
+        }
+        if (matcher.best() < 0)
+            return view;
+
+        const uint8_t *entry = data + ICO_DIR_SIZE + matcher.best() * ICO_ENTRY_SIZE;
+        size_t dibSize = read_le32(entry + offsetof(Win32CursorIconFileDirEntry, dib_size));
+        size_t dibOffset = read_le32(entry + offsetof(Win32CursorIconFileDirEntry, dib_offset));
+        if (dibOffset > size || dibSize > size - dibOffset ||
+            !read_image_info(data + dibOffset, dibSize, &info, true))
+            return view;
+        view.data = data + dibOffset;
+        view.size = dibSize;
+        view.bitCount = matcher.bestBits() ? (uint16_t)matcher.bestBits() : image_bit_count(info);
+        if (type == 2)
+        {
+            view.hotspotX = read_le16(entry + offsetof(Win32CursorIconFileDirEntry, hotspot_x));
+            view.hotspotY = read_le16(entry + offsetof(Win32CursorIconFileDirEntry, hotspot_y));
+        }
+    }
+    view.format = info.format;
+    view.width = info.width;
+    view.height = info.height;
+    return view;
+}
+
+}
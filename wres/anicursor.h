@@ -0,0 +1,108 @@
+#ifndef ANICURSOR_H
+#define ANICURSOR_H
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+#include "winlibrary.h"
+
+namespace wres
+{
+
+/* Flags of the "anih" header */
+#define ANI_FLAG_ICON       0x1     /* frames are .ico/.cur files, raw DIBs otherwise */
+#define ANI_FLAG_SEQUENCE   0x2     /* the animation has a "seq " chunk */
+
+/* The "anih" chunk. Rates are in jiffies (1/60 s). */
+struct AniHeader
+{
+    uint32_t frames = 0;
+    uint32_t steps = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t bitCount = 0;
+    uint32_t planes = 0;
+    uint32_t displayRate = 0;
+    uint32_t flags = 0;
+};
+
+/* One "icon" chunk of the frame list, a view into the resource data */
+struct AniFrame
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    bool isValid() const { return data != nullptr; }
+};
+
+class AniCursor
+{
+public:
+    /*
+     * AniCursor indexes the RIFF "ACON" container of animated cursors and
+     * icons: RT_ANICURSOR and RT_ANIICON resources, or .ani files. Parsing
+     * walks the chunk headers once and keeps views of the "anih" header,
+     * the "rate" and "seq " arrays and the "icon" chunks of the "fram"
+     * list; no frame data is read or copied. Each frame is a complete .ico
+     * or .cur file, and selectFrameImage() picks one of its images as
+     * WinLibrary::selectIcon() does for icon groups, so a single frame can
+     * be decoded without extracting the whole animation.
+     *
+     * The data has to outlive the index.
+     */
+    AniCursor() = default;
+    AniCursor(const uint8_t *data, size_t size) { parse(data, size); }
+
+    /*
+     * Parses the given RIFF data. Returns false if it is not an "ACON"
+     * container, has no valid "anih" chunk or no frames. Chunks that
+     * exceed the data end the walk.
+     */
+    bool parse(const uint8_t *data, size_t size);
+    bool isValid() const { return m_isValid; }
+
+    const AniHeader& header() const { return m_header; }
+    /* "INAM" and "IART" of the "INFO" list, empty if missing */
+    std::string_view title() const { return m_title; }
+    std::string_view artist() const { return m_artist; }
+
+    size_t frameCount() const { return m_frames.size(); }
+    /* Returns an invalid frame if i is out of range */
+    AniFrame frame(size_t i) const;
+
+    /* Number of steps of one animation cycle */
+    size_t stepCount() const;
+    /*
+     * Returns the frame index shown at the given step, from the "seq "
+     * chunk if there is one; frames are shown in order otherwise. Returns
+     * -1 if the step is out of range or refers to a missing frame.
+     */
+    int frameForStep(size_t step) const;
+    /* Returns how long the given step is shown, in jiffies */
+    uint32_t rate(size_t step) const;
+
+    /*
+     * Picks the image of a frame that best fits desiredSize at the given
+     * dpi and bit depth and returns a view of it. Cursor images carry
+     * their hotspot. Frames that are raw DIBs are returned as a whole.
+     * Returns an invalid view if the frame is missing or malformed.
+     */
+    IconView selectFrameImage(size_t frame, int desiredSize, int dpi = 96, int bitDepth = 32) const;
+
+private:
+    bool m_isValid = false;
+    AniHeader m_header;
+    std::string_view m_title;
+    std::string_view m_artist;
+    std::vector<AniFrame> m_frames;
+    const uint8_t *m_rate = nullptr;
+    size_t m_rateCount = 0;
+    const uint8_t *m_seq = nullptr;
+    size_t m_seqCount = 0;
+
+    void parse_list(const uint8_t *data, size_t size);
+};
+
+}
+
+#endif // ANICURSOR_H
@@ -0,0 +1,89 @@
+#ifndef BOUNDEDSPAN_H
+#define BOUNDEDSPAN_H
+#include <stddef.h>
+#include <stdint.h>
+#include "wresutil.h"
+
+namespace wres
+{
+
+/* Bounds policy for untrusted data: every range is checked */
+struct CheckedBounds
+{
+    static constexpr bool checked = true;
+};
+
+/*
+ * Bounds policy for data that is known to be well formed (e.g. generated
+ * by the caller): range checks compile away and reads become raw loads.
+ */
+struct TrustedBounds
+{
+    static constexpr bool checked = false;
+};
+
+/*
+ * BoundedSpan is a view of a byte range that is validated once and then
+ * read without further checks. sub() and array() carve a range out of the
+ * span with a single bounds check, so a whole structure (e.g. a resource
+ * directory header, or all of its entries) is validated at once; the
+ * accessors of the resulting span are inlined and unchecked, and only
+ * valid within the range that was validated.
+ *
+ * An out of bounds range yields an invalid span, which the caller tests
+ * with isValid() before reading.
+ */
+template<class Policy = CheckedBounds>
+class BoundedSpan
+{
+public:
+    BoundedSpan() = default;
+    BoundedSpan(const void *data, size_t size) : m_data((const uint8_t*)data), m_size(size) {}
+
+    bool isValid() const { return m_data != nullptr; }
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    /* Returns [offset, offset + length), or an invalid span if it is out of bounds */
+    BoundedSpan sub(size_t offset, size_t length) const
+    {
+        if (Policy::checked && (m_data == nullptr || offset > m_size || length > m_size - offset))
+            return BoundedSpan();
+        return BoundedSpan(m_data + offset, length);
+    }
+
+    /* Returns count elements of type T at offset, or an invalid span */
+    template<class T>
+    BoundedSpan array(size_t offset, size_t count) const
+    {
+        if (Policy::checked && count > m_size / sizeof(T))
+            return BoundedSpan();
+        return sub(offset, count * sizeof(T));
+    }
+
+    /*
+     * Returns the offset of p within the span, or SIZE_MAX if it lies
+     * outside, which any following sub() rejects.
+     */
+    size_t offsetOf(const void *p) const
+    {
+        uintptr_t address = (uintptr_t)p, begin = (uintptr_t)m_data;
+        if (Policy::checked && (address < begin || address - begin > m_size))
+            return SIZE_MAX;
+        return address - begin;
+    }
+
+    /* Unchecked reads within the validated range */
+    template<class T>
+    const T& get(size_t index = 0) const { return ((const T*)m_data)[index]; }
+    uint16_t le16(size_t offset) const { return read_le16(m_data + offset); }
+    uint32_t le32(size_t offset) const { return read_le32(m_data + offset); }
+
+private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+}
+
+#endif // BOUNDEDSPAN_H
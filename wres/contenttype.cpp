@@ -0,0 +1,143 @@
+#include "contenttype.h"
+#include <string.h>
+#include <vector>
+
+namespace wres
+{
+
+/*
+ * A signature is a byte pattern anchored at the start of the data. Bytes
+ * whose mask character is not 'x' are ignored, which allows matching
+ * container formats (RIFF) and structures with variable fields (DIB).
+ */
+struct ContentSignature
+{
+    ContentType type;
+    size_t length;
+    const char *pattern;
+    const char *mask;
+};
+
+/* Longer, more specific signatures come first within the same first byte */
+static const ContentSignature content_signatures[] =
+{
+    { ContentType::PNG,       8,  "\x89PNG\r\n\x1a\n",         "xxxxxxxx" },
+    { ContentType::JPEG,      3,  "\xff\xd8\xff",              "xxx" },
+    { ContentType::GIF,       6,  "GIF87a",                    "xxxxxx" },
+    { ContentType::GIF,       6,  "GIF89a",                    "xxxxxx" },
+    { ContentType::ANI,       12, "RIFF\0\0\0\0ACON",          "xxxx....xxxx" },
+    { ContentType::WAV,       12, "RIFF\0\0\0\0WAVE",          "xxxx....xxxx" },
+    { ContentType::AVI,       12, "RIFF\0\0\0\0AVI ",          "xxxx....xxxx" },
+    { ContentType::RIFF,      4,  "RIFF",                      "xxxx" },
+    { ContentType::XML,       5,  "<?xml",                     "xxxxx" },
+    { ContentType::XML,       8,  "\xef\xbb\xbf<?xml",         "xxxxxxxx" },
+    { ContentType::XML,       12, "\xff\xfe<\0?\0x\0m\0l\0",   "xxxxxxxxxxxx" },
+    { ContentType::XML,       10, "<\0?\0x\0m\0l\0",           "xxxxxxxxxx" },
+    { ContentType::UTF16Text, 2,  "\xff\xfe",                  "xx" },
+    { ContentType::MUI,       4,  "\xcd\xfe\xcd\xfe",          "xxxx" },
+    { ContentType::ICO,       4,  "\0\0\1\0",                  "xxxx" },
+    { ContentType::CUR,       4,  "\0\0\2\0",                  "xxxx" },
+    { ContentType::BMP,       2,  "BM",                        "xx" },
+    { ContentType::PE,        2,  "MZ",                        "xx" },
+    /* BITMAPINFOHEADER and its V2-V5 variants: header size, then planes == 1 */
+    { ContentType::DIB,       14, "\x28\0\0\0\0\0\0\0\0\0\0\0\1\0", "xxxx........xx" },
+    { ContentType::DIB,       14, "\x34\0\0\0\0\0\0\0\0\0\0\0\1\0", "xxxx........xx" },
+    { ContentType::DIB,       14, "\x38\0\0\0\0\0\0\0\0\0\0\0\1\0", "xxxx........xx" },
+    { ContentType::DIB,       14, "\x6c\0\0\0\0\0\0\0\0\0\0\0\1\0", "xxxx........xx" },
+    { ContentType::DIB,       14, "\x7c\0\0\0\0\0\0\0\0\0\0\0\1\0", "xxxx........xx" },
+    /* BITMAPCOREHEADER: 16-bit dimensions, planes at offset 8 */
+    { ContentType::DIB,       10, "\x0c\0\0\0\0\0\0\0\1\0",    "xxxx....xx" },
+};
+
+#define CONTENT_SIGNATURE_COUNT (sizeof(content_signatures)/sizeof(ContentSignature))
+
+/* For every possible first byte, the signatures that may match */
+struct ContentSignatureIndex
+{
+    std::vector<const ContentSignature*> buckets[256];
+
+    ContentSignatureIndex()
+    {
+        for (size_t c = 0; c < CONTENT_SIGNATURE_COUNT; c++)
+        {
+            const ContentSignature *sig = &content_signatures[c];
+            buckets[(uint8_t)sig->pattern[0]].push_back(sig);
+        }
+    }
+};
+
+static const ContentSignatureIndex& signature_index()
+{
+    static const ContentSignatureIndex index;
+    return index;
+}
+
+static bool match_signature(const ContentSignature *sig, const uint8_t *data, size_t size)
+{
+    if (size < sig->length)
+        return false;
+    for (size_t c = 1; c < sig->length; c++)
+    {
+        if (sig->mask[c] == 'x' && data[c] != (uint8_t)sig->pattern[c])
+            return false;
+    }
+    return true;
+}
+
+ContentType classify_content(const uint8_t *data, size_t size)
+{
+    if (data == nullptr || size == 0)
+        return ContentType::Unknown;
+
+    for (const ContentSignature *sig : signature_index().buckets[data[0]])
+    {
+        if (match_signature(sig, data, size))
+            return sig->type;
+    }
+    return ContentType::Unknown;
+}
+
+const char *content_type_extension(ContentType type)
+{
+    switch (type)
+    {
+        case ContentType::PNG:       return ".png";
+        case ContentType::JPEG:      return ".jpg";
+        case ContentType::GIF:       return ".gif";
+        case ContentType::BMP:       return ".bmp";
+        case ContentType::ICO:       return ".ico";
+        case ContentType::CUR:       return ".cur";
+        case ContentType::ANI:       return ".ani";
+        case ContentType::WAV:       return ".wav";
+        case ContentType::AVI:       return ".avi";
+        case ContentType::XML:       return ".xml";
+        case ContentType::UTF16Text: return ".txt";
+        case ContentType::MUI:       return ".mui";
+        default:                     return "";
+    }
+}
+
+const char *content_type_to_string(ContentType type)
+{
+    switch (type)
+    {
+        case ContentType::PNG:       return "png";
+        case ContentType::JPEG:      return "jpeg";
+        case ContentType::GIF:       return "gif";
+        case ContentType::BMP:       return "bmp";
+        case ContentType::DIB:       return "dib";
+        case ContentType::ICO:       return "ico";
+        case ContentType::CUR:       return "cur";
+        case ContentType::RIFF:      return "riff";
+        case ContentType::ANI:       return "ani";
+        case ContentType::WAV:       return "wav";
+        case ContentType::AVI:       return "avi";
+        case ContentType::XML:       return "xml";
+        case ContentType::UTF16Text: return "utf16-text";
+        case ContentType::MUI:       return "mui";
+        case ContentType::PE:        return "pe";
+        default:                     return "unknown";
+    }
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef CONTENTTYPE_H
+#define CONTENTTYPE_H
+#include <stddef.h>
+#include <stdint.h>
+
+namespace wres
+{
+
+/*
+ * ContentType is the kind of payload a data resource holds, as detected
+ * from its first bytes rather than from its resource type. DIB is a bare
+ * BITMAPINFOHEADER/BITMAPCOREHEADER based bitmap without a file header, as
+ * stored in RT_BITMAP and RT_ICON resources.
+ */
+enum class ContentType : uint8_t
+{
+    Unknown = 0,
+    PNG,
+    JPEG,
+    GIF,
+    BMP,
+    DIB,
+    ICO,
+    CUR,
+    RIFF,
+    ANI,
+    WAV,
+    AVI,
+    XML,
+    UTF16Text,
+    MUI,
+    PE
+};
+
+/*
+ * Classifies a block of data by matching it against the known signatures.
+ * All signatures are matched in a single pass over the first bytes of the
+ * data: candidates are bucketed by their first byte, so only the handful
+ * of signatures that can match are compared.
+ */
+ContentType classify_content(const uint8_t *data, size_t size);
+
+/*
+ * Returns the file extension (including the dot) that files of the given
+ * content type should be written with, or an empty string if there is none.
+ */
+const char *content_type_extension(ContentType type);
+
+/*
+ * Returns a short human readable name of the content type.
+ */
+const char *content_type_to_string(ContentType type);
+
+}
+
+#endif // CONTENTTYPE_H
@@ -0,0 +1,619 @@
+#include "deflate.h"
+#include <string.h>
+#include <algorithm>
+
+namespace wres
+{
+
+#define DEFLATE_WINDOW_SIZE 32768
+#define DEFLATE_WINDOW_MASK (DEFLATE_WINDOW_SIZE - 1)
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_HASH_SIZE (1 << DEFLATE_HASH_BITS)
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+/* Hash chain links followed per position, and a match length that ends the search early */
+#define DEFLATE_MAX_CHAIN 32
+#define DEFLATE_NICE_MATCH 128
+/* A match this long is taken without trying a lazy match at the next position */
+#define DEFLATE_LAZY_LIMIT 32
+/* LZ77 symbols collected before a block is emitted */
+#define DEFLATE_BLOCK_SYMBOLS 16384
+#define DEFLATE_MAX_STORED 65535
+/* Positions are int32_t, so larger input is compressed in segments of this size */
+#define DEFLATE_MAX_SEGMENT (1 << 30)
+
+#define DEFLATE_LITLEN_CODES 288
+#define DEFLATE_DIST_CODES 30
+#define DEFLATE_CODELEN_CODES 19
+
+static const uint16_t length_base[29] =
+{
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] =
+{
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193,
+    12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] =
+{
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t code_length_order[19] =
+{
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/*
+ * Reverse lookups from match length and distance to their deflate codes.
+ * Distances up to 256 are looked up directly, longer ones by (dist - 1) >> 7.
+ */
+struct DeflateCodeTables
+{
+    uint8_t lengthCode[DEFLATE_MAX_MATCH + 1];
+    uint8_t distCodeSmall[256];
+    uint8_t distCodeLarge[256];
+
+    DeflateCodeTables()
+    {
+        for (int code = 0; code < 29; code++)
+        {
+            int end = code == 28 ? DEFLATE_MAX_MATCH + 1 : length_base[code + 1];
+            for (int len = length_base[code]; len < end; len++)
+                lengthCode[len] = (uint8_t)code;
+        }
+        // length 258 also fits code 27 (227 + 31), but has its own code
+        lengthCode[DEFLATE_MAX_MATCH] = 28;
+        for (int code = 0; code < 30; code++)
+        {
+            int end = code == 29 ? DEFLATE_WINDOW_SIZE + 1 : dist_base[code + 1];
+            for (int dist = dist_base[code]; dist < end; dist++)
+            {
+                if (dist <= 256)
+                    distCodeSmall[dist - 1] = (uint8_t)code;
+                else
+                    distCodeLarge[(dist - 1) >> 7] = (uint8_t)code;
+            }
+        }
+    }
+
+    inline int distCode(int dist) const
+    {
+        return dist <= 256 ? distCodeSmall[dist - 1] : distCodeLarge[(dist - 1) >> 7];
+    }
+};
+
+static const DeflateCodeTables& code_tables()
+{
+    static const DeflateCodeTables tables;
+    return tables;
+}
+
+/* A literal (dist == 0) or a match of length len at distance dist */
+struct DeflateSymbol
+{
+    uint16_t len;
+    uint16_t dist;
+};
+
+struct BitWriter
+{
+    std::vector<uint8_t> *out;
+    uint64_t bits;
+    int count;
+
+    /* n <= 32 */
+    inline void put(uint32_t value, int n)
+    {
+        bits |= (uint64_t)value << count;
+        count += n;
+        while (count >= 8)
+        {
+            out->push_back((uint8_t)bits);
+            bits >>= 8;
+            count -= 8;
+        }
+    }
+
+    inline void align()
+    {
+        if (count > 0)
+            put(0, 8 - count);
+    }
+};
+
+static inline uint32_t bit_reverse(uint32_t v, int bits)
+{
+    uint32_t r = 0;
+    for (int i = 0; i < bits; i++)
+    {
+        r = (r << 1) | (v & 1);
+        v >>= 1;
+    }
+    return r;
+}
+
+/*
+ * Computes Huffman code lengths of at most maxbits for the given symbol
+ * frequencies. The tree is built with the two-queue method on the leaves
+ * sorted by frequency; overlong codes are then clamped and the length
+ * counts repaired until the Kraft sum is exact again, shortest codes going
+ * to the most frequent symbols.
+ */
+static void build_code_lengths(const uint32_t *freq, int num, int maxbits, uint8_t *lengths)
+{
+    int syms[DEFLATE_LITLEN_CODES];
+    uint32_t weight[2 * DEFLATE_LITLEN_CODES];
+    int parent[2 * DEFLATE_LITLEN_CODES];
+    int depth[2 * DEFLATE_LITLEN_CODES];
+    int count = 0;
+
+    memset(lengths, 0, num);
+    for (int i = 0; i < num; i++)
+    {
+        if (freq[i])
+            syms[count++] = i;
+    }
+    if (count == 0)
+        return;
+    if (count == 1)
+    {
+        lengths[syms[0]] = 1;
+        return;
+    }
+    std::stable_sort(syms, syms + count, [freq](int a, int b) { return freq[a] < freq[b]; });
+
+    for (int i = 0; i < count; i++)
+        weight[i] = freq[syms[i]];
+    int leaf = 0, node = count, next = count;
+    for (int k = 0; k < count - 1; k++)
+    {
+        int pick[2];
+        for (int j = 0; j < 2; j++)
+        {
+            if (leaf < count && (node >= next || weight[leaf] <= weight[node]))
+                pick[j] = leaf++;
+            else
+                pick[j] = node++;
+        }
+        weight[next] = weight[pick[0]] + weight[pick[1]];
+        parent[pick[0]] = parent[pick[1]] = next;
+        next++;
+    }
+    depth[next - 1] = 0;
+    for (int i = next - 2; i >= 0; i--)
+        depth[i] = depth[parent[i]] + 1;
+
+    int numcodes[32];
+    memset(numcodes, 0, sizeof(numcodes));
+    for (int i = 0; i < count; i++)
+        numcodes[std::min(depth[i], maxbits)]++;
+    uint32_t total = 0;
+    for (int i = 1; i <= maxbits; i++)
+        total += (uint32_t)numcodes[i] << (maxbits - i);
+    while (total != (1u << maxbits))
+    {
+        numcodes[maxbits]--;
+        for (int i = maxbits - 1; i > 0; i--)
+        {
+            if (numcodes[i])
+            {
+                numcodes[i]--;
+                numcodes[i + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+
+    int index = 0;
+    for (int len = maxbits; len > 0; len--)
+    {
+        for (int i = 0; i < numcodes[len]; i++)
+            lengths[syms[index++]] = (uint8_t)len;
+    }
+}
+
+/* Canonical codes for the given lengths, bit reversed for LSB first output */
+static void build_codes(const uint8_t *lengths, int num, uint16_t *codes)
+{
+    int counts[16], next_code[16];
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < num; i++)
+        counts[lengths[i]]++;
+    counts[0] = 0;
+    int code = 0;
+    for (int len = 1; len < 16; len++)
+    {
+        code = (code + counts[len - 1]) << 1;
+        next_code[len] = code;
+    }
+    for (int i = 0; i < num; i++)
+    {
+        if (lengths[i])
+            codes[i] = (uint16_t)bit_reverse(next_code[lengths[i]]++, lengths[i]);
+    }
+}
+
+/*
+ * Makes sure a code has at least two symbols, so that the resulting tree is
+ * complete; some decoders reject single-code trees.
+ */
+static void ensure_two_symbols(uint32_t *freq, int num)
+{
+    int used = 0;
+    for (int i = 0; i < num && used < 2; i++)
+        used += freq[i] != 0;
+    for (int i = 0; i < num && used < 2; i++)
+    {
+        if (!freq[i])
+        {
+            freq[i] = 1;
+            used++;
+        }
+    }
+}
+
+struct DeflateState
+{
+    int32_t head[DEFLATE_HASH_SIZE];
+    int32_t prev[DEFLATE_WINDOW_SIZE];
+    DeflateSymbol symbols[DEFLATE_BLOCK_SYMBOLS];
+};
+
+static inline uint32_t hash3(const uint8_t *p)
+{
+    uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+    return (v * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+static inline int match_length(const uint8_t *a, const uint8_t *b, int limit)
+{
+    int len = 0;
+    while (len + 8 <= limit)
+    {
+        uint64_t x, y;
+        memcpy(&x, a + len, 8);
+        memcpy(&y, b + len, 8);
+        uint64_t diff = x ^ y;
+        if (diff)
+        {
+#if defined(__GNUC__) && !defined(WORDS_BIGENDIAN)
+            return len + (__builtin_ctzll(diff) >> 3);
+#else
+            break;
+#endif
+        }
+        len += 8;
+    }
+    while (len < limit && a[len] == b[len])
+        len++;
+    return len;
+}
+
+/* Inserts position pos (relative to data) into the hash chains */
+static inline void insert_hash(DeflateState *s, const uint8_t *data, int32_t pos)
+{
+    uint32_t h = hash3(data + pos);
+    s->prev[pos & DEFLATE_WINDOW_MASK] = s->head[h];
+    s->head[h] = pos;
+}
+
+/* Longest match for pos; pos must already be inserted. Returns its length, or 0 */
+static int find_match(const DeflateState *s, const uint8_t *data, size_t size, int32_t pos, int *dist)
+{
+    int limit = (int)std::min<size_t>(DEFLATE_MAX_MATCH, size - pos);
+    if (limit < DEFLATE_MIN_MATCH)
+        return 0;
+    int best = DEFLATE_MIN_MATCH - 1;
+    int32_t cand = s->prev[pos & DEFLATE_WINDOW_MASK];
+    int32_t lowest = pos - DEFLATE_WINDOW_SIZE;
+    const uint8_t *cur = data + pos;
+    for (int chain = DEFLATE_MAX_CHAIN; chain > 0 && cand >= 0 && cand > lowest; chain--)
+    {
+        const uint8_t *m = data + cand;
+        // the byte just past the current best has to match to do better
+        if (m[best] == cur[best] && m[0] == cur[0])
+        {
+            int len = match_length(m, cur, limit);
+            if (len > best)
+            {
+                best = len;
+                *dist = pos - cand;
+                if (len >= DEFLATE_NICE_MATCH || len == limit)
+                    break;
+            }
+        }
+        int32_t next = s->prev[cand & DEFLATE_WINDOW_MASK];
+        if (next >= cand)
+            break;
+        cand = next;
+    }
+    return best >= DEFLATE_MIN_MATCH ? best : 0;
+}
+
+static void write_stored(BitWriter& bw, const uint8_t *data, size_t size, bool final)
+{
+    do
+    {
+        size_t chunk = std::min<size_t>(size, DEFLATE_MAX_STORED);
+        bool last = final && chunk == size;
+        bw.put(last ? 1 : 0, 3);
+        bw.align();
+        bw.put((uint32_t)chunk, 16);
+        bw.put((uint32_t)~chunk & 0xffff, 16);
+        bw.out->insert(bw.out->end(), data, data + chunk);
+        data += chunk;
+        size -= chunk;
+    } while (size > 0);
+}
+
+/*
+ * Emits the symbols covering data[0, size) as one dynamic Huffman block,
+ * or as stored blocks if those come out smaller.
+ */
+static void write_block(BitWriter& bw, const DeflateSymbol *symbols, size_t count,
+                        const uint8_t *data, size_t size, bool final)
+{
+    const DeflateCodeTables& tables = code_tables();
+    uint32_t litfreq[DEFLATE_LITLEN_CODES], distfreq[DEFLATE_DIST_CODES];
+    memset(litfreq, 0, sizeof(litfreq));
+    memset(distfreq, 0, sizeof(distfreq));
+    for (size_t i = 0; i < count; i++)
+    {
+        if (symbols[i].dist == 0)
+            litfreq[symbols[i].len]++;
+        else
+        {
+            litfreq[257 + tables.lengthCode[symbols[i].len]]++;
+            distfreq[tables.distCode(symbols[i].dist)]++;
+        }
+    }
+    litfreq[256] = 1;
+    ensure_two_symbols(litfreq, 286);
+    ensure_two_symbols(distfreq, DEFLATE_DIST_CODES);
+
+    uint8_t lengths[286 + DEFLATE_DIST_CODES];
+    uint8_t *litlen = lengths, *distlen = lengths + 286;
+    build_code_lengths(litfreq, 286, 15, litlen);
+    build_code_lengths(distfreq, DEFLATE_DIST_CODES, 15, distlen);
+    int hlit = 286, hdist = DEFLATE_DIST_CODES;
+    while (hlit > 257 && litlen[hlit - 1] == 0)
+        hlit--;
+    while (hdist > 1 && distlen[hdist - 1] == 0)
+        hdist--;
+    // the two code length sequences are run length encoded as one
+    uint8_t merged[286 + DEFLATE_DIST_CODES];
+    memcpy(merged, litlen, hlit);
+    memcpy(merged + hlit, distlen, hdist);
+    int total = hlit + hdist;
+
+    // run length encoding: values 0-15, 16 = repeat previous 3-6,
+    // 17 = 3-10 zeros, 18 = 11-138 zeros; extra bits in the high byte
+    uint16_t rle[286 + DEFLATE_DIST_CODES];
+    int rlecount = 0;
+    uint32_t clfreq[DEFLATE_CODELEN_CODES];
+    memset(clfreq, 0, sizeof(clfreq));
+    for (int i = 0; i < total;)
+    {
+        uint8_t len = merged[i];
+        int run = 1;
+        while (i + run < total && merged[i + run] == len)
+            run++;
+        i += run;
+        if (len == 0)
+        {
+            while (run >= 11)
+            {
+                int n = std::min(run, 138);
+                rle[rlecount++] = (uint16_t)(18 | ((n - 11) << 8));
+                clfreq[18]++;
+                run -= n;
+            }
+            if (run >= 3)
+            {
+                rle[rlecount++] = (uint16_t)(17 | ((run - 3) << 8));
+                clfreq[17]++;
+                run = 0;
+            }
+        }
+        else
+        {
+            rle[rlecount++] = len;
+            clfreq[len]++;
+            run--;
+            while (run >= 3)
+            {
+                int n = std::min(run, 6);
+                rle[rlecount++] = (uint16_t)(16 | ((n - 3) << 8));
+                clfreq[16]++;
+                run -= n;
+            }
+        }
+        while (run-- > 0)
+        {
+            rle[rlecount++] = len;
+            clfreq[len]++;
+        }
+    }
+    ensure_two_symbols(clfreq, DEFLATE_CODELEN_CODES);
+    uint8_t cllen[DEFLATE_CODELEN_CODES];
+    build_code_lengths(clfreq, DEFLATE_CODELEN_CODES, 7, cllen);
+    int hclen = DEFLATE_CODELEN_CODES;
+    while (hclen > 4 && cllen[code_length_order[hclen - 1]] == 0)
+        hclen--;
+
+    // compare the size of the dynamic block against storing the data
+    static const uint8_t clextra[DEFLATE_CODELEN_CODES] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 3, 7};
+    uint64_t dynbits = 3 + 5 + 5 + 4 + 3 * hclen;
+    for (int i = 0; i < DEFLATE_CODELEN_CODES; i++)
+        dynbits += (uint64_t)clfreq[i] * (cllen[i] + clextra[i]);
+    for (int i = 0; i < 286; i++)
+        dynbits += (uint64_t)litfreq[i] * litlen[i];
+    for (int i = 0; i < 29; i++)
+        dynbits += (uint64_t)litfreq[257 + i] * length_extra[i];
+    for (int i = 0; i < DEFLATE_DIST_CODES; i++)
+        dynbits += (uint64_t)distfreq[i] * (distlen[i] + dist_extra[i]);
+    uint64_t storedbits = ((uint64_t)size + 5 * (size / DEFLATE_MAX_STORED + 1)) * 8 + 7;
+    if (storedbits < dynbits)
+    {
+        write_stored(bw, data, size, final);
+        return;
+    }
+
+    uint16_t litcodes[286], distcodes[DEFLATE_DIST_CODES], clcodes[DEFLATE_CODELEN_CODES];
+    build_codes(litlen, hlit, litcodes);
+    build_codes(distlen, hdist, distcodes);
+    build_codes(cllen, DEFLATE_CODELEN_CODES, clcodes);
+
+    bw.put(final ? 1 : 0, 1);
+    bw.put(2, 2);
+    bw.put(hlit - 257, 5);
+    bw.put(hdist - 1, 5);
+    bw.put(hclen - 4, 4);
+    for (int i = 0; i < hclen; i++)
+        bw.put(cllen[code_length_order[i]], 3);
+    for (int i = 0; i < rlecount; i++)
+    {
+        int sym = rle[i] & 0xff;
+        bw.put(clcodes[sym], cllen[sym]);
+        if (sym >= 16)
+            bw.put(rle[i] >> 8, clextra[sym]);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const DeflateSymbol& sym = symbols[i];
+        if (sym.dist == 0)
+        {
+            bw.put(litcodes[sym.len], litlen[sym.len]);
+            continue;
+        }
+        int lc = tables.lengthCode[sym.len];
+        bw.put(litcodes[257 + lc], litlen[257 + lc]);
+        if (length_extra[lc])
+            bw.put(sym.len - length_base[lc], length_extra[lc]);
+        int dc = tables.distCode(sym.dist);
+        bw.put(distcodes[dc], distlen[dc]);
+        if (dist_extra[dc])
+            bw.put(sym.dist - dist_base[dc], dist_extra[dc]);
+    }
+    bw.put(litcodes[256], litlen[256]);
+}
+
+static void deflate_segment(const uint8_t *data, size_t size, bool final, std::vector<uint8_t>& out)
+{
+    // the state is large (about 330k); keep one per thread
+    thread_local std::vector<DeflateState> state_storage(1);
+    DeflateState *s = state_storage.data();
+    for (int i = 0; i < DEFLATE_HASH_SIZE; i++)
+        s->head[i] = -1;
+
+    BitWriter bw = {&out, 0, 0};
+    out.reserve(out.size() + size / 2 + 64);
+
+    size_t count = 0;
+    size_t blockStart = 0;
+    int32_t pos = 0;
+    int32_t end = (int32_t)size;
+    // the byte at pos - 1 is not emitted yet; prevLen is the match found there
+    bool pending = false;
+    int prevLen = 0, prevDist = 0;
+
+    auto flush = [&](size_t blockEnd, bool last)
+    {
+        write_block(bw, s->symbols, count, data + blockStart, blockEnd - blockStart, last);
+        count = 0;
+        blockStart = blockEnd;
+    };
+
+    while (pos < end)
+    {
+        int len = 0, dist = 0;
+        if (pos + DEFLATE_MIN_MATCH <= end)
+        {
+            insert_hash(s, data, pos);
+            if (!pending || prevLen < DEFLATE_LAZY_LIMIT)
+                len = find_match(s, data, end, pos, &dist);
+        }
+
+        if (pending && prevLen >= DEFLATE_MIN_MATCH && len <= prevLen)
+        {
+            s->symbols[count++] = {(uint16_t)prevLen, (uint16_t)prevDist};
+            int32_t matchEnd = pos - 1 + prevLen;
+            for (pos++; pos < matchEnd; pos++)
+            {
+                if (pos + DEFLATE_MIN_MATCH <= end)
+                    insert_hash(s, data, pos);
+            }
+            pending = false;
+        }
+        else
+        {
+            if (pending)
+                s->symbols[count++] = {data[pos - 1], 0};
+            pending = true;
+            prevLen = len;
+            prevDist = dist;
+            pos++;
+        }
+
+        if (count == DEFLATE_BLOCK_SYMBOLS)
+            flush(pending ? pos - 1 : pos, false);
+    }
+    // a pending match always ends before the data does, so this is a literal
+    if (pending)
+        s->symbols[count++] = {data[pos - 1], 0};
+
+    flush(pos, final);
+    if (!final)
+    {
+        // empty stored block to end on a byte boundary
+        bw.put(0, 3);
+        bw.align();
+        bw.put(0, 16);
+        bw.put(0xffff, 16);
+    }
+    bw.align();
+}
+
+void deflate_raw(const uint8_t *data, size_t size, bool final, std::vector<uint8_t>& out)
+{
+    // non-final segments end on a byte boundary, so they can follow each other
+    while (size > DEFLATE_MAX_SEGMENT)
+    {
+        deflate_segment(data, DEFLATE_MAX_SEGMENT, false, out);
+        data += DEFLATE_MAX_SEGMENT;
+        size -= DEFLATE_MAX_SEGMENT;
+    }
+    deflate_segment(data, size, final, out);
+}
+
+uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t size2)
+{
+    const uint32_t base = 65521;
+    uint32_t rem = (uint32_t)(size2 % base);
+    uint32_t sum1 = adler1 & 0xffff;
+    uint32_t sum2 = (uint32_t)(((uint64_t)rem * sum1) % base);
+    sum1 += (adler2 & 0xffff) + base - 1;
+    sum2 += (adler1 >> 16) + (adler2 >> 16) + base - rem;
+    if (sum1 >= base)
+        sum1 -= base;
+    if (sum1 >= base)
+        sum1 -= base;
+    if (sum2 >= 2 * base)
+        sum2 -= 2 * base;
+    if (sum2 >= base)
+        sum2 -= base;
+    return sum1 | (sum2 << 16);
+}
+
+}
@@ -0,0 +1,32 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace wres
+{
+
+/*
+ * Compresses data as raw deflate (RFC 1951) blocks, appending them to out.
+ * Matches are searched with hash chains and one step of lazy evaluation;
+ * every block gets its own dynamic Huffman codes, or is stored if that is
+ * smaller.
+ *
+ * If final is set, the last block is marked as such. Otherwise the output
+ * ends with an empty stored block, which aligns it to a byte boundary so
+ * that independently compressed pieces can simply be concatenated (as done
+ * by the parallel PNG encoder). No history is shared between calls, nor
+ * between the 1 GiB segments that larger input is split into.
+ */
+void deflate_raw(const uint8_t *data, size_t size, bool final, std::vector<uint8_t>& out);
+
+/*
+ * Combines the Adler-32 checksums of two consecutive pieces of data, where
+ * the second piece is size2 bytes long.
+ */
+uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t size2);
+
+}
+
+#endif // DEFLATE_H
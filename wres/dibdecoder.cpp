@@ -0,0 +1,527 @@
+#include "dibdecoder.h"
+#include "contenttype.h"
+#include "pngdecoder.h"
+#include "wresutil.h"
+#include "win32-endian.h"
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace wres
+{
+
+/*
+ * A parsed DIB header. pixels points to the first stored row, which is the
+ * bottom row of the image unless topDown is set.
+ */
+struct DibImage
+{
+    int32_t width;
+    int32_t height;
+    bool topDown;
+    uint16_t bitCount;
+    uint32_t compression;
+    const uint8_t *palette;
+    size_t paletteEntrySize;
+    uint32_t paletteCount;
+    uint32_t masks[4];
+    bool hasAlphaMask;
+    const uint8_t *pixels;
+    size_t pixelsSize;
+};
+
+/* Channel extraction for BI_BITFIELDS and 16-bit BI_RGB */
+struct DibChannel
+{
+    uint32_t mask;
+    int shift;
+    int bits;
+};
+
+static inline size_t dib_row_bytes(uint32_t width, unsigned bitCount)
+{
+    return (((uint64_t)width * bitCount + 31) / 32) * 4;
+}
+
+static DibChannel make_channel(uint32_t mask)
+{
+    DibChannel c = { mask, 0, 0 };
+    if (mask == 0)
+        return c;
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        c.shift++;
+    }
+    while (mask & 1)
+    {
+        mask >>= 1;
+        c.bits++;
+    }
+    return c;
+}
+
+static inline uint8_t channel_value(const DibChannel& c, uint32_t v)
+{
+    if (c.bits == 0)
+        return 0;
+    uint32_t x = (v & c.mask) >> c.shift;
+    if (c.bits >= 8)
+        return (uint8_t)(x >> (c.bits - 8));
+    /* scale up so that the maximum maps to 255 */
+    return (uint8_t)((x * 255 + ((1u << c.bits) - 1) / 2) / ((1u << c.bits) - 1));
+}
+
+/* Parses the DIB at data. pixel_offset, if nonzero, is where the pixels
+ * start relative to data (from a BMP file header). */
+static bool parse_dib(const uint8_t *data, size_t size, size_t pixel_offset, DibImage *dib)
+{
+    if (size < 12)
+        return false;
+
+    uint32_t header_size = read_le32(data);
+    memset(dib, 0, sizeof(*dib));
+
+    if (header_size == 12)
+    {
+        dib->width = read_le16(data + 4);
+        dib->height = (int16_t)read_le16(data + 6);
+        dib->bitCount = read_le16(data + 10);
+        dib->compression = BI_RGB;
+        dib->paletteEntrySize = 3;
+    }
+    else if (header_size >= sizeof(Win32BitmapInfoHeader) && header_size <= size)
+    {
+        Win32BitmapInfoHeader info;
+        memcpy(&info, data, sizeof(info));
+        fix_win32_bitmap_info_header_endian(&info);
+        dib->width = info.width;
+        dib->height = info.height;
+        dib->bitCount = info.bit_count;
+        dib->compression = info.compression;
+        dib->paletteCount = info.clr_used;
+        dib->paletteEntrySize = 4;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (dib->width <= 0 || dib->height == 0 || dib->height == INT32_MIN || dib->width > 0x100000)
+        return false;
+    dib->topDown = dib->height < 0;
+    if (dib->topDown)
+        dib->height = -dib->height;
+
+    size_t offset = header_size;
+    if (dib->compression == BI_BITFIELDS)
+    {
+        /* masks are part of V2+ headers, or follow a plain info header */
+        size_t mask_offset = header_size == sizeof(Win32BitmapInfoHeader) ? header_size : sizeof(Win32BitmapInfoHeader);
+        if (mask_offset + 12 > size)
+            return false;
+        for (int i = 0; i < 3; i++)
+            dib->masks[i] = read_le32(data + mask_offset + i * 4);
+        if (header_size >= 56 && mask_offset + 16 <= size)
+        {
+            dib->masks[3] = read_le32(data + mask_offset + 12);
+            dib->hasAlphaMask = dib->masks[3] != 0;
+        }
+        if (header_size == sizeof(Win32BitmapInfoHeader))
+            offset += 12;
+    }
+    else if (dib->compression == BI_RGB && dib->bitCount == 16)
+    {
+        dib->masks[0] = 0x7C00;
+        dib->masks[1] = 0x03E0;
+        dib->masks[2] = 0x001F;
+    }
+    else if (dib->compression != BI_RGB && dib->compression != BI_RLE8 && dib->compression != BI_RLE4)
+    {
+        return false;
+    }
+
+    switch (dib->bitCount)
+    {
+        case 1: case 4: case 8:
+            if (dib->paletteCount == 0 || dib->paletteCount > (1u << dib->bitCount))
+                dib->paletteCount = 1u << dib->bitCount;
+            break;
+        case 16: case 24: case 32:
+            /* an optional palette may still be present for optimization */
+            if (dib->paletteCount > 256)
+                return false;
+            break;
+        default:
+            return false;
+    }
+    if ((dib->compression == BI_RLE8 && dib->bitCount != 8)
+        || (dib->compression == BI_RLE4 && dib->bitCount != 4)
+        || (dib->compression == BI_BITFIELDS && dib->bitCount != 16 && dib->bitCount != 32))
+        return false;
+
+    if (offset + dib->paletteCount * dib->paletteEntrySize > size)
+        return false;
+    dib->palette = data + offset;
+    offset += dib->paletteCount * dib->paletteEntrySize;
+
+    if (pixel_offset != 0)
+        offset = pixel_offset;
+    if (offset > size)
+        return false;
+    dib->pixels = data + offset;
+    dib->pixelsSize = size - offset;
+    return true;
+}
+
+static void build_palette_lut(const DibImage& dib, uint32_t *lut, PixelFormat format)
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint8_t *px = (uint8_t*)&lut[i];
+        if (i < dib.paletteCount)
+        {
+            const uint8_t *q = dib.palette + i * dib.paletteEntrySize;
+            store_pixel(px, q[2], q[1], q[0], 255, format, false);
+        }
+        else
+        {
+            store_pixel(px, 0, 0, 0, 255, format, false);
+        }
+    }
+}
+
+static void expand_1bpp(const uint8_t *src, uint8_t *dst, uint32_t width, const uint32_t *lut)
+{
+    uint32_t x = 0;
+#if defined(__SSE2__)
+    /* select between the two colors with per-pixel masks built from the bits */
+    const __m128i c0 = _mm_set1_epi32((int)lut[0]);
+    const __m128i c1 = _mm_set1_epi32((int)lut[1]);
+    const __m128i bits_hi = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+    const __m128i bits_lo = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i v = _mm_set1_epi32(src[x >> 3]);
+        __m128i m0 = _mm_cmpeq_epi32(_mm_and_si128(v, bits_hi), bits_hi);
+        __m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(v, bits_lo), bits_lo);
+        _mm_storeu_si128((__m128i*)(dst + x * 4), _mm_or_si128(_mm_and_si128(m0, c1), _mm_andnot_si128(m0, c0)));
+        _mm_storeu_si128((__m128i*)(dst + x * 4 + 16), _mm_or_si128(_mm_and_si128(m1, c1), _mm_andnot_si128(m1, c0)));
+    }
+#endif
+    for (; x < width; x++)
+    {
+        unsigned bit = (src[x >> 3] >> (7 - (x & 7))) & 1;
+        memcpy(dst + x * 4, &lut[bit], 4);
+    }
+}
+
+static void expand_4bpp(const uint8_t *src, uint8_t *dst, uint32_t width, const uint64_t *pairs, const uint32_t *lut)
+{
+    uint32_t x = 0;
+    /* one lookup produces both pixels of a byte */
+    for (; x + 2 <= width; x += 2)
+        memcpy(dst + x * 4, &pairs[src[x >> 1]], 8);
+    if (x < width)
+        memcpy(dst + x * 4, &lut[src[x >> 1] >> 4], 4);
+}
+
+static void expand_8bpp(const uint8_t *src, uint8_t *dst, uint32_t width, const uint32_t *lut)
+{
+    for (uint32_t x = 0; x < width; x++)
+        memcpy(dst + x * 4, &lut[src[x]], 4);
+}
+
+static void expand_24bpp(const uint8_t *src, uint8_t *dst, uint32_t width, PixelFormat format)
+{
+    for (uint32_t x = 0; x < width; x++, src += 3)
+    {
+        if (format == PixelFormat::BGRA)
+        {
+            dst[x * 4] = src[0];
+            dst[x * 4 + 2] = src[2];
+        }
+        else
+        {
+            dst[x * 4] = src[2];
+            dst[x * 4 + 2] = src[0];
+        }
+        dst[x * 4 + 1] = src[1];
+        dst[x * 4 + 3] = 255;
+    }
+}
+
+/* 32-bit BI_RGB without alpha: copy (swizzled) and force alpha to 255 */
+static void expand_32bpp_opaque(const uint8_t *src, uint8_t *dst, uint32_t width, PixelFormat format)
+{
+    uint32_t x = 0;
+    bool swap = format == PixelFormat::RGBA;
+#if defined(__SSE2__)
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + x * 4));
+        _mm_storeu_si128((__m128i*)(dst + x * 4), _mm_or_si128(px, alpha));
+    }
+    if (swap)
+        convert_pixels_32(dst, dst, x, true, false);
+#endif
+    for (; x < width; x++)
+    {
+        const uint8_t *s = src + x * 4;
+        store_pixel(dst + x * 4, s[2], s[1], s[0], 255, format, false);
+    }
+}
+
+static void expand_bitfields(const uint8_t *src, uint8_t *dst, uint32_t width, unsigned bitCount,
+                             const DibChannel *channels, bool alpha, PixelFormat format, bool premultiplied)
+{
+    for (uint32_t x = 0; x < width; x++)
+    {
+        uint32_t v = bitCount == 16 ? read_le16(src + x * 2) : read_le32(src + x * 4);
+        uint8_t a = alpha ? channel_value(channels[3], v) : 255;
+        store_pixel(dst + x * 4, channel_value(channels[0], v), channel_value(channels[1], v),
+                    channel_value(channels[2], v), a, format, premultiplied);
+    }
+}
+
+static bool has_alpha_32bpp(const DibImage& dib, uint32_t rows)
+{
+    size_t row_bytes = dib_row_bytes(dib.width, 32);
+    for (uint32_t y = 0; y < rows; y++)
+    {
+        const uint8_t *row = dib.pixels + y * row_bytes;
+        for (int32_t x = 0; x < dib.width; x++)
+        {
+            if (row[x * 4 + 3] != 0)
+                return true;
+        }
+    }
+    return false;
+}
+
+static inline uint8_t *dest_row(const ImageBuffer& out, const DibImage& dib, uint32_t rows, uint32_t y)
+{
+    /* stored row y goes to the top of the image in top-down bitmaps */
+    return out.pixels + (dib.topDown ? y : rows - 1 - y) * out.stride;
+}
+
+/* Runs a run-length encoded bitmap; pixels not covered stay transparent */
+static bool decode_rle(const DibImage& dib, const ImageBuffer& out, uint32_t rows, const uint32_t *lut)
+{
+    const uint8_t *p = dib.pixels;
+    const uint8_t *end = dib.pixels + dib.pixelsSize;
+    uint32_t width = dib.width;
+    uint32_t x = 0, y = 0;
+    bool rle4 = dib.compression == BI_RLE4;
+
+    for (uint32_t r = 0; r < rows; r++)
+        memset(out.pixels + r * out.stride, 0, (size_t)width * 4);
+
+    auto put = [&](unsigned index)
+    {
+        if (x < width && y < rows)
+            memcpy(dest_row(out, dib, rows, y) + x * 4, &lut[index], 4);
+        x++;
+    };
+
+    while (end - p >= 2)
+    {
+        uint8_t count = p[0];
+        uint8_t value = p[1];
+        p += 2;
+        if (count > 0)
+        {
+            for (unsigned i = 0; i < count; i++)
+                put(rle4 ? ((i & 1) ? value & 0x0F : value >> 4) : value);
+            continue;
+        }
+        switch (value)
+        {
+            case 0:
+                x = 0;
+                y++;
+                break;
+            case 1:
+                return true;
+            case 2:
+                if (end - p < 2)
+                    return false;
+                x += p[0];
+                y += p[1];
+                p += 2;
+                break;
+            default:
+            {
+                /* absolute mode, padded to a 16-bit boundary */
+                size_t bytes = rle4 ? (value + 1) / 2 : value;
+                if ((size_t)(end - p) < bytes)
+                    return false;
+                for (unsigned i = 0; i < value; i++)
+                    put(rle4 ? ((i & 1) ? p[i / 2] & 0x0F : p[i / 2] >> 4) : p[i]);
+                p += (bytes + 1) & ~(size_t)1;
+                break;
+            }
+        }
+        if (y >= rows)
+            return true;
+    }
+    /* some encoders omit the end-of-bitmap marker */
+    return true;
+}
+
+/*
+ * Decodes the first rows stored rows of dib. For icons, rows is half the
+ * header height. Returns false on malformed data.
+ */
+static bool decode_dib_rows(const DibImage& dib, const ImageBuffer& out, uint32_t rows, bool *has_alpha)
+{
+    uint32_t width = dib.width;
+    uint32_t lut[256];
+    *has_alpha = false;
+
+    if (out.pixels == nullptr || out.width != width || out.height != rows || out.stride < (size_t)width * 4)
+        return false;
+
+    if (dib.bitCount <= 8)
+        build_palette_lut(dib, lut, out.format);
+
+    if (dib.compression == BI_RLE8 || dib.compression == BI_RLE4)
+    {
+        *has_alpha = true;
+        return decode_rle(dib, out, rows, lut);
+    }
+
+    size_t row_bytes = dib_row_bytes(width, dib.bitCount);
+    if (row_bytes * rows > dib.pixelsSize)
+        return false;
+
+    DibChannel channels[4];
+    uint64_t pairs[256];
+    bool alpha = false;
+
+    if (dib.bitCount == 4)
+    {
+        /* the high nibble is the left pixel and must come first in memory */
+        for (unsigned i = 0; i < 256; i++)
+        {
+#if WORDS_BIGENDIAN
+            pairs[i] = ((uint64_t)lut[i >> 4] << 32) | lut[i & 0x0F];
+#else
+            pairs[i] = (uint64_t)lut[i >> 4] | ((uint64_t)lut[i & 0x0F] << 32);
+#endif
+        }
+    }
+    else if (dib.bitCount == 16 || dib.compression == BI_BITFIELDS)
+    {
+        for (int i = 0; i < 4; i++)
+            channels[i] = make_channel(dib.masks[i]);
+        alpha = dib.hasAlphaMask;
+    }
+    else if (dib.bitCount == 32)
+    {
+        alpha = has_alpha_32bpp(dib, rows);
+    }
+    *has_alpha = alpha;
+
+    for (uint32_t y = 0; y < rows; y++)
+    {
+        const uint8_t *src = dib.pixels + y * row_bytes;
+        uint8_t *dst = dest_row(out, dib, rows, y);
+        switch (dib.bitCount)
+        {
+            case 1:
+                expand_1bpp(src, dst, width, lut);
+                break;
+            case 4:
+                expand_4bpp(src, dst, width, pairs, lut);
+                break;
+            case 8:
+                expand_8bpp(src, dst, width, lut);
+                break;
+            case 24:
+                expand_24bpp(src, dst, width, out.format);
+                break;
+            case 16:
+                expand_bitfields(src, dst, width, 16, channels, alpha, out.format, out.premultiplied);
+                break;
+            case 32:
+                if (dib.compression == BI_BITFIELDS)
+                    expand_bitfields(src, dst, width, 32, channels, alpha, out.format, out.premultiplied);
+                else if (alpha)
+                    convert_pixels_32(src, dst, width, out.format == PixelFormat::RGBA, out.premultiplied);
+                else
+                    expand_32bpp_opaque(src, dst, width, out.format);
+                break;
+        }
+    }
+    return true;
+}
+
+bool decode_dib(const uint8_t *data, size_t size, const ImageBuffer& out)
+{
+    DibImage dib;
+    size_t pixel_offset = 0;
+    bool has_alpha;
+
+    if (data == nullptr)
+        return false;
+    if (classify_content(data, size) == ContentType::BMP)
+    {
+        /* skip the file header, but honour its offset to the pixels */
+        if (size < 14 + 12)
+            return false;
+        uint32_t offbits = read_le32(data + 10);
+        if (offbits < 14 || offbits > size)
+            return false;
+        pixel_offset = offbits - 14;
+        data += 14;
+        size -= 14;
+    }
+    if (!parse_dib(data, size, pixel_offset, &dib))
+        return false;
+    return decode_dib_rows(dib, out, dib.height, &has_alpha);
+}
+
+bool decode_icon_image(const uint8_t *data, size_t size, const ImageBuffer& out)
+{
+    DibImage dib;
+    bool has_alpha;
+
+    if (data == nullptr)
+        return false;
+    if (classify_content(data, size) == ContentType::PNG)
+        return decode_png(data, size, out);
+
+    if (!parse_dib(data, size, 0, &dib) || dib.height < 2 || dib.compression != BI_RGB)
+        return false;
+
+    /* the header height covers the color bitmap and the mask */
+    uint32_t rows = dib.height / 2;
+    size_t xor_size = dib_row_bytes(dib.width, dib.bitCount) * rows;
+    size_t mask_row_bytes = dib_row_bytes(dib.width, 1);
+    if (!decode_dib_rows(dib, out, rows, &has_alpha))
+        return false;
+    if (has_alpha && dib.bitCount == 32)
+        return true;
+
+    /* apply the AND mask: set bits are transparent */
+    const uint8_t *mask = dib.pixels + xor_size;
+    bool have_mask = xor_size + mask_row_bytes * rows <= dib.pixelsSize;
+    for (uint32_t y = 0; y < rows; y++)
+    {
+        uint8_t *dst = dest_row(out, dib, rows, y);
+        const uint8_t *m = mask + y * mask_row_bytes;
+        for (uint32_t x = 0; x < (uint32_t)dib.width; x++)
+        {
+            if (have_mask && ((m[x >> 3] >> (7 - (x & 7))) & 1))
+                memset(dst + x * 4, 0, 4);
+            else
+                dst[x * 4 + 3] = 255;
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,40 @@
+#ifndef DIBDECODER_H
+#define DIBDECODER_H
+#include <stddef.h>
+#include <stdint.h>
+#include "imagebuffer.h"
+
+namespace wres
+{
+
+/*
+ * Decodes a device independent bitmap (the payload of RT_BITMAP resources,
+ * or a .bmp file including its 14 byte file header) into the caller's
+ * buffer. Supported are 1, 4 and 8-bit palettes, 16/24/32-bit BI_RGB,
+ * BI_BITFIELDS, BI_RLE4 and BI_RLE8. Bottom-up bitmaps are flipped while
+ * writing, there is no separate pass.
+ *
+ * Bitmaps without an alpha channel are opaque. 32-bit BI_RGB bitmaps are
+ * only treated as having alpha if at least one pixel has a nonzero alpha
+ * value. Pixels skipped by RLE escapes are transparent.
+ *
+ * The buffer dimensions must match the bitmap (see read_image_info()).
+ * Returns false if the bitmap is malformed or the buffer does not match.
+ */
+bool decode_dib(const uint8_t *data, size_t size, const ImageBuffer& out);
+
+/*
+ * Decodes an icon or cursor image as stored in RT_ICON/RT_CURSOR resources
+ * (or inside an .ico/.cur file): a DIB of doubled height holding the color
+ * (XOR) bitmap followed by the 1-bit AND mask. The alpha channel is taken
+ * from the color bitmap if it is 32-bit and has alpha, otherwise from the
+ * AND mask. Icon images stored as PNG are decoded with decode_png(), when
+ * available.
+ *
+ * For RT_CURSOR data, skip the 4 byte hotspot header before calling this.
+ */
+bool decode_icon_image(const uint8_t *data, size_t size, const ImageBuffer& out);
+
+}
+
+#endif // DIBDECODER_H
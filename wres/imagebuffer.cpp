@@ -0,0 +1,72 @@
+#include "imagebuffer.h"
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace wres
+{
+
+#if defined(__SSE2__)
+/* Multiplies the color channels of 4 pixels by their alpha */
+static inline __m128i premultiply_sse2(__m128i px)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32((int)0xFF000000);
+    const __m128i round = _mm_set1_epi16(128);
+
+    __m128i lo = _mm_unpacklo_epi8(px, zero);
+    __m128i hi = _mm_unpackhi_epi8(px, zero);
+    __m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+    lo = _mm_add_epi16(_mm_mullo_epi16(lo, alo), round);
+    hi = _mm_add_epi16(_mm_mullo_epi16(hi, ahi), round);
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+    __m128i color = _mm_andnot_si128(alpha_mask, _mm_packus_epi16(lo, hi));
+    return _mm_or_si128(color, _mm_and_si128(px, alpha_mask));
+}
+
+/* Swaps the first and third byte of 4 pixels */
+static inline __m128i swap_red_blue_sse2(__m128i px)
+{
+    __m128i ag = _mm_and_si128(px, _mm_set1_epi32((int)0xFF00FF00));
+    __m128i rb = _mm_and_si128(px, _mm_set1_epi32(0x00FF00FF));
+    rb = _mm_shufflelo_epi16(rb, _MM_SHUFFLE(2, 3, 0, 1));
+    rb = _mm_shufflehi_epi16(rb, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(ag, rb);
+}
+#endif
+
+void convert_pixels_32(const uint8_t *src, uint8_t *dst, size_t count, bool swapRedBlue, bool premultiply)
+{
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i alpha_mask = _mm_set1_epi32((int)0xFF000000);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        if (swapRedBlue)
+            px = swap_red_blue_sse2(px);
+        /* opaque pixels are by far the most common, skip the multiply for them */
+        if (premultiply && _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(px, alpha_mask), alpha_mask)) != 0xFFFF)
+            px = premultiply_sse2(px);
+        _mm_storeu_si128((__m128i*)(dst + i * 4), px);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        const uint8_t *s = src + i * 4;
+        uint8_t r = s[0], g = s[1], b = s[2], a = s[3];
+        if (swapRedBlue)
+            store_pixel(dst + i * 4, b, g, r, a, PixelFormat::RGBA, premultiply);
+        else
+            store_pixel(dst + i * 4, r, g, b, a, PixelFormat::RGBA, premultiply);
+    }
+}
+
+}
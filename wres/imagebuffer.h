@@ -0,0 +1,84 @@
+#ifndef IMAGEBUFFER_H
+#define IMAGEBUFFER_H
+#include <stddef.h>
+#include <stdint.h>
+
+namespace wres
+{
+
+/*
+ * Byte order of the 32-bit pixels written by the image decoders.
+ * RGBA is the order used by most graphics APIs and PNG, BGRA is the order
+ * of Windows DIBs and of QImage::Format_ARGB32 on little endian machines.
+ */
+enum class PixelFormat : uint8_t
+{
+    RGBA,
+    BGRA
+};
+
+/*
+ * ImageBuffer describes caller-owned memory that a decoder writes 32-bit
+ * pixels into. stride is the distance in bytes between the first pixels
+ * of two consecutive rows and must be at least width * 4. Rows are stored
+ * top-down. If premultiplied is set, color channels are multiplied by
+ * alpha.
+ */
+struct ImageBuffer
+{
+    uint8_t *pixels = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t stride = 0;
+    PixelFormat format = PixelFormat::BGRA;
+    bool premultiplied = true;
+};
+
+/*
+ * Multiplies a color channel by alpha, rounding to the nearest value
+ * (the same as c * a / 255.0, rounded).
+ */
+static inline uint8_t premultiply_channel(uint32_t c, uint32_t a)
+{
+    uint32_t t = c * a + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+/*
+ * Stores a single pixel in the layout requested by the buffer.
+ */
+static inline void store_pixel(uint8_t *dst, uint8_t r, uint8_t g, uint8_t b, uint8_t a,
+                               PixelFormat format, bool premultiplied)
+{
+    if (premultiplied && a != 255)
+    {
+        r = premultiply_channel(r, a);
+        g = premultiply_channel(g, a);
+        b = premultiply_channel(b, a);
+    }
+    if (format == PixelFormat::RGBA)
+    {
+        dst[0] = r;
+        dst[2] = b;
+    }
+    else
+    {
+        dst[0] = b;
+        dst[2] = r;
+    }
+    dst[1] = g;
+    dst[3] = a;
+}
+
+/*
+ * Converts count 32-bit pixels with straight alpha from src to dst. If
+ * swapRedBlue is set, the first and third byte of every pixel are swapped
+ * (RGBA <-> BGRA); if premultiply is set, the color channels are
+ * multiplied by alpha. src and dst may be the same. Uses SSE2 when
+ * available.
+ */
+void convert_pixels_32(const uint8_t *src, uint8_t *dst, size_t count, bool swapRedBlue, bool premultiply);
+
+}
+
+#endif // IMAGEBUFFER_H
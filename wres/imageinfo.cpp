@@ -0,0 +1,235 @@
+#include "imageinfo.h"
+#include "winlibrary.h"
+#include "threadpool.h"
+#include "wresutil.h"
+
+namespace wres
+{
+
+/* Chunk of entries handed to one pool task; header parsing is too cheap
+ * to be scheduled one image at a time */
+#define IMAGE_INDEX_GRAIN 64
+
+static bool read_png_info(const uint8_t *data, size_t size, ImageInfo *info)
+{
+    /* signature (8), IHDR length (4), "IHDR" (4), IHDR data (13) */
+    if (size < 8 + 8 + 13)
+        return false;
+    if (read_be32(data + 8) != 13 || memcmp(data + 12, "IHDR", 4) != 0)
+        return false;
+
+    const uint8_t *ihdr = data + 16;
+    info->format = ContentType::PNG;
+    info->width = read_be32(ihdr);
+    info->height = read_be32(ihdr + 4);
+    info->bitDepth = ihdr[8];
+    info->colorType = ihdr[9];
+    info->compression = ihdr[10];
+    info->interlaced = ihdr[12] != 0;
+    info->topDown = true;
+
+    if (info->width == 0 || info->height == 0 || info->width > 0x7fffffff || info->height > 0x7fffffff)
+        return false;
+    switch (info->colorType)
+    {
+        case PNG_COLOR_GRAY:
+            return info->bitDepth == 1 || info->bitDepth == 2 || info->bitDepth == 4
+                || info->bitDepth == 8 || info->bitDepth == 16;
+        case PNG_COLOR_PALETTE:
+            return info->bitDepth == 1 || info->bitDepth == 2 || info->bitDepth == 4
+                || info->bitDepth == 8;
+        case PNG_COLOR_RGB:
+        case PNG_COLOR_GRAY_ALPHA:
+        case PNG_COLOR_RGBA:
+            return info->bitDepth == 8 || info->bitDepth == 16;
+        default:
+            return false;
+    }
+}
+
+static bool read_dib_info(const uint8_t *data, size_t size, ImageInfo *info, bool iconImage)
+{
+    if (size < 12)
+        return false;
+
+    uint32_t header_size = read_le32(data);
+    int32_t width, height;
+    uint16_t planes;
+
+    if (header_size == 12)
+    {
+        /* BITMAPCOREHEADER */
+        width = read_le16(data + 4);
+        height = (int16_t)read_le16(data + 6);
+        planes = read_le16(data + 8);
+        info->bitDepth = read_le16(data + 10);
+        info->compression = BI_RGB;
+    }
+    else if (header_size >= sizeof(Win32BitmapInfoHeader) && size >= sizeof(Win32BitmapInfoHeader))
+    {
+        Win32BitmapInfoHeader header;
+        memcpy(&header, data, sizeof(header));
+        fix_win32_bitmap_info_header_endian(&header);
+        width = header.width;
+        height = header.height;
+        planes = header.planes;
+        info->bitDepth = header.bit_count;
+        info->compression = header.compression;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (planes != 1 || width <= 0 || height == 0 || height == INT32_MIN)
+        return false;
+
+    info->format = ContentType::DIB;
+    info->width = width;
+    info->topDown = height < 0;
+    info->height = height < 0 ? -height : height;
+    if (iconImage)
+        info->height /= 2;
+    info->colorType = 0;
+    info->interlaced = false;
+    return info->height != 0;
+}
+
+bool read_image_info(const uint8_t *data, size_t size, ImageInfo *info, bool iconImage)
+{
+    if (data == nullptr || info == nullptr)
+        return false;
+
+    *info = ImageInfo();
+    switch (classify_content(data, size))
+    {
+        case ContentType::PNG:
+            return read_png_info(data, size, info);
+        case ContentType::BMP:
+            /* skip the 14 byte file header */
+            if (size < 14 || !read_dib_info(data + 14, size - 14, info, false))
+                return false;
+            info->format = ContentType::BMP;
+            return true;
+        default:
+            /* DIBs have no reliable signature; let the header decide */
+            return read_dib_info(data, size, info, iconImage);
+    }
+}
+
+bool image_payload_fits(const ImageInfo& info, size_t size)
+{
+    uint64_t pixels = (uint64_t)info.width * info.height;
+    if (info.format == ContentType::PNG)
+    {
+        static const uint8_t channels[] = { 1, 0, 3, 1, 2, 0, 4 };
+        uint8_t perPixel = info.colorType < sizeof(channels) ? channels[info.colorType] : 4;
+        uint64_t bytes = (pixels * std::max<uint8_t>(perPixel, 1) * info.bitDepth + 7) / 8;
+        // deflate expands at most 1032 times
+        return bytes <= (uint64_t)size * 1032;
+    }
+    switch (info.compression)
+    {
+        case BI_RGB:
+        case BI_BITFIELDS:
+        {
+            uint64_t stride = ((uint64_t)info.width * info.bitDepth + 31) / 32 * 4;
+            return stride * info.height <= size;
+        }
+        case BI_RLE8:
+        case BI_RLE4:
+            // one two-byte run covers at most 255 pixels
+            return pixels <= (uint64_t)size * 128;
+        default:
+            return pixels <= (uint64_t)size * 1032;
+    }
+}
+
+ImageIndex::ImageIndex() {}
+
+bool ImageIndex::build(WinLibrary& lib, WinResource *res, ThreadPool *pool)
+{
+    clear();
+    if (res == nullptr || !lib.isValid())
+        return false;
+
+    std::vector<WinResource*> resources = lib.collectResources(res, true);
+    std::vector<ImageInfo> infos(resources.size());
+    std::vector<char> valid(resources.size(), 0);
+
+    if (pool == nullptr)
+        pool = &ThreadPool::global();
+
+    size_t tasks = (resources.size() + IMAGE_INDEX_GRAIN - 1) / IMAGE_INDEX_GRAIN;
+    pool->parallelFor(tasks, [&](size_t task)
+    {
+        size_t end = std::min(resources.size(), (task + 1) * IMAGE_INDEX_GRAIN);
+        for (size_t i = task * IMAGE_INDEX_GRAIN; i < end; i++)
+        {
+            const WinResource *r = resources[i];
+            const uint8_t *data = (const uint8_t*)r->offset();
+            size_t size = r->size();
+            int32_t type = 0;
+            bool icon = false;
+
+            if (parse_int32(r->type().c_str(), &type) && (type == RT_ICON || type == RT_CURSOR))
+            {
+                icon = true;
+                /* cursor images start with the hotspot */
+                if (type == RT_CURSOR)
+                {
+                    if (size < sizeof(uint16_t)*2)
+                        continue;
+                    data += sizeof(uint16_t)*2;
+                    size -= sizeof(uint16_t)*2;
+                }
+            }
+            valid[i] = read_image_info(data, size, &infos[i], icon);
+        }
+    });
+
+    for (size_t i = 0; i < resources.size(); i++)
+    {
+        if (!valid[i])
+            continue;
+        m_byResource[resources[i]] = m_entries.size();
+        m_entries.push_back({ resources[i], infos[i] });
+    }
+    return true;
+}
+
+const ImageInfo* ImageIndex::find(const WinResource *res) const
+{
+    auto it = m_byResource.find(res);
+    if (it == m_byResource.end())
+        return nullptr;
+    return &m_entries[it->second].info;
+}
+
+const ImageInfo* ImageIndex::find(const std::string& name, const std::string& language) const
+{
+    for (const auto &entry : m_entries)
+    {
+        if (entry.resource->name() == name && (language.empty() || entry.resource->language() == language))
+            return &entry.info;
+    }
+    return nullptr;
+}
+
+const std::vector<ImageIndex::Entry>& ImageIndex::entries() const
+{
+    return m_entries;
+}
+
+size_t ImageIndex::size() const
+{
+    return m_entries.size();
+}
+
+void ImageIndex::clear()
+{
+    m_entries.clear();
+    m_byResource.clear();
+}
+
+}
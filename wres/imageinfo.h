@@ -0,0 +1,110 @@
+#ifndef IMAGEINFO_H
+#define IMAGEINFO_H
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "contenttype.h"
+#include "win32.h"
+
+namespace wres
+{
+
+class WinLibrary;
+class WinResource;
+class ThreadPool;
+
+/* PNG color types, as stored in the IHDR chunk */
+#define PNG_COLOR_GRAY          0
+#define PNG_COLOR_RGB           2
+#define PNG_COLOR_PALETTE       3
+#define PNG_COLOR_GRAY_ALPHA    4
+#define PNG_COLOR_RGBA          6
+
+/*
+ * ImageInfo holds the header metadata of an image resource: what can be
+ * learned without decoding any pixel data.
+ *
+ * For PNG images, bitDepth is the number of bits per channel and
+ * colorType is one of the PNG_COLOR_* values. For DIBs (and BMP files),
+ * bitDepth is the number of bits per pixel and compression is one of the
+ * BI_* values. For icon and cursor images, height is the height of the
+ * image itself, not the doubled XOR+AND height stored in the header.
+ */
+struct ImageInfo
+{
+    ContentType format = ContentType::Unknown;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint8_t bitDepth = 0;
+    uint8_t colorType = 0;
+    uint32_t compression = 0;
+    bool interlaced = false;
+    bool topDown = false;
+};
+
+/*
+ * Reads the image header at data. PNG (IHDR), DIB (BITMAPCOREHEADER,
+ * BITMAPINFOHEADER and later) and BMP files are recognized. Set
+ * iconImage when the data is an RT_ICON/RT_CURSOR image, whose DIB height
+ * includes the AND mask. Returns false if the data is not a supported
+ * image or the header is malformed.
+ */
+bool read_image_info(const uint8_t *data, size_t size, ImageInfo *info, bool iconImage = false);
+
+/*
+ * Returns false if size bytes of image data cannot hold the pixels that
+ * the header claims, so that a tiny resource does not make the caller
+ * allocate a huge pixel buffer. Uncompressed DIBs must hold all of their
+ * rows; RLE and deflate data is allowed its best compression ratio.
+ */
+bool image_payload_fits(const ImageInfo& info, size_t size);
+
+class ImageIndex
+{
+public:
+    /*
+     * ImageIndex holds the header metadata of every image resource below
+     * a resource directory, e.g. the IMAGE directory of an msstyles theme.
+     * Only image headers are parsed, so building the index does not
+     * depend on the size of the images.
+     *
+     * Entries are kept in data offset order. Resources that are not
+     * images are left out.
+     */
+    struct Entry
+    {
+        WinResource* resource;
+        ImageInfo info;
+    };
+
+    ImageIndex();
+    /*
+     * Indexes every image resource below res (or res itself). Headers are
+     * parsed in parallel on the given pool, or the global pool if none is
+     * given. Returns false if res is invalid.
+     */
+    bool build(WinLibrary& lib, WinResource *res, ThreadPool *pool = nullptr);
+    /*
+     * Returns the metadata of a resource, or nullptr if it is not indexed.
+     */
+    const ImageInfo* find(const WinResource *res) const;
+    /*
+     * Returns the metadata of the first indexed resource with the given
+     * name (and language, if not empty), or nullptr.
+     */
+    const ImageInfo* find(const std::string& name, const std::string& language = "") const;
+
+    const std::vector<Entry>& entries() const;
+    size_t size() const;
+    void clear();
+
+private:
+    std::vector<Entry> m_entries;
+    std::unordered_map<const WinResource*, size_t> m_byResource;
+};
+
+}
+
+#endif // IMAGEINFO_H
@@ -0,0 +1,520 @@
+#include "inflate.h"
+#include <string.h>
+#include <algorithm>
+
+namespace wres
+{
+
+/* Codes up to this length are decoded with a single table lookup */
+#define INFLATE_FAST_BITS 10
+#define INFLATE_FAST_MASK ((1 << INFLATE_FAST_BITS) - 1)
+
+/*
+ * Canonical Huffman decoding table. fast[] is indexed by the next
+ * INFLATE_FAST_BITS bits of input and holds (length << 9) | symbol, or 0 if
+ * the code is longer; longer codes are resolved with the canonical
+ * firstcode/maxcode ranges.
+ */
+struct InflateHuffman
+{
+    uint16_t fast[1 << INFLATE_FAST_BITS];
+    uint16_t firstcode[16];
+    int maxcode[17];
+    uint16_t firstsymbol[16];
+    uint8_t size[288];
+    uint16_t value[288];
+};
+
+struct InflateState
+{
+    const InflateSegment *segments;
+    size_t segmentCount;
+    size_t segment;
+    const uint8_t *p;
+    const uint8_t *end;
+    uint64_t bits;
+    int count;
+    /* zero bytes fed to the bit buffer after the input ran out */
+    size_t overrun;
+
+    uint8_t *out;
+    uint8_t *op;
+    uint8_t *outEnd;
+
+    InflateHuffman lit;
+    InflateHuffman dist;
+};
+
+static const uint16_t length_base[31] =
+{
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258, 0, 0
+};
+static const uint8_t length_extra[31] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0, 0, 0
+};
+static const uint16_t dist_base[32] =
+{
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193,
+    12289, 16385, 24577, 0, 0
+};
+static const uint8_t dist_extra[32] =
+{
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 0, 0
+};
+static const uint8_t code_length_order[19] =
+{
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static inline int bit_reverse16(int n)
+{
+    n = ((n & 0xAAAA) >> 1) | ((n & 0x5555) << 1);
+    n = ((n & 0xCCCC) >> 2) | ((n & 0x3333) << 2);
+    n = ((n & 0xF0F0) >> 4) | ((n & 0x0F0F) << 4);
+    n = ((n & 0xFF00) >> 8) | ((n & 0x00FF) << 8);
+    return n;
+}
+
+static inline int bit_reverse(int v, int bits)
+{
+    return bit_reverse16(v) >> (16 - bits);
+}
+
+static bool build_huffman(InflateHuffman *h, const uint8_t *sizelist, int num)
+{
+    int i, k = 0;
+    int code, next_code[16], sizes[17];
+
+    memset(sizes, 0, sizeof(sizes));
+    memset(h->fast, 0, sizeof(h->fast));
+    for (i = 0; i < num; i++)
+        sizes[sizelist[i]]++;
+    sizes[0] = 0;
+    for (i = 1; i < 16; i++)
+    {
+        if (sizes[i] > (1 << i))
+            return false;
+    }
+
+    code = 0;
+    for (i = 1; i < 16; i++)
+    {
+        next_code[i] = code;
+        h->firstcode[i] = (uint16_t)code;
+        h->firstsymbol[i] = (uint16_t)k;
+        code += sizes[i];
+        if (sizes[i] && code - 1 >= (1 << i))
+            return false;
+        h->maxcode[i] = code << (16 - i);
+        code <<= 1;
+        k += sizes[i];
+    }
+    h->maxcode[16] = 0x10000;
+
+    for (i = 0; i < num; i++)
+    {
+        int s = sizelist[i];
+        if (s == 0)
+            continue;
+        int c = next_code[s] - h->firstcode[s] + h->firstsymbol[s];
+        h->size[c] = (uint8_t)s;
+        h->value[c] = (uint16_t)i;
+        if (s <= INFLATE_FAST_BITS)
+        {
+            uint16_t fastv = (uint16_t)((s << 9) | i);
+            for (int j = bit_reverse(next_code[s], s); j < (1 << INFLATE_FAST_BITS); j += (1 << s))
+                h->fast[j] = fastv;
+        }
+        next_code[s]++;
+    }
+    return true;
+}
+
+static bool next_segment(InflateState *s)
+{
+    while (s->segment + 1 < s->segmentCount)
+    {
+        s->segment++;
+        s->p = s->segments[s->segment].data;
+        s->end = s->p + s->segments[s->segment].size;
+        if (s->p != s->end)
+            return true;
+    }
+    return false;
+}
+
+/* Tops the bit buffer up to at least 56 bits */
+static inline void refill(InflateState *s)
+{
+    if (s->end - s->p >= 8)
+    {
+        uint64_t v;
+        memcpy(&v, s->p, sizeof(v));
+#if WORDS_BIGENDIAN
+        v = __builtin_bswap64(v);
+#endif
+        s->bits |= v << s->count;
+        s->p += (63 - s->count) >> 3;
+        s->count |= 56;
+        return;
+    }
+    while (s->count <= 56)
+    {
+        if (s->p == s->end && !next_segment(s))
+        {
+            s->overrun++;
+            s->count += 8;
+            continue;
+        }
+        s->bits |= (uint64_t)*s->p++ << s->count;
+        s->count += 8;
+    }
+}
+
+/* The caller must have made sure that enough bits are buffered */
+static inline uint32_t take_bits(InflateState *s, int n)
+{
+    uint32_t v = (uint32_t)(s->bits & ((1ull << n) - 1));
+    s->bits >>= n;
+    s->count -= n;
+    return v;
+}
+
+static inline uint32_t get_bits(InflateState *s, int n)
+{
+    if (s->count < n)
+        refill(s);
+    return take_bits(s, n);
+}
+
+static int decode_slow(InflateState *s, const InflateHuffman *h)
+{
+    int b, n;
+    int k = bit_reverse16((int)(s->bits & 0xFFFF));
+    for (n = INFLATE_FAST_BITS + 1; ; n++)
+    {
+        if (k < h->maxcode[n])
+            break;
+    }
+    if (n >= 16)
+        return -1;
+    b = (k >> (16 - n)) - h->firstcode[n] + h->firstsymbol[n];
+    if (b >= 288 || h->size[b] != n)
+        return -1;
+    take_bits(s, n);
+    return h->value[b];
+}
+
+/* The caller must have made sure that at least 15 bits are buffered */
+static inline int decode_symbol(InflateState *s, const InflateHuffman *h)
+{
+    int b = h->fast[s->bits & INFLATE_FAST_MASK];
+    if (b)
+    {
+        take_bits(s, b >> 9);
+        return b & 511;
+    }
+    return decode_slow(s, h);
+}
+
+static bool inflate_huffman_block(InflateState *s)
+{
+    uint8_t *op = s->op;
+    for (;;)
+    {
+        /* 56 bits cover a length code, a distance code and their extra bits */
+        if (s->count < 48)
+            refill(s);
+
+        int z = decode_symbol(s, &s->lit);
+        if (z < 256)
+        {
+            if (z < 0 || op >= s->outEnd)
+                return false;
+            *op++ = (uint8_t)z;
+            continue;
+        }
+        if (z == 256)
+        {
+            s->op = op;
+            return s->overrun <= sizeof(s->bits);
+        }
+
+        z -= 257;
+        if (z >= 29)
+            return false;
+        size_t len = length_base[z] + take_bits(s, length_extra[z]);
+
+        z = decode_symbol(s, &s->dist);
+        if (z < 0 || z >= 30)
+            return false;
+        size_t d = dist_base[z] + take_bits(s, dist_extra[z]);
+
+        if (d > (size_t)(op - s->out) || len > (size_t)(s->outEnd - op))
+            return false;
+
+        const uint8_t *src = op - d;
+        if (d == 1)
+        {
+            memset(op, *src, len);
+            op += len;
+        }
+        else if (d >= 8)
+        {
+            /* 8 byte chunks never overlap their own destination */
+            while (len >= 8)
+            {
+                memcpy(op, src, 8);
+                op += 8;
+                src += 8;
+                len -= 8;
+            }
+            while (len--)
+                *op++ = *src++;
+        }
+        else
+        {
+            while (len--)
+                *op++ = *src++;
+        }
+    }
+}
+
+static bool inflate_stored_block(InflateState *s)
+{
+    uint8_t header[4];
+
+    /* skip to the next byte boundary */
+    take_bits(s, s->count & 7);
+
+    /* LEN and NLEN may still be in the bit buffer */
+    for (int i = 0; i < 4; i++)
+        header[i] = (uint8_t)get_bits(s, 8);
+    if (s->overrun * 8 > (size_t)s->count)
+        return false;
+
+    uint16_t len = header[0] | (header[1] << 8);
+    uint16_t nlen = header[2] | (header[3] << 8);
+    if (len != (uint16_t)~nlen)
+        return false;
+    if (len > s->outEnd - s->op)
+        return false;
+
+    /* drain the whole bytes left in the bit buffer */
+    while (len > 0 && s->count >= 8)
+    {
+        if (s->overrun * 8 >= (size_t)s->count)
+            return false;
+        *s->op++ = (uint8_t)take_bits(s, 8);
+        len--;
+    }
+    if (s->count == 0)
+        s->bits = 0;
+
+    /* and copy the rest straight from the input */
+    while (len > 0)
+    {
+        if (s->p == s->end && !next_segment(s))
+            return false;
+        size_t n = std::min((size_t)len, (size_t)(s->end - s->p));
+        memcpy(s->op, s->p, n);
+        s->op += n;
+        s->p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool read_dynamic_tables(InflateState *s)
+{
+    InflateHuffman codes;
+    uint8_t lengths[286 + 32 + 137];
+    uint8_t code_lengths[19];
+
+    int hlit = get_bits(s, 5) + 257;
+    int hdist = get_bits(s, 5) + 1;
+    int hclen = get_bits(s, 4) + 4;
+    int total = hlit + hdist;
+
+    memset(code_lengths, 0, sizeof(code_lengths));
+    for (int i = 0; i < hclen; i++)
+        code_lengths[code_length_order[i]] = (uint8_t)get_bits(s, 3);
+    if (!build_huffman(&codes, code_lengths, 19))
+        return false;
+
+    int n = 0;
+    while (n < total)
+    {
+        if (s->count < 16)
+            refill(s);
+        int c = decode_symbol(s, &codes);
+        if (c < 0 || c >= 19)
+            return false;
+        if (c < 16)
+        {
+            lengths[n++] = (uint8_t)c;
+            continue;
+        }
+
+        uint8_t fill = 0;
+        int repeat;
+        if (c == 16)
+        {
+            if (n == 0)
+                return false;
+            repeat = get_bits(s, 2) + 3;
+            fill = lengths[n - 1];
+        }
+        else if (c == 17)
+        {
+            repeat = get_bits(s, 3) + 3;
+        }
+        else
+        {
+            repeat = get_bits(s, 7) + 11;
+        }
+        if (total - n < repeat)
+            return false;
+        memset(lengths + n, fill, repeat);
+        n += repeat;
+    }
+    if (s->overrun > sizeof(s->bits))
+        return false;
+
+    return build_huffman(&s->lit, lengths, hlit)
+        && build_huffman(&s->dist, lengths + hlit, hdist);
+}
+
+static bool read_fixed_tables(InflateState *s)
+{
+    uint8_t lengths[288];
+    uint8_t distances[32];
+    int i;
+
+    for (i = 0; i <= 143; i++) lengths[i] = 8;
+    for (; i <= 255; i++) lengths[i] = 9;
+    for (; i <= 279; i++) lengths[i] = 7;
+    for (; i <= 287; i++) lengths[i] = 8;
+    memset(distances, 5, sizeof(distances));
+
+    return build_huffman(&s->lit, lengths, 288)
+        && build_huffman(&s->dist, distances, 32);
+}
+
+static void init_state(InflateState *s, const InflateSegment *segments, size_t segmentCount,
+                       uint8_t *out, size_t outSize)
+{
+    s->segments = segments;
+    s->segmentCount = segmentCount;
+    s->segment = 0;
+    s->p = segmentCount > 0 ? segments[0].data : nullptr;
+    s->end = segmentCount > 0 ? segments[0].data + segments[0].size : nullptr;
+    s->bits = 0;
+    s->count = 0;
+    s->overrun = 0;
+    s->out = out;
+    s->op = out;
+    s->outEnd = out + outSize;
+}
+
+static bool inflate_blocks(InflateState *s)
+{
+    bool final;
+    do
+    {
+        final = get_bits(s, 1);
+        int type = get_bits(s, 2);
+        switch (type)
+        {
+            case 0:
+                if (!inflate_stored_block(s))
+                    return false;
+                break;
+            case 1:
+                if (!read_fixed_tables(s) || !inflate_huffman_block(s))
+                    return false;
+                break;
+            case 2:
+                if (!read_dynamic_tables(s) || !inflate_huffman_block(s))
+                    return false;
+                break;
+            default:
+                return false;
+        }
+    } while (!final);
+    return true;
+}
+
+bool inflate_raw(const InflateSegment *segments, size_t segmentCount,
+                 uint8_t *out, size_t outSize, size_t *written)
+{
+    /* the state holds two decoding tables, keep it off the stack */
+    static thread_local InflateState state;
+    InflateState *s = &state;
+
+    init_state(s, segments, segmentCount, out, outSize);
+    bool ok = inflate_blocks(s);
+    if (written)
+        *written = s->op - s->out;
+    return ok;
+}
+
+bool inflate_zlib(const InflateSegment *segments, size_t segmentCount,
+                  uint8_t *out, size_t outSize, size_t *written,
+                  bool verifyChecksum)
+{
+    static thread_local InflateState state;
+    InflateState *s = &state;
+
+    init_state(s, segments, segmentCount, out, outSize);
+    if (written)
+        *written = 0;
+
+    uint32_t cmf = get_bits(s, 8);
+    uint32_t flg = get_bits(s, 8);
+    if ((cmf & 15) != 8 || (cmf >> 4) > 7 || (flg & 0x20) || ((cmf << 8) | flg) % 31 != 0)
+        return false;
+
+    bool ok = inflate_blocks(s);
+    if (written)
+        *written = s->op - s->out;
+    if (!ok || !verifyChecksum)
+        return ok;
+
+    take_bits(s, s->count & 7);
+    uint32_t expected = 0;
+    for (int i = 0; i < 4; i++)
+        expected = (expected << 8) | get_bits(s, 8);
+    if (s->overrun * 8 > (size_t)s->count)
+        return false;
+    return expected == adler32_update(1, s->out, s->op - s->out);
+}
+
+uint32_t adler32_update(uint32_t adler, const uint8_t *data, size_t size)
+{
+    /* largest n such that 255n(n+1)/2 + (n+1)(65520) fits in 32 bits */
+    const size_t nmax = 5552;
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+
+    while (size > 0)
+    {
+        size_t n = std::min(size, nmax);
+        size -= n;
+        while (n--)
+        {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+}
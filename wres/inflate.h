@@ -0,0 +1,47 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+#include <stddef.h>
+#include <stdint.h>
+
+namespace wres
+{
+
+/*
+ * InflateSegment is one piece of a compressed stream. A zlib stream may be
+ * split over several segments (e.g. the IDAT chunks of a PNG image), which
+ * are decoded as if they were concatenated, without copying them.
+ */
+struct InflateSegment
+{
+    const uint8_t *data;
+    size_t size;
+};
+
+/*
+ * Decompresses a zlib (RFC 1950) stream made of the given segments into
+ * out, which holds outSize bytes. The number of bytes produced is stored
+ * in written. The whole output buffer doubles as the sliding window, so no
+ * memory is allocated.
+ *
+ * Returns false if the stream is malformed or does not fit into out. The
+ * Adler-32 checksum is only verified when verifyChecksum is set.
+ */
+bool inflate_zlib(const InflateSegment *segments, size_t segmentCount,
+                  uint8_t *out, size_t outSize, size_t *written,
+                  bool verifyChecksum = false);
+
+/*
+ * Same as above, for raw deflate (RFC 1951) data without the zlib wrapper.
+ */
+bool inflate_raw(const InflateSegment *segments, size_t segmentCount,
+                 uint8_t *out, size_t outSize, size_t *written);
+
+/*
+ * Computes the Adler-32 checksum of data, continuing from adler (pass 1
+ * for a new checksum).
+ */
+uint32_t adler32_update(uint32_t adler, const uint8_t *data, size_t size);
+
+}
+
+#endif // INFLATE_H
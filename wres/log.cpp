@@ -0,0 +1,56 @@
+#include "log.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+namespace wres
+{
+
+std::atomic<uint8_t> log_threshold { (uint8_t)LogLevel::Warning };
+
+static void default_sink(LogLevel, const char *message, void *)
+{
+    fprintf(stderr, "libwres: %s\n", message);
+}
+
+/* A sink and its userData, published together */
+struct SinkBinding
+{
+    LogSink sink;
+    void *userData;
+};
+
+static SinkBinding default_binding { default_sink, nullptr };
+static std::atomic<const SinkBinding*> log_binding { &default_binding };
+
+void set_log_sink(LogSink sink, void *userData)
+{
+    const SinkBinding *binding = &default_binding;
+    if (sink != nullptr)
+        binding = new SinkBinding { sink, userData };
+    // the old binding may still be in use by log_message() on another thread
+    log_binding.store(binding, std::memory_order_release);
+}
+
+void set_log_level(LogLevel level)
+{
+    log_threshold.store((uint8_t)level, std::memory_order_relaxed);
+}
+
+LogLevel log_level()
+{
+    return (LogLevel)log_threshold.load(std::memory_order_relaxed);
+}
+
+void log_message(LogLevel level, const char *format, ...)
+{
+    // messages are short; longer ones are cut rather than allocated
+    char message[1024];
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(message, sizeof(message), format, ap);
+    va_end(ap);
+    const SinkBinding *binding = log_binding.load(std::memory_order_acquire);
+    binding->sink(level, message, binding->userData);
+}
+
+}
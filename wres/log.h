@@ -0,0 +1,81 @@
+#ifndef WRES_LOG_H
+#define WRES_LOG_H
+#include <stdint.h>
+#include <atomic>
+
+/*
+ * Messages below this level are compiled out of the library. Set through
+ * the WRES_LOG_MIN_LEVEL CMake cache variable: 0 debug, 1 info,
+ * 2 warning, 3 error, 4 nothing.
+ */
+#ifndef WRES_LOG_MIN_LEVEL
+#define WRES_LOG_MIN_LEVEL 0
+#endif
+
+namespace wres
+{
+
+enum class LogLevel : uint8_t
+{
+    Debug = 0,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+/*
+ * Receives every message that passes the level checks, without a trailing
+ * newline. It may be called from several threads at once.
+ */
+typedef void (*LogSink)(LogLevel level, const char *message, void *userData);
+
+/*
+ * Replaces the sink; nullptr restores the default one, which writes
+ * "libwres: message" lines to stderr. The sink and userData are swapped
+ * together, so a message always reaches a sink with its own userData.
+ * Replaced sinks are never freed (a message may still be on its way to
+ * them), so this is meant to be called a few times, not per message.
+ */
+void set_log_sink(LogSink sink, void *userData = nullptr);
+/*
+ * Sets the lowest level passed to the sink at runtime. The default is
+ * LogLevel::Warning; LogLevel::Off silences the library.
+ */
+void set_log_level(LogLevel level);
+LogLevel log_level();
+
+extern std::atomic<uint8_t> log_threshold;
+
+/* Returns true if messages of the given level reach the sink */
+static inline bool log_enabled(LogLevel level)
+{
+#if WRES_LOG_MIN_LEVEL > 0
+    if ((int)level < WRES_LOG_MIN_LEVEL)
+        return false;
+#endif
+    return (uint8_t)level >= log_threshold.load(std::memory_order_relaxed);
+}
+
+/* Formats the message and passes it to the sink; use WRES_LOG instead */
+void log_message(LogLevel level, const char *format, ...) __attribute__ ((format (printf, 2, 3)));
+
+}
+
+/*
+ * Logs a printf style message. Arguments are only evaluated and formatted
+ * if the level is enabled: a message below WRES_LOG_MIN_LEVEL compiles to
+ * nothing, and one below the runtime level costs one branch.
+ */
+#define WRES_LOG(level, ...) \
+do { \
+    if (::wres::log_enabled(level)) \
+        ::wres::log_message(level, __VA_ARGS__); \
+} while (0)
+
+#define WRES_LOG_DEBUG(...)   WRES_LOG(::wres::LogLevel::Debug, __VA_ARGS__)
+#define WRES_LOG_INFO(...)    WRES_LOG(::wres::LogLevel::Info, __VA_ARGS__)
+#define WRES_LOG_WARNING(...) WRES_LOG(::wres::LogLevel::Warning, __VA_ARGS__)
+#define WRES_LOG_ERROR(...)   WRES_LOG(::wres::LogLevel::Error, __VA_ARGS__)
+
+#endif // WRES_LOG_H
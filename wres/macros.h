@@ -17,16 +17,19 @@
 #define NE_TYPEINFO_NEXT(x) ((Win16NETypeInfo *)((uint8_t *)(x) + sizeof(Win16NETypeInfo) + \
 ((Win16NETypeInfo *)x)->count * sizeof(Win16NENameInfo)))
 #define NE_RESOURCE_NAME_IS_NUMERIC (0x8000)
+/* Largest resource alignment shift accepted in NE files; 16 means 64K units */
+#define NE_MAX_ALIGN_SHIFT (16)
 #define RES_TYPE_COUNT ((int)(sizeof(res_types)/sizeof(char *)))
 
-#define CHECK_IF_BAD_POINTER(r, x) \
-if (!check_offset(m_data, m_length, m_path.c_str(), &(x), sizeof(x))) { \
-    /*printf("bad_pointer in %s:%d\n", __FILE__, __LINE__);*/ \
-    return (r); \
-}
+/*
+ * Bounds checks of WinLibrary members: on failure, the problem is recorded
+ * in the library's status (with the function as context) and the caller
+ * returns r.
+ */
+#define CHECK_IF_BAD_POINTER(r, x) CHECK_IF_BAD_OFFSET(r, &(x), sizeof(x))
 #define CHECK_IF_BAD_OFFSET(r, x, s) \
-if (!check_offset(m_data, m_length, m_path.c_str(), x, s)) { \
-    /*printf("bad_offset in %s:%d\n", __FILE__, __LINE__);*/ \
+if (!in_bounds(x, s)) { \
+    fail(ParseError::Truncated, x, __func__); \
     return (r); \
 }
 
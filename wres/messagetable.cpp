@@ -0,0 +1,184 @@
+#include "messagetable.h"
+#include "winlibrary.h"
+#include "wresutil.h"
+#include <algorithm>
+#include <new>
+
+namespace wres
+{
+
+/* Every entry has at least its 4 byte header */
+#define MESSAGE_ENTRY_MIN_SIZE sizeof(Win32MessageResourceEntry)
+
+bool MessageTable::parse(const uint8_t *data, size_t size)
+{
+    m_data = data;
+    m_size = size;
+    m_isValid = false;
+    m_blocks.clear();
+    m_entries.clear();
+    if (data == nullptr || size < 4)
+        return false;
+
+    uint32_t count = read_le32(data);
+    if (count > (size - 4) / sizeof(Win32MessageResourceBlock))
+        return false;
+    m_blocks.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint8_t *p = data + 4 + i * sizeof(Win32MessageResourceBlock);
+        Block block;
+        block.lowId = read_le32(p);
+        block.highId = read_le32(p + 4);
+        block.offset = read_le32(p + 8);
+        block.firstEntry = 0;
+        // the entries of the block have to fit behind its offset
+        if (block.lowId > block.highId || block.offset >= size ||
+            (uint64_t)block.highId - block.lowId + 1 > (size - block.offset) / MESSAGE_ENTRY_MIN_SIZE)
+            continue;
+        m_blocks.push_back(block);
+    }
+
+    // blocks are stored sorted, but nothing enforces it
+    std::sort(m_blocks.begin(), m_blocks.end(), [](const Block& a, const Block& b)
+    {
+        return a.lowId < b.lowId;
+    });
+    m_blocks.erase(std::unique(m_blocks.begin(), m_blocks.end(), [](const Block& a, const Block& b)
+    {
+        return b.lowId <= a.highId;
+    }), m_blocks.end());
+
+    // Entries do not share bytes, so the data holds at most size / 4 of
+    // them. Blocks may still point into each other; keeping the total ids
+    // within that bound also bounds the index to the size of the data.
+    size_t total = 0;
+    m_blocks.erase(std::remove_if(m_blocks.begin(), m_blocks.end(), [&](const Block& block)
+    {
+        size_t ids = (size_t)block.highId - block.lowId + 1;
+        if (ids > size / MESSAGE_ENTRY_MIN_SIZE - total)
+            return true;
+        total += ids;
+        return false;
+    }), m_blocks.end());
+
+    m_isValid = true;
+    return true;
+}
+
+bool MessageTable::load(WinLibrary& library, const std::string& language)
+{
+    WinResource *tables = library.findResource(std::string("11"), std::string(""), std::string(""));
+    for (auto r : library.collectResources(tables))
+    {
+        if (language.empty() || r->language() == language)
+            return parse((const uint8_t*)r->offset(), r->size());
+    }
+    parse(nullptr, 0);
+    return false;
+}
+
+bool MessageTable::isValid() const
+{
+    return m_isValid;
+}
+
+size_t MessageTable::size() const
+{
+    size_t count = 0;
+    for (auto &block : m_blocks)
+        count += (size_t)block.highId - block.lowId + 1;
+    return count;
+}
+
+bool MessageTable::buildIndex()
+{
+    m_entries.clear();
+    try
+    {
+        m_entries.reserve(size());
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+    for (auto &block : m_blocks)
+    {
+        block.firstEntry = (uint32_t)m_entries.size();
+        size_t offset = block.offset;
+        for (uint64_t id = block.lowId; id <= block.highId; id++)
+        {
+            size_t length = offset + MESSAGE_ENTRY_MIN_SIZE <= m_size ? read_le16(m_data + offset) : 0;
+            if (length < MESSAGE_ENTRY_MIN_SIZE || length > m_size - offset)
+            {
+                // the rest of the block is unreadable
+                m_entries.resize(block.firstEntry + ((size_t)block.highId - block.lowId + 1), 0);
+                break;
+            }
+            m_entries.push_back((uint32_t)offset);
+            offset += length;
+        }
+    }
+    return true;
+}
+
+const MessageTable::Block* MessageTable::find_block(uint32_t id) const
+{
+    auto it = std::upper_bound(m_blocks.begin(), m_blocks.end(), id, [](uint32_t id, const Block& block)
+    {
+        return id < block.lowId;
+    });
+    if (it == m_blocks.begin())
+        return nullptr;
+    --it;
+    return id <= it->highId ? &*it : nullptr;
+}
+
+MessageView MessageTable::read_entry(uint32_t offset) const
+{
+    MessageView view;
+    if (offset == 0 || (size_t)offset + MESSAGE_ENTRY_MIN_SIZE > m_size)
+        return view;
+    size_t length = read_le16(m_data + offset);
+    if (length < MESSAGE_ENTRY_MIN_SIZE || length > m_size - offset)
+        return view;
+
+    view.text = m_data + offset + MESSAGE_ENTRY_MIN_SIZE;
+    view.unicode = (read_le16(m_data + offset + 2) & MESSAGE_RESOURCE_UNICODE) != 0;
+    size_t bytes = length - MESSAGE_ENTRY_MIN_SIZE;
+    // entries are null terminated and padded to 32 bits
+    if (view.unicode)
+    {
+        view.length = bytes / 2;
+        while (view.length > 0 && read_le16(view.text + (view.length - 1) * 2) == 0)
+            view.length--;
+    }
+    else
+    {
+        view.length = bytes;
+        while (view.length > 0 && view.text[view.length - 1] == 0)
+            view.length--;
+    }
+    return view;
+}
+
+MessageView MessageTable::lookup(uint32_t id) const
+{
+    const Block *block = find_block(id);
+    if (block == nullptr)
+        return MessageView();
+    if (!m_entries.empty())
+        return read_entry(m_entries[block->firstEntry + (id - block->lowId)]);
+
+    size_t offset = block->offset;
+    for (uint32_t i = block->lowId; i < id; i++)
+    {
+        size_t length = offset + MESSAGE_ENTRY_MIN_SIZE <= m_size ? read_le16(m_data + offset) : 0;
+        if (length < MESSAGE_ENTRY_MIN_SIZE || length > m_size - offset)
+            return MessageView();
+        offset += length;
+    }
+    return read_entry((uint32_t)offset);
+}
+
+}
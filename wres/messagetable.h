@@ -0,0 +1,115 @@
+#ifndef MESSAGETABLE_H
+#define MESSAGETABLE_H
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wres
+{
+
+class WinLibrary;
+
+/*
+ * One message of a message table. The text is a view of the resource data
+ * in its stored encoding, either ANSI (in the code page of the table's
+ * language) or UTF-16LE, without the trailing null characters. Messages
+ * usually end with "\r\n".
+ */
+struct MessageView
+{
+    const uint8_t *text = nullptr;
+    /* in bytes for ANSI, in UTF-16 code units for Unicode messages */
+    size_t length = 0;
+    bool unicode = false;
+
+    bool isValid() const { return text != nullptr; }
+    /* Empty if the message is not ANSI */
+    std::string_view ansi() const
+    {
+        return unicode ? std::string_view() : std::string_view((const char*)text, length);
+    }
+    /* Empty if the message is not Unicode, or not 2-byte aligned (a malformed entry) */
+    std::u16string_view utf16() const
+    {
+        if (!unicode || ((uintptr_t)text & 1) != 0)
+            return std::u16string_view();
+        return std::u16string_view((const char16_t*)text, length);
+    }
+};
+
+class MessageTable
+{
+public:
+    /*
+     * MessageTable reads RT_MESSAGELIST (RT_MESSAGETABLE) resources, the
+     * event log and FormatMessage texts. The data is a list of blocks, each
+     * covering a range of message ids with the entries stored one after
+     * the other.
+     *
+     * Parsing validates the block list and sorts it by id; lookup() is a
+     * binary search over the blocks followed by a walk over the entries of
+     * the block. buildIndex() flattens the entry offsets of all blocks so
+     * that the walk becomes an array access, which pays off for tables
+     * that are looked up a lot. Lookups never allocate.
+     *
+     * The data has to outlive the table.
+     */
+    MessageTable() = default;
+
+    /*
+     * Parses the given message table data. Returns false if the data is
+     * not a message table; blocks that point outside of it, or that cover
+     * more ids than the data has room for entries, are dropped.
+     */
+    bool parse(const uint8_t *data, size_t size);
+    /*
+     * Parses the first message table of the library (in the given
+     * language, if not empty).
+     */
+    bool load(WinLibrary& library, const std::string& language = "");
+
+    bool isValid() const;
+    /* Returns the number of message ids covered by the blocks */
+    size_t size() const;
+
+    /*
+     * Flattens the entries of all blocks into a dense index. Entries that
+     * run past the end of the data are marked as missing. The index holds
+     * at most one offset per 4 bytes of data; returns false, leaving the
+     * table without an index, if it can not be allocated.
+     */
+    bool buildIndex();
+
+    /*
+     * Returns the message with the given id, or an invalid view if there
+     * is no such message.
+     */
+    MessageView lookup(uint32_t id) const;
+
+private:
+    struct Block
+    {
+        uint32_t lowId;
+        uint32_t highId;
+        uint32_t offset;
+        /* index of the block's first entry in m_entries */
+        uint32_t firstEntry;
+    };
+
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+    bool m_isValid = false;
+    /* sorted by lowId, ranges do not overlap */
+    std::vector<Block> m_blocks;
+    /* offset of each entry in the data, 0 if missing; empty without index */
+    std::vector<uint32_t> m_entries;
+
+    const Block* find_block(uint32_t id) const;
+    MessageView read_entry(uint32_t offset) const;
+};
+
+}
+
+#endif // MESSAGETABLE_H
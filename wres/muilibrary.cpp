@@ -0,0 +1,222 @@
+#include "muilibrary.h"
+#include "winlibrary.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <map>
+
+namespace wres
+{
+
+/*
+ * Offsets of the MUI resource configuration. The header is followed by
+ * the lists it points to; offsets are relative to the start of the data
+ * and lengths are in bytes.
+ */
+#define MUI_OFFSET_SIGNATURE            0x00
+#define MUI_OFFSET_SIZE                 0x04
+#define MUI_OFFSET_FILE_TYPE            0x10
+#define MUI_OFFSET_MAIN_NAME_TYPES      0x54
+#define MUI_OFFSET_MAIN_ID_TYPES        0x5C
+#define MUI_OFFSET_MUI_NAME_TYPES       0x64
+#define MUI_OFFSET_MUI_ID_TYPES         0x6C
+#define MUI_OFFSET_LANGUAGE             0x74
+#define MUI_OFFSET_FALLBACK_LANGUAGE    0x7C
+#define MUI_HEADER_SIZE                 0x84
+
+/* Returns the list at the given offset/length pair, or false if it is out of bounds */
+static bool mui_list(const uint8_t *data, size_t size, size_t field, const uint8_t **list, size_t *length)
+{
+    uint32_t offset = read_le32(data + field);
+    *length = read_le32(data + field + 4);
+    *list = data + offset;
+    return *length == 0 || (offset <= size && *length <= size - offset);
+}
+
+/* Reads a list of null terminated UTF-16LE strings, ending at an empty one */
+static void read_multi_string(const uint8_t *list, size_t length, std::vector<std::string>& out)
+{
+    size_t start = 0;
+    for (size_t i = 0; i + 2 <= length; i += 2)
+    {
+        if (read_le16(list + i) != 0)
+            continue;
+        if (i == start)
+            break;
+        std::string s;
+        append_utf16le_as_utf8(s, list + start, (i - start) / 2);
+        out.push_back(s);
+        start = i + 2;
+    }
+}
+
+bool parse_mui_config(const uint8_t *data, size_t size, MuiConfig *config)
+{
+    *config = MuiConfig();
+    if (data == nullptr || size < MUI_HEADER_SIZE || read_le32(data + MUI_OFFSET_SIGNATURE) != MUI_SIGNATURE)
+        return false;
+    // the declared size may only shrink the data
+    size = std::min<size_t>(size, std::max<uint32_t>(MUI_HEADER_SIZE, read_le32(data + MUI_OFFSET_SIZE)));
+    config->fileType = read_le32(data + MUI_OFFSET_FILE_TYPE);
+
+    const uint8_t *list;
+    size_t length;
+    if (!mui_list(data, size, MUI_OFFSET_MAIN_NAME_TYPES, &list, &length))
+        return false;
+    read_multi_string(list, length, config->mainNameTypes);
+    if (!mui_list(data, size, MUI_OFFSET_MUI_NAME_TYPES, &list, &length))
+        return false;
+    read_multi_string(list, length, config->muiNameTypes);
+
+    if (!mui_list(data, size, MUI_OFFSET_MAIN_ID_TYPES, &list, &length))
+        return false;
+    for (size_t i = 0; i + 4 <= length; i += 4)
+        config->mainIdTypes.push_back(read_le32(list + i));
+    if (!mui_list(data, size, MUI_OFFSET_MUI_ID_TYPES, &list, &length))
+        return false;
+    for (size_t i = 0; i + 4 <= length; i += 4)
+        config->muiIdTypes.push_back(read_le32(list + i));
+
+    std::vector<std::string> language;
+    if (!mui_list(data, size, MUI_OFFSET_LANGUAGE, &list, &length))
+        return false;
+    read_multi_string(list, length, language);
+    if (!language.empty())
+        config->language = language[0];
+    language.clear();
+    if (!mui_list(data, size, MUI_OFFSET_FALLBACK_LANGUAGE, &list, &length))
+        return false;
+    read_multi_string(list, length, language);
+    if (!language.empty())
+        config->fallbackLanguage = language[0];
+    return true;
+}
+
+MuiLibrary::MuiLibrary(const std::string& path, const std::vector<std::string>& languages)
+    : m_main(new WinLibrary(path)), m_languages(languages)
+{
+    WinResource *mui = m_main->isValid()
+        ? m_main->findResource(std::string("MUI"), std::string(""), std::string("")) : nullptr;
+    std::vector<WinResource*> configs = m_main->collectResources(mui);
+    if (mui != nullptr && !configs.empty())
+        m_hasConfig = parse_mui_config((const uint8_t*)configs[0]->offset(), configs[0]->size(), &m_config);
+}
+
+MuiLibrary::~MuiLibrary()
+{
+}
+
+void MuiLibrary::open_satellite()
+{
+    std::string path = m_main->path();
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    std::string file = slash == std::string::npos ? path : path.substr(slash + 1);
+    for (auto &language : m_languages)
+    {
+        std::string candidate = dir + language + "/" + file + ".mui";
+        struct stat st;
+        if (stat(candidate.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        std::unique_ptr<WinLibrary> library(new WinLibrary(candidate));
+        if (library->isValid())
+        {
+            m_satellite = std::move(library);
+            m_satellitePath = candidate;
+            return;
+        }
+    }
+}
+
+WinLibrary* MuiLibrary::satellite()
+{
+    std::call_once(m_satelliteOnce, [this]()
+    {
+        open_satellite();
+        m_satelliteOpened.store(true, std::memory_order_release);
+    });
+    return m_satellite.get();
+}
+
+std::string MuiLibrary::satellitePath() const
+{
+    return m_satelliteOpened.load(std::memory_order_acquire) ? m_satellitePath : std::string();
+}
+
+bool MuiLibrary::isLocalizedType(const std::string& type) const
+{
+    int32_t id;
+    if (parse_int32(type.c_str(), &id))
+        return std::find(m_config.muiIdTypes.begin(), m_config.muiIdTypes.end(), (uint32_t)id) != m_config.muiIdTypes.end();
+    return std::find(m_config.muiNameTypes.begin(), m_config.muiNameTypes.end(), type) != m_config.muiNameTypes.end();
+}
+
+MuiResource MuiLibrary::findResource(const std::string& type, const std::string& name, const std::string& language)
+{
+    if (!m_main->isValid())
+        return MuiResource();
+    bool localized = m_hasConfig && isLocalizedType(type);
+    if (!localized)
+    {
+        WinResource *r = m_main->findResource(type, name, language);
+        // without a configuration anything may have moved to the satellite
+        if (r != nullptr || m_hasConfig)
+            return { m_main.get(), r, false };
+    }
+    if (satellite() != nullptr)
+    {
+        WinResource *r = m_satellite->findResource(type, name, language);
+        if (r != nullptr)
+            return { m_satellite.get(), r, true };
+    }
+    if (localized)
+        return { m_main.get(), m_main->findResource(type, name, language), false };
+    return MuiResource();
+}
+
+/* Appends the data resources of a type in library to out; false if it has none */
+static bool collect_type(WinLibrary *library, const std::string& type, bool localized, std::vector<MuiResource>& out)
+{
+    WinResource *dir = library->findResource(type, std::string(""), std::string(""));
+    if (dir == nullptr)
+        return false;
+    for (auto r : library->collectResources(dir))
+        out.push_back({ library, r, localized });
+    return true;
+}
+
+std::vector<MuiResource> MuiLibrary::collectResources(const std::string& type)
+{
+    std::vector<MuiResource> result;
+    if (!m_main->isValid())
+        return result;
+    if (!m_hasConfig)
+    {
+        // one merged list, in which the satellite's version of a resource wins
+        collect_type(m_main.get(), type, false, result);
+        std::vector<MuiResource> satelliteResources;
+        if (satellite() == nullptr || !collect_type(m_satellite.get(), type, true, satelliteResources))
+            return result;
+        std::map<std::pair<std::string, std::string>, size_t> mainIndex;
+        for (size_t i = 0; i < result.size(); i++)
+            mainIndex[{ result[i].resource->name(), result[i].resource->language() }] = i;
+        for (auto &r : satelliteResources)
+        {
+            auto it = mainIndex.find({ r.resource->name(), r.resource->language() });
+            if (it != mainIndex.end())
+                result[it->second] = r;
+            else
+                result.push_back(r);
+        }
+        return result;
+    }
+    bool localized = isLocalizedType(type);
+    if (!localized && collect_type(m_main.get(), type, false, result))
+        return result;
+    if (satellite() != nullptr && collect_type(m_satellite.get(), type, true, result))
+        return result;
+    if (localized)
+        collect_type(m_main.get(), type, false, result);
+    return result;
+}
+
+}
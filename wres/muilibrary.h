@@ -0,0 +1,123 @@
+#ifndef MUILIBRARY_H
+#define MUILIBRARY_H
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace wres
+{
+
+class WinLibrary;
+class WinResource;
+
+/* Signature of the MUI resource configuration */
+#define MUI_SIGNATURE       0xFECDFECD
+/* File types of the MUI resource configuration */
+#define MUI_FILETYPE_LN     0x11
+#define MUI_FILETYPE_MUI    0x12
+
+/*
+ * The resource configuration stored in the "MUI" resource of a language
+ * neutral file and of its .mui satellites. It names the resource types
+ * that stay in the main (language neutral) file and those that are moved
+ * to the satellites; numeric types are listed as ids, named types as
+ * names. language is set in satellites, e.g. "de-DE".
+ */
+struct MuiConfig
+{
+    uint32_t fileType = 0;
+    std::vector<uint32_t> mainIdTypes;
+    std::vector<std::string> mainNameTypes;
+    std::vector<uint32_t> muiIdTypes;
+    std::vector<std::string> muiNameTypes;
+    std::string language;
+    std::string fallbackLanguage;
+};
+
+/*
+ * Parses the data of a "MUI" resource. Returns false if the signature or
+ * one of the lists is invalid.
+ */
+bool parse_mui_config(const uint8_t *data, size_t size, MuiConfig *config);
+
+/*
+ * A resource found through a MuiLibrary, along with the library it lives
+ * in (needed e.g. to extract it).
+ */
+struct MuiResource
+{
+    WinLibrary *library = nullptr;
+    WinResource *resource = nullptr;
+    /* true if the resource comes from the satellite */
+    bool localized = false;
+
+    bool isValid() const { return resource != nullptr; }
+};
+
+class MuiLibrary
+{
+public:
+    /*
+     * MuiLibrary combines a language neutral file with its localized .mui
+     * satellite, which for "dir/file.dll" is "dir/<language>/file.dll.mui".
+     * The first language of the list that has a satellite is used.
+     *
+     * Lookups of types that the MUI configuration of the main file assigns
+     * to satellites go to the satellite (then the main file), all others
+     * to the main file only; without a configuration, findResource() tries
+     * the main file first, then the satellite, and collectResources()
+     * merges both, a resource with the same name and language in the
+     * satellite replacing the main file's. Neither tree is copied: results
+     * point into the library they come from. The satellite is searched for
+     * and opened on the first lookup that needs it, so a process that only
+     * reads language neutral resources never touches it. Lookups may run
+     * concurrently.
+     */
+    MuiLibrary(const std::string& path, const std::vector<std::string>& languages);
+    ~MuiLibrary();
+
+    WinLibrary& library() { return *m_main; }
+    /* Opens the satellite if needed. Returns nullptr if there is none. */
+    WinLibrary* satellite();
+    /* Path of the satellite; empty until it is opened or if there is none */
+    std::string satellitePath() const;
+
+    bool hasConfig() const { return m_hasConfig; }
+    const MuiConfig& config() const { return m_config; }
+
+    /*
+     * Returns true if resources of this type live in satellites according
+     * to the MUI configuration of the main file.
+     */
+    bool isLocalizedType(const std::string& type) const;
+
+    /* Same as WinLibrary::findResource(), over the merged view */
+    MuiResource findResource(const std::string& type, const std::string& name, const std::string& language);
+    /*
+     * Returns every data resource of the given type from the library that
+     * holds it, as WinLibrary::collectResources() does; from both of them
+     * if there is no MUI configuration.
+     */
+    std::vector<MuiResource> collectResources(const std::string& type);
+
+private:
+    std::unique_ptr<WinLibrary> m_main;
+    std::vector<std::string> m_languages;
+    bool m_hasConfig = false;
+    MuiConfig m_config;
+
+    std::once_flag m_satelliteOnce;
+    std::unique_ptr<WinLibrary> m_satellite;
+    std::string m_satellitePath;
+    std::atomic<bool> m_satelliteOpened { false };
+
+    void open_satellite();
+};
+
+}
+
+#endif // MUILIBRARY_H
@@ -0,0 +1,42 @@
+#include "parsestatus.h"
+#include <stdio.h>
+
+namespace wres
+{
+
+const char *parse_error_to_string(ParseError code)
+{
+    switch (code)
+    {
+    case ParseError::None: return "no error";
+    case ParseError::OpenFailed: return "could not open the file";
+    case ParseError::EmptyFile: return "empty file";
+    case ParseError::ReadFailed: return "could not read the file";
+    case ParseError::BadHeader: return "not a PE or NE library";
+    case ParseError::BadSections: return "invalid sections layout";
+    case ParseError::NoResources: return "no resources";
+    case ParseError::Truncated: return "premature end";
+    case ParseError::Malformed: return "malformed resource structure";
+    case ParseError::LimitExceeded: return "parse limit exceeded";
+    }
+    return "unknown error";
+}
+
+const char *format_parse_status(const ParseStatus& status, const char *path)
+{
+    static thread_local char buffer[512];
+    int length = 0;
+    if (path != nullptr)
+        length = snprintf(buffer, sizeof(buffer), "%s: ", path);
+    if (length < 0 || (size_t)length >= sizeof(buffer))
+        length = 0;
+    // errors of the file itself have no position
+    if (status.code <= ParseError::ReadFailed)
+        snprintf(buffer + length, sizeof(buffer) - length, "%s", parse_error_to_string(status.code));
+    else
+        snprintf(buffer + length, sizeof(buffer) - length, "%s at 0x%zx (%s)", parse_error_to_string(status.code),
+                 status.offset, status.context ? status.context : "?");
+    return buffer;
+}
+
+}
@@ -0,0 +1,80 @@
+#ifndef PARSESTATUS_H
+#define PARSESTATUS_H
+#include <stddef.h>
+#include <stdint.h>
+
+namespace wres
+{
+
+/* What went wrong while opening a library */
+enum class ParseError : uint8_t
+{
+    None = 0,
+    /* the file could not be found or opened */
+    OpenFailed,
+    EmptyFile,
+    ReadFailed,
+    /* neither a PE nor an NE file, or an unknown header layout */
+    BadHeader,
+    /* sections that overlap the headers */
+    BadSections,
+    NoResources,
+    /* a structure extends past the end of the data */
+    Truncated,
+    /* the resource tree is inconsistent */
+    Malformed,
+    /* one of the ParseLimits was reached; context names it */
+    LimitExceeded
+};
+
+/*
+ * Upper bounds on the work and memory spent opening a library, so that
+ * crafted files (resource bombs) cannot make the loader allocate huge
+ * amounts or walk the same directories over and over. Parsing stops at
+ * the first limit reached, with ParseError::LimitExceeded; what was read
+ * up to that point stays available.
+ */
+struct ParseLimits
+{
+    /* resources (directories and data entries) in the tree */
+    size_t maxNodes = 1 << 18;
+    /* levels below the root; PE and NE trees have 3 (type, name, language) */
+    int maxDepth = 3;
+    /* sum of the sizes of all data resources, which may overlap */
+    uint64_t maxDeclaredBytes = (uint64_t)1 << 32;
+    /* memory for the file and for the loaded image, the sections laid out as when mapped */
+    size_t maxAllocation = (size_t)1 << 30;
+};
+
+/*
+ * ParseStatus describes the first problem found while opening a library:
+ * what it was, the byte offset in the loaded image where it was found and
+ * a static string naming the structure or step, e.g. "resource directory".
+ * Recording a status is a few stores; nothing is formatted or locked, so
+ * scanning many malformed files stays cheap and each library (thread)
+ * keeps its own status.
+ */
+struct ParseStatus
+{
+    ParseError code = ParseError::None;
+    size_t offset = 0;
+    const char *context = nullptr;
+
+    bool ok() const { return code == ParseError::None; }
+};
+
+/*
+ * Returns a short human readable name of the error.
+ */
+const char *parse_error_to_string(ParseError code);
+
+/*
+ * Formats a status as "path: error at 0x... (context)". The text lives in
+ * a thread local buffer and is valid until the next call on the same
+ * thread.
+ */
+const char *format_parse_status(const ParseStatus& status, const char *path = nullptr);
+
+}
+
+#endif // PARSESTATUS_H
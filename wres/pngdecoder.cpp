@@ -0,0 +1,469 @@
+#include "pngdecoder.h"
+#include "imageinfo.h"
+#include "inflate.h"
+#include "threadpool.h"
+#include "wresutil.h"
+#include <atomic>
+#include <stdlib.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace wres
+{
+
+#define PNG_FILTER_NONE     0
+#define PNG_FILTER_SUB      1
+#define PNG_FILTER_UP       2
+#define PNG_FILTER_AVG      3
+#define PNG_FILTER_PAETH    4
+
+/* Adam7 interlacing passes */
+static const uint8_t adam7_x_start[7] = { 0, 4, 0, 2, 0, 1, 0 };
+static const uint8_t adam7_y_start[7] = { 0, 0, 4, 0, 2, 0, 1 };
+static const uint8_t adam7_x_step[7]  = { 8, 8, 4, 4, 2, 2, 1 };
+static const uint8_t adam7_y_step[7]  = { 8, 8, 8, 4, 4, 2, 2 };
+
+struct PngDecoder
+{
+    ImageInfo info;
+    ImageBuffer out;
+    unsigned bitsPerPixel;
+    /* bytes per complete pixel, as used by the filters (at least 1) */
+    size_t bpp;
+
+    const uint8_t *palette = nullptr;
+    size_t paletteSize = 0;
+    const uint8_t *trns = nullptr;
+    size_t trnsSize = 0;
+
+    /* palette and low bit depth gray images are converted via a lookup table */
+    bool useLut = false;
+    uint32_t lut[256];
+};
+
+static inline size_t png_row_bytes(uint32_t width, unsigned bitsPerPixel)
+{
+    return ((uint64_t)width * bitsPerPixel + 7) / 8;
+}
+
+static inline uint8_t paeth_predictor(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return (uint8_t)a;
+    if (pb <= pc)
+        return (uint8_t)b;
+    return (uint8_t)c;
+}
+
+#if defined(__SSE2__)
+static inline __m128i load_pixel(const uint8_t *p, size_t bpp)
+{
+    int v = 0;
+    memcpy(&v, p, bpp);
+    return _mm_cvtsi32_si128(v);
+}
+
+static inline void store_pixel_bytes(uint8_t *p, __m128i v, size_t bpp)
+{
+    int x = _mm_cvtsi128_si32(v);
+    memcpy(p, &x, bpp);
+}
+
+static inline __m128i abs_epi16(__m128i x)
+{
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static inline __m128i if_then_else(__m128i c, __m128i t, __m128i e)
+{
+    return _mm_or_si128(_mm_and_si128(c, t), _mm_andnot_si128(c, e));
+}
+
+/* Sub, Avg and Paeth depend on the previous pixel, so they are vectorized
+ * across the channels of one pixel (3 or 4 bytes) */
+static void unfilter_sub_sse2(uint8_t *row, size_t len, size_t bpp)
+{
+    __m128i a = _mm_setzero_si128();
+    for (size_t i = 0; i + bpp <= len; i += bpp)
+    {
+        a = _mm_add_epi8(a, load_pixel(row + i, bpp));
+        store_pixel_bytes(row + i, a, bpp);
+    }
+}
+
+static void unfilter_avg_sse2(uint8_t *row, const uint8_t *prev, size_t len, size_t bpp)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a = _mm_setzero_si128();
+    for (size_t i = 0; i + bpp <= len; i += bpp)
+    {
+        __m128i b = load_pixel(prev + i, bpp);
+        /* _mm_avg_epu8 rounds up; PNG wants (a + b) >> 1 */
+        __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(avg, load_pixel(row + i, bpp));
+        store_pixel_bytes(row + i, a, bpp);
+    }
+}
+
+static void unfilter_paeth_sse2(uint8_t *row, const uint8_t *prev, size_t len, size_t bpp)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero, c = zero;
+    for (size_t i = 0; i + bpp <= len; i += bpp)
+    {
+        __m128i b = _mm_unpacklo_epi8(load_pixel(prev + i, bpp), zero);
+        __m128i x = load_pixel(row + i, bpp);
+
+        /* p = a + b - c, so p - a = b - c and p - b = a - c */
+        __m128i pa = _mm_sub_epi16(b, c);
+        __m128i pb = _mm_sub_epi16(a, c);
+        __m128i pc = _mm_add_epi16(pa, pb);
+        pa = abs_epi16(pa);
+        pb = abs_epi16(pb);
+        pc = abs_epi16(pc);
+        __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+        __m128i nearest = if_then_else(_mm_cmpeq_epi16(smallest, pb), b, c);
+        nearest = if_then_else(_mm_cmpeq_epi16(smallest, pa), a, nearest);
+
+        __m128i r = _mm_add_epi8(_mm_packus_epi16(nearest, nearest), x);
+        store_pixel_bytes(row + i, r, bpp);
+        a = _mm_unpacklo_epi8(r, zero);
+        c = b;
+    }
+}
+#endif
+
+static bool unfilter_row(uint8_t filter, uint8_t *row, const uint8_t *prev, size_t len, size_t bpp)
+{
+    size_t i;
+    switch (filter)
+    {
+        case PNG_FILTER_NONE:
+            return true;
+        case PNG_FILTER_SUB:
+#if defined(__SSE2__)
+            if (bpp == 3 || bpp == 4)
+            {
+                unfilter_sub_sse2(row, len, bpp);
+                return true;
+            }
+#endif
+            for (i = bpp; i < len; i++)
+                row[i] += row[i - bpp];
+            return true;
+        case PNG_FILTER_UP:
+            i = 0;
+#if defined(__SSE2__)
+            for (; i + 16 <= len; i += 16)
+            {
+                __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+                __m128i b = _mm_loadu_si128((const __m128i*)(prev + i));
+                _mm_storeu_si128((__m128i*)(row + i), _mm_add_epi8(x, b));
+            }
+#endif
+            for (; i < len; i++)
+                row[i] += prev[i];
+            return true;
+        case PNG_FILTER_AVG:
+#if defined(__SSE2__)
+            if (bpp == 3 || bpp == 4)
+            {
+                unfilter_avg_sse2(row, prev, len, bpp);
+                return true;
+            }
+#endif
+            for (i = 0; i < bpp && i < len; i++)
+                row[i] += prev[i] >> 1;
+            for (; i < len; i++)
+                row[i] += (row[i - bpp] + prev[i]) >> 1;
+            return true;
+        case PNG_FILTER_PAETH:
+#if defined(__SSE2__)
+            if (bpp == 3 || bpp == 4)
+            {
+                unfilter_paeth_sse2(row, prev, len, bpp);
+                return true;
+            }
+#endif
+            for (i = 0; i < bpp && i < len; i++)
+                row[i] += prev[i];
+            for (; i < len; i++)
+                row[i] += paeth_predictor(row[i - bpp], prev[i], prev[i - bpp]);
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void build_lut(PngDecoder *d)
+{
+    const ImageInfo &info = d->info;
+    PixelFormat format = d->out.format;
+    bool premultiplied = d->out.premultiplied;
+    uint8_t *lut = (uint8_t*)d->lut;
+
+    if (info.colorType == PNG_COLOR_PALETTE)
+    {
+        for (size_t i = 0; i < 256; i++)
+        {
+            if (i < d->paletteSize)
+            {
+                const uint8_t *rgb = d->palette + i * 3;
+                uint8_t a = i < d->trnsSize ? d->trns[i] : 255;
+                store_pixel(lut + i * 4, rgb[0], rgb[1], rgb[2], a, format, premultiplied);
+            }
+            else
+            {
+                store_pixel(lut + i * 4, 0, 0, 0, 255, format, premultiplied);
+            }
+        }
+    }
+    else
+    {
+        /* gray with 1, 2, 4 or 8 bits; tRNS holds a 16-bit gray key */
+        unsigned levels = 1u << info.bitDepth;
+        int key = d->trnsSize >= 2 ? (int)((d->trns[0] << 8) | d->trns[1]) : -1;
+        for (unsigned v = 0; v < levels; v++)
+        {
+            uint8_t g = (uint8_t)(v * 255 / (levels - 1));
+            uint8_t a = (int)v == key ? 0 : 255;
+            store_pixel(lut + v * 4, g, g, g, a, format, premultiplied);
+        }
+    }
+    d->useLut = true;
+}
+
+static void convert_row(const PngDecoder *d, const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const ImageInfo &info = d->info;
+    PixelFormat format = d->out.format;
+    bool premultiplied = d->out.premultiplied;
+    uint32_t x;
+
+    if (d->useLut)
+    {
+        if (info.bitDepth == 8)
+        {
+            for (x = 0; x < width; x++)
+                memcpy(dst + x * 4, &d->lut[src[x]], 4);
+            return;
+        }
+        unsigned depth = info.bitDepth;
+        unsigned mask = (1u << depth) - 1;
+        for (x = 0; x < width; x++)
+        {
+            size_t bit = (size_t)x * depth;
+            unsigned v = (src[bit >> 3] >> (8 - depth - (bit & 7))) & mask;
+            memcpy(dst + x * 4, &d->lut[v], 4);
+        }
+        return;
+    }
+
+    /* 16-bit samples are reduced to their most significant byte */
+    size_t step = info.bitDepth == 16 ? 2 : 1;
+    const uint8_t *k = d->trns;
+    bool has_key = d->trns != nullptr;
+
+    switch (info.colorType)
+    {
+        case PNG_COLOR_RGBA:
+            if (step == 1)
+            {
+                convert_pixels_32(src, dst, width, format == PixelFormat::BGRA, premultiplied);
+                return;
+            }
+            for (x = 0; x < width; x++, src += 8)
+                store_pixel(dst + x * 4, src[0], src[2], src[4], src[6], format, premultiplied);
+            return;
+        case PNG_COLOR_RGB:
+            has_key = has_key && d->trnsSize >= 6;
+            for (x = 0; x < width; x++, src += 3 * step)
+            {
+                uint8_t a = 255;
+                if (has_key)
+                {
+                    bool match = step == 1
+                        ? (src[0] == k[1] && src[1] == k[3] && src[2] == k[5] && !k[0] && !k[2] && !k[4])
+                        : memcmp(src, k, 6) == 0;
+                    if (match)
+                        a = 0;
+                }
+                store_pixel(dst + x * 4, src[0], src[step], src[2 * step], a, format, premultiplied);
+            }
+            return;
+        case PNG_COLOR_GRAY_ALPHA:
+            for (x = 0; x < width; x++, src += 2 * step)
+                store_pixel(dst + x * 4, src[0], src[0], src[0], src[step], format, premultiplied);
+            return;
+        case PNG_COLOR_GRAY:
+            /* only 16-bit gray ends up here */
+            has_key = has_key && d->trnsSize >= 2;
+            for (x = 0; x < width; x++, src += 2)
+            {
+                uint8_t a = (has_key && src[0] == k[0] && src[1] == k[1]) ? 0 : 255;
+                store_pixel(dst + x * 4, src[0], src[0], src[0], a, format, premultiplied);
+            }
+            return;
+    }
+}
+
+/*
+ * Unfilters and converts one (sub)image of filtered rows. For interlaced
+ * images, every converted row is scattered to its place in the output.
+ */
+static bool decode_pass(const PngDecoder *d, uint8_t *rows, const uint8_t *zero_row,
+                        uint32_t width, uint32_t height, int pass, uint8_t *temp)
+{
+    size_t row_bytes = png_row_bytes(width, d->bitsPerPixel);
+    const ImageBuffer &out = d->out;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint8_t *row = rows + y * (row_bytes + 1);
+        const uint8_t *prev = y == 0 ? zero_row : row - row_bytes;
+        if (!unfilter_row(row[0], row + 1, prev, row_bytes, d->bpp))
+            return false;
+
+        if (pass < 0)
+        {
+            convert_row(d, row + 1, out.pixels + y * out.stride, width);
+            continue;
+        }
+
+        convert_row(d, row + 1, temp, width);
+        uint8_t *dst = out.pixels + (adam7_y_start[pass] + (size_t)y * adam7_y_step[pass]) * out.stride;
+        for (uint32_t x = 0; x < width; x++)
+            memcpy(dst + (adam7_x_start[pass] + (size_t)x * adam7_x_step[pass]) * 4, temp + x * 4, 4);
+    }
+    return true;
+}
+
+bool decode_png(const uint8_t *data, size_t size, const ImageBuffer& out)
+{
+    static thread_local std::vector<InflateSegment> idat;
+    static thread_local std::vector<uint8_t> scratch;
+    static thread_local std::vector<uint8_t> temp;
+    PngDecoder d;
+
+    if (!read_image_info(data, size, &d.info) || d.info.format != ContentType::PNG)
+        return false;
+    /* compression and filter method must both be 0 */
+    if (d.info.compression != 0 || data[16 + 11] != 0)
+        return false;
+    if (out.pixels == nullptr || out.width != d.info.width || out.height != d.info.height
+        || out.stride < (size_t)out.width * 4)
+        return false;
+    d.out = out;
+
+    /* collect the chunks we care about */
+    idat.clear();
+    size_t pos = 8;
+    while (pos + 12 <= size)
+    {
+        uint32_t length = read_be32(data + pos);
+        const uint8_t *type = data + pos + 4;
+        const uint8_t *chunk = data + pos + 8;
+        if (length > size - pos - 12)
+            return false;
+
+        if (memcmp(type, "IDAT", 4) == 0)
+        {
+            idat.push_back({ chunk, length });
+        }
+        else if (memcmp(type, "PLTE", 4) == 0)
+        {
+            if (length % 3 != 0 || length > 256 * 3)
+                return false;
+            d.palette = chunk;
+            d.paletteSize = length / 3;
+        }
+        else if (memcmp(type, "tRNS", 4) == 0)
+        {
+            d.trns = chunk;
+            d.trnsSize = length;
+        }
+        else if (memcmp(type, "IEND", 4) == 0)
+        {
+            break;
+        }
+        pos += 12 + (size_t)length;
+    }
+    if (idat.empty() || (d.info.colorType == PNG_COLOR_PALETTE && d.palette == nullptr))
+        return false;
+
+    static const unsigned channels[7] = { 1, 0, 3, 1, 2, 0, 4 };
+    d.bitsPerPixel = channels[d.info.colorType] * d.info.bitDepth;
+    d.bpp = std::max(1u, d.bitsPerPixel / 8);
+    if (d.info.colorType == PNG_COLOR_PALETTE || (d.info.colorType == PNG_COLOR_GRAY && d.info.bitDepth <= 8))
+        build_lut(&d);
+
+    /* size of the filtered data, one filter byte per row */
+    uint64_t total = 0;
+    if (!d.info.interlaced)
+    {
+        total = (uint64_t)d.info.height * (png_row_bytes(d.info.width, d.bitsPerPixel) + 1);
+    }
+    else
+    {
+        for (int pass = 0; pass < 7; pass++)
+        {
+            uint32_t pw = (d.info.width - adam7_x_start[pass] + adam7_x_step[pass] - 1) / adam7_x_step[pass];
+            uint32_t ph = (d.info.height - adam7_y_start[pass] + adam7_y_step[pass] - 1) / adam7_y_step[pass];
+            if (d.info.width <= adam7_x_start[pass] || d.info.height <= adam7_y_start[pass])
+                continue;
+            total += (uint64_t)ph * (png_row_bytes(pw, d.bitsPerPixel) + 1);
+        }
+    }
+    size_t row_bytes = png_row_bytes(d.info.width, d.bitsPerPixel);
+    if (total > SIZE_MAX / 2 || total + row_bytes > SIZE_MAX / 2)
+        return false;
+
+    /* a zero row to use as the row above the first one, then the image data */
+    scratch.resize(row_bytes + total);
+    memset(scratch.data(), 0, row_bytes);
+    uint8_t *rows = scratch.data() + row_bytes;
+
+    size_t written;
+    if (!inflate_zlib(idat.data(), idat.size(), rows, total, &written) || written != total)
+        return false;
+
+    if (!d.info.interlaced)
+        return decode_pass(&d, rows, scratch.data(), d.info.width, d.info.height, -1, nullptr);
+
+    temp.resize((size_t)d.info.width * 4);
+    for (int pass = 0; pass < 7; pass++)
+    {
+        if (d.info.width <= adam7_x_start[pass] || d.info.height <= adam7_y_start[pass])
+            continue;
+        uint32_t pw = (d.info.width - adam7_x_start[pass] + adam7_x_step[pass] - 1) / adam7_x_step[pass];
+        uint32_t ph = (d.info.height - adam7_y_start[pass] + adam7_y_step[pass] - 1) / adam7_y_step[pass];
+        if (!decode_pass(&d, rows, scratch.data(), pw, ph, pass, temp.data()))
+            return false;
+        rows += (size_t)ph * (png_row_bytes(pw, d.bitsPerPixel) + 1);
+    }
+    return true;
+}
+
+size_t decode_png_batch(std::vector<PngDecodeJob>& jobs, ThreadPool *pool)
+{
+    std::atomic<size_t> decoded { 0 };
+    if (pool == nullptr)
+        pool = &ThreadPool::global();
+
+    pool->parallelFor(jobs.size(), [&](size_t i)
+    {
+        PngDecodeJob &job = jobs[i];
+        job.decoded = decode_png(job.data, job.size, job.output);
+        if (job.decoded)
+            decoded.fetch_add(1, std::memory_order_relaxed);
+    });
+    return decoded.load();
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef PNGDECODER_H
+#define PNGDECODER_H
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "imagebuffer.h"
+
+namespace wres
+{
+
+class ThreadPool;
+
+/*
+ * Decodes a PNG image into the caller's buffer. The image is read straight
+ * from data (e.g. WinResource::offset() of an IMAGE resource), the IDAT
+ * chunks are inflated into a per-thread scratch buffer, and each row is
+ * unfiltered and converted as soon as it is available.
+ *
+ * All PNG color types, bit depths and interlacing are supported; 16-bit
+ * channels are reduced to 8 bits and tRNS transparency is applied. The
+ * buffer dimensions must match the image, which can be queried beforehand
+ * with read_image_info(). CRCs and the zlib checksum are not verified.
+ *
+ * Returns false if the image is malformed or the buffer does not match.
+ */
+bool decode_png(const uint8_t *data, size_t size, const ImageBuffer& out);
+
+/*
+ * One image of a batch decode. decoded is set once the image has been
+ * successfully decoded into output.
+ */
+struct PngDecodeJob
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    ImageBuffer output;
+    bool decoded = false;
+};
+
+/*
+ * Decodes many images concurrently on the given pool (or the global pool).
+ * Returns the number of images that were successfully decoded.
+ */
+size_t decode_png_batch(std::vector<PngDecodeJob>& jobs, ThreadPool *pool = nullptr);
+
+}
+
+#endif // PNGDECODER_H
@@ -0,0 +1,431 @@
+#include "pngencoder.h"
+#include "deflate.h"
+#include "inflate.h"
+#include "imageinfo.h"
+#include "threadpool.h"
+#include "wresutil.h"
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace wres
+{
+
+#define PNG_FILTER_NONE     0
+#define PNG_FILTER_SUB      1
+#define PNG_FILTER_UP       2
+#define PNG_FILTER_AVG      3
+#define PNG_FILTER_PAETH    4
+
+/* Filtered bytes per strip; every strip is deflated on its own */
+#define PNG_STRIP_BYTES (128 * 1024)
+
+/* Slicing-by-4 CRC-32 tables */
+struct Crc32Tables
+{
+    uint32_t t[4][256];
+
+    Crc32Tables()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            for (int k = 1; k < 4; k++)
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+        }
+    }
+};
+
+static const Crc32Tables& crc32_tables()
+{
+    static const Crc32Tables tables;
+    return tables;
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t size)
+{
+    const Crc32Tables& tables = crc32_tables();
+    crc = ~crc;
+    while (size >= 4)
+    {
+        crc ^= read_le32(data);
+        crc = tables.t[3][crc & 0xff] ^ tables.t[2][(crc >> 8) & 0xff] ^
+              tables.t[1][(crc >> 16) & 0xff] ^ tables.t[0][crc >> 24];
+        data += 4;
+        size -= 4;
+    }
+    while (size--)
+        crc = tables.t[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static inline void write_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static inline uint8_t paeth_predictor(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return (uint8_t)a;
+    if (pb <= pc)
+        return (uint8_t)b;
+    return (uint8_t)c;
+}
+
+/* Filters one byte; a, b and c are the left, up and upper left neighbours */
+template <int filter>
+static inline uint8_t filter_byte(uint8_t x, uint8_t a, uint8_t b, uint8_t c)
+{
+    switch (filter)
+    {
+    case PNG_FILTER_SUB:
+        return (uint8_t)(x - a);
+    case PNG_FILTER_UP:
+        return (uint8_t)(x - b);
+    case PNG_FILTER_AVG:
+        return (uint8_t)(x - ((a + b) >> 1));
+    case PNG_FILTER_PAETH:
+        return (uint8_t)(x - paeth_predictor(a, b, c));
+    default:
+        return x;
+    }
+}
+
+#if defined(__SSE2__)
+static inline __m128i abs_epi16(__m128i x)
+{
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static inline __m128i if_then_else(__m128i c, __m128i t, __m128i e)
+{
+    return _mm_or_si128(_mm_and_si128(c, t), _mm_andnot_si128(c, e));
+}
+
+/* Paeth predictor on 8 16-bit lanes */
+static inline __m128i paeth_epi16(__m128i a, __m128i b, __m128i c)
+{
+    __m128i pa = abs_epi16(_mm_sub_epi16(b, c));
+    __m128i pb = abs_epi16(_mm_sub_epi16(a, c));
+    __m128i pc = abs_epi16(_mm_sub_epi16(_mm_add_epi16(a, b), _mm_add_epi16(c, c)));
+    __m128i notA = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+    __m128i bc = if_then_else(_mm_cmpgt_epi16(pb, pc), c, b);
+    return if_then_else(notA, bc, a);
+}
+
+/*
+ * Unlike unfiltering, filtering only looks at unfiltered bytes, so every
+ * filter can process 16 bytes at a time.
+ */
+template <int filter>
+static inline __m128i filter_sse2(__m128i x, __m128i a, __m128i b, __m128i c)
+{
+    switch (filter)
+    {
+    case PNG_FILTER_SUB:
+        return _mm_sub_epi8(x, a);
+    case PNG_FILTER_UP:
+        return _mm_sub_epi8(x, b);
+    case PNG_FILTER_AVG:
+    {
+        // _mm_avg_epu8 rounds up, the filter rounds down
+        __m128i avg = _mm_avg_epu8(a, b);
+        avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+        return _mm_sub_epi8(x, avg);
+    }
+    case PNG_FILTER_PAETH:
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i lo = paeth_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero));
+        __m128i hi = paeth_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero));
+        return _mm_sub_epi8(x, _mm_packus_epi16(lo, hi));
+    }
+    default:
+        return x;
+    }
+}
+#endif
+
+/*
+ * Sum of the filtered bytes taken as signed values, the usual heuristic
+ * for picking the filter that compresses best.
+ */
+static size_t filtered_cost(const uint8_t *p, size_t len)
+{
+    size_t cost = 0;
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i absv = _mm_min_epu8(v, _mm_sub_epi8(zero, v));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(absv, zero));
+    }
+    cost = (size_t)_mm_cvtsi128_si32(acc) + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#endif
+    for (; i < len; i++)
+        cost += p[i] < 128 ? p[i] : 256 - p[i];
+    return cost;
+}
+
+/* Filters one row of len bytes with bpp bytes per pixel and returns its cost */
+template <int filter>
+static size_t filter_row(const uint8_t *row, const uint8_t *prev, size_t len, size_t bpp, uint8_t *out)
+{
+    size_t i = 0;
+    // the first pixel has no left neighbours
+    for (; i < bpp && i < len; i++)
+        out[i] = filter_byte<filter>(row[i], 0, prev[i], 0);
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+        __m128i a = _mm_loadu_si128((const __m128i*)(row + i - bpp));
+        __m128i b = _mm_loadu_si128((const __m128i*)(prev + i));
+        __m128i c = _mm_loadu_si128((const __m128i*)(prev + i - bpp));
+        _mm_storeu_si128((__m128i*)(out + i), filter_sse2<filter>(x, a, b, c));
+    }
+#endif
+    for (; i < len; i++)
+        out[i] = filter_byte<filter>(row[i], row[i - bpp], prev[i], prev[i - bpp]);
+    return filtered_cost(out, len);
+}
+
+typedef size_t (*FilterRowFunction)(const uint8_t*, const uint8_t*, size_t, size_t, uint8_t*);
+static const FilterRowFunction filter_functions[5] =
+{
+    filter_row<PNG_FILTER_NONE>,
+    filter_row<PNG_FILTER_SUB>,
+    filter_row<PNG_FILTER_UP>,
+    filter_row<PNG_FILTER_AVG>,
+    filter_row<PNG_FILTER_PAETH>
+};
+
+/* Converts one row of the image to straight RGBA, or RGB if alpha is not set */
+static void convert_row(const ImageBuffer& image, uint32_t y, bool alpha, uint8_t *dst)
+{
+    const uint8_t *src = image.pixels + (size_t)y * image.stride;
+    if (alpha && image.format == PixelFormat::RGBA && !image.premultiplied)
+    {
+        memcpy(dst, src, (size_t)image.width * 4);
+        return;
+    }
+    int ri = image.format == PixelFormat::RGBA ? 0 : 2;
+    int bi = 2 - ri;
+    for (uint32_t x = 0; x < image.width; x++, src += 4)
+    {
+        uint32_t r = src[ri], g = src[1], b = src[bi], a = src[3];
+        if (image.premultiplied && a != 255)
+        {
+            if (a == 0)
+                r = g = b = 0;
+            else
+            {
+                r = std::min<uint32_t>(255, (r * 255 + a / 2) / a);
+                g = std::min<uint32_t>(255, (g * 255 + a / 2) / a);
+                b = std::min<uint32_t>(255, (b * 255 + a / 2) / a);
+            }
+        }
+        dst[0] = (uint8_t)r;
+        dst[1] = (uint8_t)g;
+        dst[2] = (uint8_t)b;
+        if (alpha)
+        {
+            dst[3] = (uint8_t)a;
+            dst += 4;
+        }
+        else
+            dst += 3;
+    }
+}
+
+static bool is_opaque(const ImageBuffer& image)
+{
+    for (uint32_t y = 0; y < image.height; y++)
+    {
+        const uint8_t *row = image.pixels + (size_t)y * image.stride;
+        for (uint32_t x = 0; x < image.width; x++)
+        {
+            if (row[x * 4 + 3] != 255)
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * A horizontal strip of the image, filtered and compressed. The first strip
+ * starts with the zlib header; the last one is deflated as final.
+ */
+struct PngStrip
+{
+    std::vector<uint8_t> data;
+    /* Adler-32 and size of the filtered data */
+    uint32_t adler;
+    size_t filteredSize;
+    /* CRC of the chunk type and data */
+    uint32_t crc;
+};
+
+static void encode_strip(const ImageBuffer& image, bool alpha, uint32_t firstRow, uint32_t rows,
+                         bool last, PngStrip& strip)
+{
+    size_t bpp = alpha ? 4 : 3;
+    size_t rowBytes = (size_t)image.width * bpp;
+
+    thread_local std::vector<uint8_t> scratch;
+    thread_local std::vector<uint8_t> filtered;
+    scratch.resize(rowBytes * 4);
+    filtered.resize(rows * (rowBytes + 1));
+    uint8_t *prev = scratch.data();
+    uint8_t *cur = prev + rowBytes;
+    uint8_t *best = cur + rowBytes;
+    uint8_t *trial = best + rowBytes;
+
+    if (firstRow > 0)
+        convert_row(image, firstRow - 1, alpha, prev);
+    else
+        memset(prev, 0, rowBytes);
+
+    uint8_t *dst = filtered.data();
+    for (uint32_t y = firstRow; y < firstRow + rows; y++)
+    {
+        convert_row(image, y, alpha, cur);
+        size_t bestCost = (size_t)-1;
+        int bestFilter = PNG_FILTER_NONE;
+        for (int f = PNG_FILTER_NONE; f <= PNG_FILTER_PAETH; f++)
+        {
+            size_t cost = filter_functions[f](cur, prev, rowBytes, bpp, trial);
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestFilter = f;
+                std::swap(best, trial);
+            }
+        }
+        dst[0] = (uint8_t)bestFilter;
+        memcpy(dst + 1, best, rowBytes);
+        dst += rowBytes + 1;
+        std::swap(prev, cur);
+    }
+
+    strip.filteredSize = filtered.size();
+    strip.adler = adler32_update(1, filtered.data(), filtered.size());
+    strip.data.clear();
+    if (firstRow == 0)
+    {
+        // deflate with a 32k window, default compression level
+        strip.data.push_back(0x78);
+        strip.data.push_back(0x9C);
+    }
+    deflate_raw(filtered.data(), filtered.size(), last, strip.data);
+    strip.crc = crc32_update(crc32_update(0, (const uint8_t*)"IDAT", 4), strip.data.data(), strip.data.size());
+}
+
+static bool write_chunk(const PngWriteCallback& write, const char *type, const uint8_t *data, uint32_t size)
+{
+    uint8_t header[8], trailer[4];
+    write_be32(header, size);
+    memcpy(header + 4, type, 4);
+    uint32_t crc = crc32_update(0, header + 4, 4);
+    crc = crc32_update(crc, data, size);
+    write_be32(trailer, crc);
+    return write(header, 8) && (size == 0 || write(data, size)) && write(trailer, 4);
+}
+
+bool encode_png(const ImageBuffer& image, const PngWriteCallback& write, ThreadPool *pool)
+{
+    if (image.pixels == nullptr || image.width == 0 || image.height == 0 ||
+        image.width > 0x7fffffff / 4 || image.height > 0x7fffffff ||
+        image.stride < (size_t)image.width * 4)
+        return false;
+    if (pool == nullptr)
+        pool = &ThreadPool::global();
+
+    bool alpha = !is_opaque(image);
+    size_t rowBytes = (size_t)image.width * (alpha ? 4 : 3);
+    uint32_t stripRows = (uint32_t)std::max<size_t>(1, PNG_STRIP_BYTES / (rowBytes + 1));
+    uint32_t strips = (image.height + stripRows - 1) / stripRows;
+
+    uint8_t ihdr[13];
+    write_be32(ihdr, image.width);
+    write_be32(ihdr + 4, image.height);
+    ihdr[8] = 8;
+    ihdr[9] = alpha ? PNG_COLOR_RGBA : PNG_COLOR_RGB;
+    ihdr[10] = 0; // deflate
+    ihdr[11] = 0; // adaptive filtering
+    ihdr[12] = 0; // no interlacing
+    if (!write(png_signature, sizeof(png_signature)) || !write_chunk(write, "IHDR", ihdr, sizeof(ihdr)))
+        return false;
+
+    // strips are encoded a pool's worth at a time and written out in order
+    uint32_t wave = std::max(1u, pool->threadCount());
+    std::vector<PngStrip> encoded(std::min(wave, strips));
+    uint32_t adler = 1;
+    for (uint32_t first = 0; first < strips; first += wave)
+    {
+        uint32_t count = std::min(wave, strips - first);
+        pool->parallelFor(count, [&](size_t i)
+        {
+            uint32_t s = first + (uint32_t)i;
+            uint32_t row = s * stripRows;
+            encode_strip(image, alpha, row, std::min(stripRows, image.height - row),
+                         s == strips - 1, encoded[i]);
+        });
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            PngStrip& strip = encoded[i];
+            bool last = first + i == strips - 1;
+            adler = first + i == 0 ? strip.adler : adler32_combine(adler, strip.adler, strip.filteredSize);
+
+            uint8_t header[8], checksum[4], trailer[4];
+            uint32_t crc = strip.crc;
+            size_t size = strip.data.size();
+            if (last)
+            {
+                write_be32(checksum, adler);
+                crc = crc32_update(crc, checksum, 4);
+                size += 4;
+            }
+            write_be32(header, (uint32_t)size);
+            memcpy(header + 4, "IDAT", 4);
+            write_be32(trailer, crc);
+            if (!write(header, 8) || !write(strip.data.data(), strip.data.size()) ||
+                (last && !write(checksum, 4)) || !write(trailer, 4))
+                return false;
+        }
+    }
+
+    return write_chunk(write, "IEND", nullptr, 0);
+}
+
+bool encode_png(const ImageBuffer& image, std::vector<uint8_t>& out, ThreadPool *pool)
+{
+    return encode_png(image, [&out](const uint8_t *data, size_t size)
+    {
+        out.insert(out.end(), data, data + size);
+        return true;
+    }, pool);
+}
+
+}
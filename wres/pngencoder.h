@@ -0,0 +1,48 @@
+#ifndef PNGENCODER_H
+#define PNGENCODER_H
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <vector>
+#include "imagebuffer.h"
+
+namespace wres
+{
+
+class ThreadPool;
+
+/*
+ * Receives the encoded PNG stream piece by piece, in order. Returning false
+ * aborts the encoding.
+ */
+typedef std::function<bool(const uint8_t *data, size_t size)> PngWriteCallback;
+
+/*
+ * Encodes a 32-bit image as an 8-bit RGBA PNG, or RGB if every pixel is
+ * opaque. Premultiplied input is converted back to straight alpha.
+ *
+ * The image is cut into horizontal strips that are filtered and deflated
+ * independently on the given pool (or the global pool); each strip becomes
+ * one IDAT chunk and is handed to write as soon as it and all strips before
+ * it are done, so the whole file never has to be held in memory. Every row
+ * uses the filter with the smallest sum of absolute differences, computed
+ * with SSE2 when available.
+ *
+ * Returns false if the image is empty or write fails.
+ */
+bool encode_png(const ImageBuffer& image, const PngWriteCallback& write, ThreadPool *pool = nullptr);
+
+/*
+ * Same as above, appending the encoded file to out.
+ */
+bool encode_png(const ImageBuffer& image, std::vector<uint8_t>& out, ThreadPool *pool = nullptr);
+
+/*
+ * Updates a CRC-32 (as used by PNG and zlib) with size bytes of data. Start
+ * with crc = 0.
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t size);
+
+}
+
+#endif // PNGENCODER_H
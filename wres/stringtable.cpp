@@ -0,0 +1,181 @@
+#include "stringtable.h"
+#include "winlibrary.h"
+#include <algorithm>
+
+namespace wres
+{
+
+/* Block ids are 1-based and derived from 16-bit string ids */
+#define STRING_TABLE_MAX_BLOCKS (65536 / STRING_TABLE_BLOCK_SIZE)
+
+/*
+ * Finds string index of a block. Returns false if the block is too short
+ * to hold it.
+ */
+static bool find_block_string(const uint8_t *data, size_t size, unsigned index,
+                              const uint8_t **text, size_t *length)
+{
+    size_t offset = 0;
+    for (unsigned i = 0; ; i++)
+    {
+        if (offset + 2 > size)
+            return false;
+        size_t len = read_le16(data + offset);
+        if (offset + 2 + len * 2 > size)
+            return false;
+        if (i == index)
+        {
+            *text = data + offset + 2;
+            *length = len;
+            return true;
+        }
+        offset += 2 + len * 2;
+    }
+}
+
+StringTable::StringTable(const WinLibrary& library)
+{
+    m_arenaLimit = std::min<size_t>(library.limits().maxAllocation, UINT32_MAX);
+    const WinResource *strings = library.findResource(std::string("6"), std::string(""), std::string(""));
+    for (auto r : library.collectResources(strings))
+    {
+        int32_t block;
+        if (!parse_int32(r->name().c_str(), &block) || block < 1 || block > STRING_TABLE_MAX_BLOCKS)
+            continue;
+
+        Language *language = nullptr;
+        for (auto &l : m_languages)
+        {
+            if (l->name == r->language())
+            {
+                language = l.get();
+                break;
+            }
+        }
+        if (language == nullptr)
+        {
+            m_languages.emplace_back(new Language);
+            language = m_languages.back().get();
+            language->name = r->language();
+        }
+        if (language->blocks.size() < (size_t)block)
+            language->blocks.resize(block);
+        language->blocks[block - 1].data = (const uint8_t*)r->offset();
+        language->blocks[block - 1].size = r->size();
+    }
+}
+
+StringTable::~StringTable()
+{
+}
+
+std::vector<std::string> StringTable::languages() const
+{
+    std::vector<std::string> result;
+    for (auto &l : m_languages)
+        result.push_back(l->name);
+    return result;
+}
+
+StringTable::Language* StringTable::language_for(uint16_t id, const std::string& language) const
+{
+    size_t block = id / STRING_TABLE_BLOCK_SIZE;
+    for (auto &l : m_languages)
+    {
+        if (language.empty() ? block < l->blocks.size() && l->blocks[block].data != nullptr : l->name == language)
+            return l.get();
+    }
+    return nullptr;
+}
+
+std::u16string_view StringTable::find(uint16_t id, const std::string& language) const
+{
+    const Language *l = language_for(id, language);
+    if (l == nullptr)
+        return std::u16string_view();
+    size_t b = id / STRING_TABLE_BLOCK_SIZE;
+    if (b >= l->blocks.size())
+        return std::u16string_view();
+    const Block &block = l->blocks[b];
+    const uint8_t *text;
+    size_t length;
+    if (block.data == nullptr ||
+        !find_block_string(block.data, block.size, id % STRING_TABLE_BLOCK_SIZE, &text, &length))
+        return std::u16string_view();
+    return utf16_view(text, length);
+}
+
+std::string_view StringTable::findUtf8(uint16_t id, const std::string& language) const
+{
+    Language *l = language_for(id, language);
+    if (l == nullptr)
+        return std::string_view();
+    const Utf8Index *index = utf8_index(*l);
+
+    if (id < index->firstId || id - index->firstId + 1 >= index->offsets.size())
+        return std::string_view();
+    size_t i = id - index->firstId;
+    return std::string_view(index->arena.data() + index->offsets[i], index->offsets[i + 1] - index->offsets[i]);
+}
+
+/*
+ * Returns the UTF-8 index of a language, converting every string into one
+ * arena on first use. The index covers the ids from the first to the last
+ * block present; missing strings are empty. If the arena would grow past
+ * m_arenaLimit, the index is left empty.
+ */
+const StringTable::Utf8Index* StringTable::utf8_index(Language& language) const
+{
+    Utf8Index *index = language.utf8.load(std::memory_order_acquire);
+    if (index != nullptr)
+        return index;
+
+    std::unique_ptr<Utf8Index> built(new Utf8Index);
+    size_t first = language.blocks.size(), last = 0;
+    size_t bytes = 0;
+    for (size_t b = 0; b < language.blocks.size(); b++)
+    {
+        if (language.blocks[b].data == nullptr)
+            continue;
+        first = std::min(first, b);
+        last = b;
+        bytes += language.blocks[b].size;
+    }
+    if (first <= last)
+    {
+        built->firstId = (uint32_t)(first * STRING_TABLE_BLOCK_SIZE);
+        built->offsets.reserve((last - first + 1) * STRING_TABLE_BLOCK_SIZE + 1);
+        // most resource strings are ASCII, which halves their size
+        built->arena.reserve(std::min(bytes / 2, m_arenaLimit));
+        for (size_t b = first; b <= last; b++)
+        {
+            const Block &block = language.blocks[b];
+            for (unsigned i = 0; i < STRING_TABLE_BLOCK_SIZE; i++)
+            {
+                const uint8_t *text;
+                size_t length;
+                built->offsets.push_back((uint32_t)built->arena.size());
+                if (block.data == nullptr || !find_block_string(block.data, block.size, i, &text, &length))
+                    continue;
+                // a UTF-16 code unit takes at most 3 bytes of UTF-8
+                if (length * 3 > m_arenaLimit - built->arena.size())
+                {
+                    built.reset(new Utf8Index);
+                    break;
+                }
+                append_utf16le_as_utf8(built->arena, text, length);
+            }
+            if (built->offsets.empty())
+                break;
+        }
+        if (!built->offsets.empty())
+            built->offsets.push_back((uint32_t)built->arena.size());
+    }
+
+    // the first thread to finish publishes its index, the others use it
+    if (language.utf8.compare_exchange_strong(index, built.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+        return built.release();
+    return index;
+}
+
+}
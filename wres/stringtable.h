@@ -0,0 +1,102 @@
+#ifndef STRINGTABLE_H
+#define STRINGTABLE_H
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wres
+{
+
+class WinLibrary;
+
+/*
+ * Number of strings in one RT_STRING block. String id n is string
+ * n % 16 of block n / 16 + 1.
+ */
+#define STRING_TABLE_BLOCK_SIZE 16
+
+class StringTable
+{
+public:
+    /*
+     * StringTable indexes the RT_STRING resources of a library for
+     * LoadString-style lookups. Each block holds 16 strings, every one
+     * prefixed by its length in UTF-16 code units. The constructor only
+     * records where the blocks of each language are; strings are read
+     * when they are looked up. The library must outlive the table.
+     */
+    StringTable(const WinLibrary& library);
+    ~StringTable();
+
+    /*
+     * Returns the languages that have at least one string block, in the
+     * order they appear in the library.
+     */
+    std::vector<std::string> languages() const;
+
+    /*
+     * Returns the string with the given id as a view of the UTF-16 text in
+     * the library's memory, or an empty view if there is no such string.
+     * The text is little endian and not null terminated. If language is
+     * empty, the first language that has the string's block is used.
+     * Text at an odd address (a malformed block) can not be viewed as
+     * char16_t and comes back empty; findUtf8() reads it bytewise.
+     */
+    std::u16string_view find(uint16_t id, const std::string& language = "") const;
+
+    /*
+     * Same as find(), converted to UTF-8. The first lookup in a language
+     * converts all of its strings into one arena and builds a dense index
+     * over their ids; from then on a lookup is an array access and never
+     * allocates. The view stays valid as long as the table.
+     *
+     * Blocks may share their data, so the arena is bounded by the
+     * library's maxAllocation (and 4 GiB); a language whose strings do not
+     * fit gets no index and all of its lookups return empty views.
+     *
+     * Lookups may run concurrently: the index is built without a lock and
+     * published atomically. If several threads make the first lookup of
+     * a language at once, each builds an index and all but one discard
+     * theirs.
+     */
+    std::string_view findUtf8(uint16_t id, const std::string& language = "") const;
+
+private:
+    struct Block
+    {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+    struct Utf8Index
+    {
+        std::string arena;
+        /* string id - firstId -> offset in arena; one entry more than ids */
+        uint32_t firstId = 0;
+        std::vector<uint32_t> offsets;
+    };
+    struct Language
+    {
+        std::string name;
+        /* indexed by block id - 1, up to the highest block present */
+        std::vector<Block> blocks;
+        /* built on the first findUtf8() */
+        std::atomic<Utf8Index*> utf8 { nullptr };
+
+        ~Language() { delete utf8.load(std::memory_order_relaxed); }
+    };
+
+    std::vector<std::unique_ptr<Language>> m_languages;
+    /* largest UTF-8 arena of a language, bounded by the 32-bit offsets */
+    size_t m_arenaLimit = 0;
+
+    Language* language_for(uint16_t id, const std::string& language) const;
+    const Utf8Index* utf8_index(Language& language) const;
+};
+
+}
+
+#endif // STRINGTABLE_H
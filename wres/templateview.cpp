@@ -0,0 +1,325 @@
+#include "templateview.h"
+#include "wresutil.h"
+
+namespace wres
+{
+
+/*
+ * Reads template fields, checking each against the end of the data. A
+ * read past the end fails the reader and returns zero or an empty field;
+ * callers check failed() once after reading a header or an item.
+ */
+class TemplateReader
+{
+public:
+    TemplateReader(const uint8_t *base, const uint8_t *p, const uint8_t *end)
+        : m_base(base), m_p(p), m_end(end) {}
+
+    bool failed() const { return m_failed; }
+    const uint8_t* position() const { return m_p; }
+
+    uint8_t u8()
+    {
+        if (!fits(1))
+            return 0;
+        return *m_p++;
+    }
+    uint16_t u16()
+    {
+        if (!fits(2))
+            return 0;
+        uint16_t v = read_le16(m_p);
+        m_p += 2;
+        return v;
+    }
+    uint32_t u32()
+    {
+        if (!fits(4))
+            return 0;
+        uint32_t v = read_le32(m_p);
+        m_p += 4;
+        return v;
+    }
+    const uint8_t* bytes(size_t size)
+    {
+        if (!fits(size))
+            return nullptr;
+        const uint8_t *p = m_p;
+        m_p += size;
+        return p;
+    }
+    /* A null terminated UTF-16LE string, without the terminator */
+    std::u16string_view string()
+    {
+        const uint8_t *start = m_p;
+        while (fits(2) && read_le16(m_p) != 0)
+            m_p += 2;
+        if (!fits(2))
+            return std::u16string_view();
+        std::u16string_view text = utf16_view(start, (m_p - start) / 2);
+        m_p += 2;
+        return text;
+    }
+    /* 0x0000 for none, 0xFFFF followed by an ordinal, or a string */
+    NameOrOrdinal nameOrOrdinal()
+    {
+        NameOrOrdinal field;
+        if (!fits(2))
+            return field;
+        uint16_t first = read_le16(m_p);
+        if (first == 0)
+        {
+            m_p += 2;
+        }
+        else if (first == 0xFFFF)
+        {
+            m_p += 2;
+            field.ordinal = u16();
+            field.hasOrdinal = !m_failed;
+        }
+        else
+        {
+            field.name = string();
+        }
+        return field;
+    }
+    /* Aligns to 32 bits relative to the start of the template */
+    void align4()
+    {
+        size_t pad = (4 - (size_t)(m_p - m_base) % 4) % 4;
+        // padding at the very end of the data may be missing
+        m_p += pad <= (size_t)(m_end - m_p) ? pad : m_end - m_p;
+    }
+
+private:
+    const uint8_t *m_base;
+    const uint8_t *m_p;
+    const uint8_t *m_end;
+    bool m_failed = false;
+
+    bool fits(size_t size)
+    {
+        if (m_failed || size > (size_t)(m_end - m_p))
+        {
+            m_failed = true;
+            return false;
+        }
+        return true;
+    }
+};
+
+DialogView::DialogView(const uint8_t *data, size_t size)
+    : m_data(data), m_end(data + size)
+{
+    if (data == nullptr)
+        return;
+    TemplateReader r(m_data, m_data, m_end);
+    DialogHeader &h = m_header;
+    if (size >= 4 && read_le16(data) == 1 && read_le16(data + 2) == 0xFFFF)
+    {
+        h.extended = true;
+        r.u32();
+        h.helpId = r.u32();
+        h.exStyle = r.u32();
+        h.style = r.u32();
+    }
+    else
+    {
+        h.style = r.u32();
+        h.exStyle = r.u32();
+    }
+    h.itemCount = r.u16();
+    h.x = (int16_t)r.u16();
+    h.y = (int16_t)r.u16();
+    h.cx = (int16_t)r.u16();
+    h.cy = (int16_t)r.u16();
+    h.menu = r.nameOrOrdinal();
+    h.windowClass = r.nameOrOrdinal();
+    h.title = r.string();
+    if (h.style & DS_SETFONT)
+    {
+        h.pointSize = r.u16();
+        if (h.extended)
+        {
+            h.weight = r.u16();
+            h.italic = r.u8() != 0;
+            h.charset = r.u8();
+        }
+        h.typeface = r.string();
+    }
+    if (r.failed())
+        return;
+    r.align4();
+    m_items = r.position();
+}
+
+DialogView::Iterator DialogView::begin() const
+{
+    if (m_items == nullptr || m_header.itemCount == 0)
+        return end();
+    return Iterator(this, m_items);
+}
+
+DialogView::Iterator::Iterator(const DialogView *view, const uint8_t *pos)
+    : m_view(view), m_pos(pos)
+{
+    decode();
+}
+
+DialogView::Iterator& DialogView::Iterator::operator++()
+{
+    if (m_pos == nullptr)
+        return *this;
+    if (++m_index >= m_view->m_header.itemCount)
+        m_pos = nullptr;
+    else
+    {
+        m_pos = m_next;
+        decode();
+    }
+    return *this;
+}
+
+/* Decodes the item at m_pos, or ends the iteration if it does not fit */
+void DialogView::Iterator::decode()
+{
+    TemplateReader r(m_view->m_data, m_pos, m_view->m_end);
+    DialogItem &item = m_item;
+    item = DialogItem();
+    if (m_view->m_header.extended)
+    {
+        item.helpId = r.u32();
+        item.exStyle = r.u32();
+        item.style = r.u32();
+    }
+    else
+    {
+        item.style = r.u32();
+        item.exStyle = r.u32();
+    }
+    item.x = (int16_t)r.u16();
+    item.y = (int16_t)r.u16();
+    item.cx = (int16_t)r.u16();
+    item.cy = (int16_t)r.u16();
+    item.id = m_view->m_header.extended ? r.u32() : r.u16();
+    item.windowClass = r.nameOrOrdinal();
+    item.title = r.nameOrOrdinal();
+    size_t extra = r.u16();
+    item.creationDataSize = extra;
+    item.creationData = extra > 0 ? r.bytes(extra) : nullptr;
+    if (r.failed())
+    {
+        m_pos = nullptr;
+        return;
+    }
+    r.align4();
+    m_next = r.position();
+}
+
+MenuView::MenuView(const uint8_t *data, size_t size)
+    : m_data(data), m_end(data + size)
+{
+    if (data == nullptr)
+        return;
+    TemplateReader r(m_data, m_data, m_end);
+    uint16_t version = r.u16();
+    uint16_t offset = r.u16();
+    if (r.failed() || version > 1)
+        return;
+    m_extended = version == 1;
+    // the offset counts from the end of the header in the standard format,
+    // from the end of the offset field itself in MENUEX
+    if (r.bytes(offset) == nullptr || r.position() == m_end)
+        return;
+    m_items = r.position();
+}
+
+MenuView::Iterator MenuView::begin() const
+{
+    if (m_items == nullptr)
+        return end();
+    return Iterator(this, m_items);
+}
+
+MenuView::Iterator::Iterator(const MenuView *view, const uint8_t *pos)
+    : m_view(view), m_pos(pos)
+{
+    decode();
+}
+
+MenuView::Iterator& MenuView::Iterator::operator++()
+{
+    if (m_pos == nullptr)
+        return *this;
+    if (m_item.isPopup)
+    {
+        // the next items belong to the popup
+        if (m_depth + 1 >= MENU_VIEW_MAX_DEPTH)
+        {
+            m_pos = nullptr;
+            return *this;
+        }
+        if (m_item.isLast)
+            m_lastPopups |= (uint64_t)1 << (m_depth + 1);
+        else
+            m_lastPopups &= ~((uint64_t)1 << (m_depth + 1));
+        m_depth++;
+    }
+    else if (m_item.isLast)
+    {
+        // close the popups this item ends
+        for (;;)
+        {
+            if (m_depth == 0)
+            {
+                m_pos = nullptr;
+                return *this;
+            }
+            bool popupWasLast = (m_lastPopups >> m_depth) & 1;
+            m_depth--;
+            if (!popupWasLast)
+                break;
+        }
+    }
+    m_pos = m_next;
+    decode();
+    return *this;
+}
+
+void MenuView::Iterator::decode()
+{
+    TemplateReader r(m_view->m_data, m_pos, m_view->m_end);
+    MenuItem &item = m_item;
+    item = MenuItem();
+    item.depth = m_depth;
+    if (m_view->m_extended)
+    {
+        item.type = r.u32();
+        item.state = r.u32();
+        item.id = r.u32();
+        item.flags = r.u16();
+        item.text = r.string();
+        r.align4();
+        item.isPopup = (item.flags & MFR_POPUP) != 0;
+        item.isLast = (item.flags & MFR_END) != 0;
+        if (item.isPopup)
+            item.helpId = r.u32();
+    }
+    else
+    {
+        item.flags = r.u16();
+        item.isPopup = (item.flags & MF_POPUP) != 0;
+        item.isLast = (item.flags & MF_END) != 0;
+        if (!item.isPopup)
+            item.id = r.u16();
+        item.text = r.string();
+    }
+    if (r.failed())
+    {
+        m_pos = nullptr;
+        return;
+    }
+    m_next = r.position();
+}
+
+}
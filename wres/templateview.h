@@ -0,0 +1,217 @@
+#ifndef TEMPLATEVIEW_H
+#define TEMPLATEVIEW_H
+#include <stddef.h>
+#include <stdint.h>
+#include <iterator>
+#include <string_view>
+
+namespace wres
+{
+
+/* Dialog styles that add font fields to a dialog template */
+#define DS_SETFONT      0x40
+#define DS_SHELLFONT    0x48
+
+/* Menu item flags of MENUITEMTEMPLATE and MENUEX_TEMPLATE_ITEM */
+#define MF_POPUP        0x0010
+#define MF_END          0x0080
+#define MFR_POPUP       0x0001
+#define MFR_END         0x0080
+#define MFT_SEPARATOR   0x0800
+
+/* Deepest menu nesting a MenuView follows */
+#define MENU_VIEW_MAX_DEPTH 64
+
+/*
+ * A field that holds either a 16-bit ordinal or a string: menu and class
+ * names of dialogs and the class and title of dialog items. An empty field
+ * has neither.
+ */
+struct NameOrOrdinal
+{
+    bool hasOrdinal = false;
+    uint16_t ordinal = 0;
+    std::u16string_view name;
+
+    bool isEmpty() const { return !hasOrdinal && name.empty(); }
+};
+
+/*
+ * Template views decode RT_DIALOG and RT_MENU resources in place. Strings
+ * are views of the UTF-16LE text in the resource data, which has to
+ * outlive the view (text at an odd address, which only malformed
+ * templates have, is an empty view), and items are decoded one at a time while iterating,
+ * so walking a template allocates nothing.
+ *
+ * Bounds policy: every field is checked against the end of the data. The
+ * header of a malformed template makes the view invalid; an item that does
+ * not fit ends the iteration, so a truncated template yields fewer items
+ * than its header claims, never garbage or out of bounds reads.
+ */
+
+struct DialogHeader
+{
+    bool extended = false;
+    uint32_t helpId = 0;
+    uint32_t style = 0;
+    uint32_t exStyle = 0;
+    uint16_t itemCount = 0;
+    int16_t x = 0, y = 0, cx = 0, cy = 0;
+    NameOrOrdinal menu;
+    NameOrOrdinal windowClass;
+    std::u16string_view title;
+    /* only set with DS_SETFONT; weight, italic and charset only in DLGTEMPLATEEX */
+    uint16_t pointSize = 0;
+    uint16_t weight = 0;
+    bool italic = false;
+    uint8_t charset = 0;
+    std::u16string_view typeface;
+};
+
+struct DialogItem
+{
+    uint32_t helpId = 0;
+    uint32_t style = 0;
+    uint32_t exStyle = 0;
+    int16_t x = 0, y = 0, cx = 0, cy = 0;
+    /* 16 bits in DLGTEMPLATE, 32 bits in DLGTEMPLATEEX */
+    uint32_t id = 0;
+    /* predefined classes are ordinals, e.g. 0x80 for buttons */
+    NameOrOrdinal windowClass;
+    NameOrOrdinal title;
+    const uint8_t *creationData = nullptr;
+    size_t creationDataSize = 0;
+};
+
+class DialogView
+{
+public:
+    class Iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef DialogItem value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const DialogItem* pointer;
+        typedef const DialogItem& reference;
+
+        Iterator() = default;
+        const DialogItem& operator*() const { return m_item; }
+        const DialogItem* operator->() const { return &m_item; }
+        Iterator& operator++();
+        bool operator==(const Iterator& other) const { return m_pos == other.m_pos; }
+        bool operator!=(const Iterator& other) const { return m_pos != other.m_pos; }
+
+    private:
+        friend class DialogView;
+        Iterator(const DialogView *view, const uint8_t *pos);
+
+        const DialogView *m_view = nullptr;
+        /* start of the current item, nullptr at the end */
+        const uint8_t *m_pos = nullptr;
+        const uint8_t *m_next = nullptr;
+        uint16_t m_index = 0;
+        DialogItem m_item;
+
+        void decode();
+    };
+
+    /*
+     * DialogView reads a DLGTEMPLATE or DLGTEMPLATEEX (which starts with
+     * version 1 and signature 0xFFFF) and iterates over its items.
+     */
+    DialogView(const uint8_t *data, size_t size);
+
+    bool isValid() const { return m_items != nullptr; }
+    const DialogHeader& header() const { return m_header; }
+
+    Iterator begin() const;
+    Iterator end() const { return Iterator(); }
+
+private:
+    const uint8_t *m_data;
+    const uint8_t *m_end;
+    /* first item, nullptr if the header is malformed */
+    const uint8_t *m_items = nullptr;
+    DialogHeader m_header;
+};
+
+struct MenuItem
+{
+    /* MENUEX only: MFT_* type, MFS_* state and help id of popups */
+    uint32_t type = 0;
+    uint32_t state = 0;
+    uint32_t helpId = 0;
+    /* 0 for popups in the standard format */
+    uint32_t id = 0;
+    /* raw MF_* (standard) or MFR_* (MENUEX) flags */
+    uint16_t flags = 0;
+    std::u16string_view text;
+    /* nesting level, 0 for the menu bar */
+    unsigned depth = 0;
+    bool isPopup = false;
+    /* last item of its popup (or of the menu bar) */
+    bool isLast = false;
+
+    bool isSeparator() const { return (type & MFT_SEPARATOR) != 0 || (!isPopup && id == 0 && text.empty()); }
+};
+
+class MenuView
+{
+public:
+    class Iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef MenuItem value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const MenuItem* pointer;
+        typedef const MenuItem& reference;
+
+        Iterator() = default;
+        const MenuItem& operator*() const { return m_item; }
+        const MenuItem* operator->() const { return &m_item; }
+        Iterator& operator++();
+        bool operator==(const Iterator& other) const { return m_pos == other.m_pos; }
+        bool operator!=(const Iterator& other) const { return m_pos != other.m_pos; }
+
+    private:
+        friend class MenuView;
+        Iterator(const MenuView *view, const uint8_t *pos);
+
+        const MenuView *m_view = nullptr;
+        const uint8_t *m_pos = nullptr;
+        const uint8_t *m_next = nullptr;
+        unsigned m_depth = 0;
+        /* bit n is set if the popup at depth n - 1 holding the current items is last */
+        uint64_t m_lastPopups = 0;
+        MenuItem m_item;
+
+        void decode();
+    };
+
+    /*
+     * MenuView reads a standard menu template (MENUITEMTEMPLATEHEADER
+     * version 0) or a MENUEX template (version 1) and iterates over all of
+     * its items depth first, popups before their items. Nesting is tracked
+     * in a bit mask, so menus deeper than MENU_VIEW_MAX_DEPTH end the
+     * iteration.
+     */
+    MenuView(const uint8_t *data, size_t size);
+
+    bool isValid() const { return m_items != nullptr; }
+    bool isExtended() const { return m_extended; }
+
+    Iterator begin() const;
+    Iterator end() const { return Iterator(); }
+
+private:
+    const uint8_t *m_data;
+    const uint8_t *m_end;
+    const uint8_t *m_items = nullptr;
+    bool m_extended = false;
+};
+
+}
+
+#endif // TEMPLATEVIEW_H
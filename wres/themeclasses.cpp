@@ -0,0 +1,127 @@
+#include "themeclasses.h"
+#include "wresutil.h"
+
+namespace wres
+{
+
+static inline char ascii_lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+/* FNV-1a over the lower case name */
+static uint32_t class_name_hash(std::string_view name)
+{
+    uint32_t h = 2166136261u;
+    for (char c : name)
+        h = (h ^ (uint8_t)ascii_lower(c)) * 16777619u;
+    return h;
+}
+
+static bool equals_ignore_case(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (ascii_lower(a[i]) != ascii_lower(b[i]))
+            return false;
+    }
+    return true;
+}
+
+bool ClassMap::parse(const uint8_t *cmap, size_t cmapSize, const uint8_t *bcmap, size_t bcmapSize)
+{
+    m_pool.clear();
+    m_offsets.clear();
+    m_slots.clear();
+    m_baseClasses.clear();
+    if (cmap == nullptr)
+        return false;
+
+    // most names are ASCII, which halves their size
+    m_pool.reserve(cmapSize / 2);
+    m_offsets.push_back(0);
+    bool ok = true;
+    size_t offset = 0;
+    while (offset < cmapSize)
+    {
+        size_t end = offset;
+        while (end + 2 <= cmapSize && read_le16(cmap + end) != 0)
+            end += 2;
+        if (end + 2 > cmapSize)
+        {
+            ok = false;
+            break;
+        }
+        append_utf16le_as_utf8(m_pool, cmap + offset, (end - offset) / 2);
+        m_offsets.push_back((uint32_t)m_pool.size());
+        offset = (end + 2 + 7) & ~(size_t)7;
+    }
+    build_index();
+
+    if (bcmap != nullptr)
+    {
+        uint32_t count = bcmapSize >= 4 ? read_le32(bcmap) : 0;
+        if (bcmapSize < 4 || count > (bcmapSize - 4) / 4)
+            return false;
+        m_baseClasses.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+            m_baseClasses[i] = (int32_t)read_le32(bcmap + 4 + i * 4);
+    }
+    return ok;
+}
+
+void ClassMap::build_index()
+{
+    size_t slots = 16;
+    while (slots < size() * 2)
+        slots *= 2;
+    m_slots.assign(slots, 0);
+    size_t mask = slots - 1;
+    for (uint32_t i = 0; i < size(); i++)
+    {
+        std::string_view n = name(i);
+        for (size_t slot = class_name_hash(n) & mask; ; slot = (slot + 1) & mask)
+        {
+            if (m_slots[slot] == 0)
+            {
+                m_slots[slot] = i + 1;
+                break;
+            }
+            // the first of two equal names wins
+            if (equals_ignore_case(name(m_slots[slot] - 1), n))
+                break;
+        }
+    }
+}
+
+std::string_view ClassMap::name(uint32_t index) const
+{
+    if (index >= size())
+        return std::string_view();
+    return std::string_view(m_pool.data() + m_offsets[index], m_offsets[index + 1] - m_offsets[index]);
+}
+
+int32_t ClassMap::find(std::string_view name) const
+{
+    if (m_slots.empty())
+        return -1;
+    size_t mask = m_slots.size() - 1;
+    for (size_t slot = class_name_hash(name) & mask; m_slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        uint32_t index = m_slots[slot] - 1;
+        if (equals_ignore_case(this->name(index), name))
+            return (int32_t)index;
+    }
+    return -1;
+}
+
+int32_t ClassMap::baseClass(uint32_t index) const
+{
+    if (index >= m_baseClasses.size() || m_baseClasses[index] < 0 || (size_t)m_baseClasses[index] >= size())
+        return -1;
+    return m_baseClasses[index];
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef THEMECLASSES_H
+#define THEMECLASSES_H
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wres
+{
+
+class ClassMap
+{
+public:
+    /*
+     * ClassMap decodes the class list of an msstyles theme. CMAP holds the
+     * class names ("globals", "ButtonStyle", "Explorer::Button", ...) as
+     * null terminated UTF-16LE strings, each padded to 8 bytes; a class id
+     * in the property maps is an index into this list. BCMAP holds a count
+     * followed by the base class index of each class, or -1.
+     *
+     * The names are converted once into one UTF-8 pool and hashed, so
+     * that names can be turned into indices with a single lookup and all
+     * further comparisons are integer comparisons. Lookups by name ignore
+     * ASCII case, as the theme engine does. The map does not reference the
+     * resource data after parsing.
+     */
+    ClassMap() = default;
+
+    /*
+     * Parses the CMAP data and, if given, the BCMAP data. Returns false if
+     * either is malformed; the names read up to that point are kept.
+     */
+    bool parse(const uint8_t *cmap, size_t cmapSize, const uint8_t *bcmap = nullptr, size_t bcmapSize = 0);
+
+    size_t size() const { return m_offsets.empty() ? 0 : m_offsets.size() - 1; }
+
+    /* Returns the UTF-8 name of a class, or an empty view */
+    std::string_view name(uint32_t index) const;
+    /* Returns the index of the class with the given name, or -1 */
+    int32_t find(std::string_view name) const;
+    /* Returns the base class of a class from BCMAP, or -1 if there is none */
+    int32_t baseClass(uint32_t index) const;
+
+private:
+    std::string m_pool;
+    /* index -> offset of the name in m_pool; one entry more than classes */
+    std::vector<uint32_t> m_offsets;
+    /* class index + 1 per slot, 0 for empty; the size is a power of two */
+    std::vector<uint32_t> m_slots;
+    std::vector<int32_t> m_baseClasses;
+
+    void build_index();
+};
+
+}
+
+#endif // THEMECLASSES_H
@@ -0,0 +1,152 @@
+#include "themelibrary.h"
+#include "threadpool.h"
+#include "winlibrary.h"
+#include <chrono>
+#include <functional>
+
+namespace wres
+{
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* Returns the first resource of the given type, or nullptr */
+static WinResource* first_of_type(const std::vector<WinResource*>& resources, const char *type)
+{
+    for (auto r : resources)
+    {
+        if (r->type() == type)
+            return r;
+    }
+    return nullptr;
+}
+
+ThemeLibrary::ThemeLibrary(const std::string& path, const std::string& muiPath, bool indexImages, ThreadPool *pool)
+{
+    auto start = std::chrono::steady_clock::now();
+    if (pool == nullptr)
+        pool = &ThreadPool::global();
+
+    m_library.reset(new WinLibrary(path));
+    if (!muiPath.empty())
+    {
+        m_mui.reset(new WinLibrary(muiPath));
+        if (!m_mui->isValid())
+            m_mui.reset();
+    }
+    m_timings.open = elapsed_ms(start);
+
+    if (m_library->isValid())
+    {
+        m_strings.reset(new StringTable(m_mui ? *m_mui : *m_library));
+        m_isValid = load_maps(pool);
+        if (indexImages)
+        {
+            auto imagesStart = std::chrono::steady_clock::now();
+            WinResource *images = m_library->findResource(std::string("IMAGE"), std::string(""), std::string(""));
+            if (images != nullptr)
+                m_images.build(*m_library, images, pool);
+            m_timings.images = elapsed_ms(imagesStart);
+        }
+    }
+    else
+    {
+        m_strings.reset(new StringTable(*m_library));
+    }
+    m_timings.total = elapsed_ms(start);
+}
+
+ThemeLibrary::~ThemeLibrary()
+{
+}
+
+bool ThemeLibrary::load_maps(ThreadPool *pool)
+{
+    static const char *const structuralTypes[] =
+    {
+        "PACKTHEM_VERSION", "CMAP", "BCMAP", "VMAP", "VARIANT", "RMAP", "AMAP"
+    };
+
+    // one walk over the type directories instead of a lookup per type
+    auto start = std::chrono::steady_clock::now();
+    std::vector<WinResource*> resources;
+    for (auto &type : m_library->root().children())
+    {
+        for (const char *name : structuralTypes)
+        {
+            if (type.id() == name)
+            {
+                for (auto r : m_library->collectResources(&type))
+                    resources.push_back(r);
+                break;
+            }
+        }
+    }
+    WinResource *version = first_of_type(resources, "PACKTHEM_VERSION");
+    if (version != nullptr && version->size() >= 2)
+        m_packthemVersion = read_le16((const uint8_t*)version->offset());
+
+    std::vector<WinResource*> variants;
+    for (auto r : resources)
+    {
+        if (r->type() == "VARIANT")
+            variants.push_back(r);
+    }
+    m_variants.resize(variants.size());
+
+    WinResource *cmap = first_of_type(resources, "CMAP");
+    WinResource *bcmap = first_of_type(resources, "BCMAP");
+    WinResource *vmap = first_of_type(resources, "VMAP");
+    WinResource *rmap = first_of_type(resources, "RMAP");
+    WinResource *amap = first_of_type(resources, "AMAP");
+    bool classesOk = false;
+
+    std::vector<std::function<void()>> tasks;
+    tasks.push_back([&]()
+    {
+        if (cmap != nullptr)
+            classesOk = m_classes.parse((const uint8_t*)cmap->offset(), cmap->size(),
+                                        bcmap ? (const uint8_t*)bcmap->offset() : nullptr, bcmap ? bcmap->size() : 0);
+    });
+    for (size_t i = 0; i < variants.size(); i++)
+    {
+        tasks.push_back([&, i]()
+        {
+            m_variants[i].name = variants[i]->name();
+            m_variants[i].properties.parse((const uint8_t*)variants[i]->offset(), variants[i]->size());
+        });
+    }
+    if (rmap != nullptr)
+        tasks.push_back([&]() { m_rmap.parse((const uint8_t*)rmap->offset(), rmap->size()); });
+    if (amap != nullptr)
+        tasks.push_back([&]() { m_amap.parse((const uint8_t*)amap->offset(), amap->size()); });
+    if (vmap != nullptr)
+        tasks.push_back([&]() { read_variant_map((const uint8_t*)vmap->offset(), vmap->size(), m_variantNames); });
+
+    pool->parallelFor(tasks.size(), [&](size_t i) { tasks[i](); });
+    m_timings.parse = elapsed_ms(start);
+
+    bool variantOk = false;
+    for (auto &v : m_variants)
+        variantOk |= v.properties.size() > 0;
+    return classesOk && variantOk;
+}
+
+bool ThemeLibrary::isValid() const
+{
+    return m_isValid;
+}
+
+const PropertyTable* ThemeLibrary::variant(const std::string& name) const
+{
+    for (auto &v : m_variants)
+    {
+        if (name.empty() || v.name == name)
+            return &v.properties;
+    }
+    return nullptr;
+}
+
+}
@@ -0,0 +1,108 @@
+#ifndef THEMELIBRARY_H
+#define THEMELIBRARY_H
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "imageinfo.h"
+#include "stringtable.h"
+#include "themeclasses.h"
+#include "themeproperties.h"
+
+namespace wres
+{
+
+class ThreadPool;
+class WinLibrary;
+
+/* Time spent in each phase of opening a theme, in milliseconds */
+struct ThemeOpenTimings
+{
+    /* loading the .msstyles (and .mui) and building the resource trees */
+    double open = 0;
+    /* parsing the class and property maps */
+    double parse = 0;
+    /* building the image index, if requested */
+    double images = 0;
+    double total = 0;
+};
+
+class ThemeLibrary
+{
+public:
+    /* One VARIANT resource, e.g. "NORMAL", with its properties */
+    struct Variant
+    {
+        std::string name;
+        PropertyTable properties;
+    };
+
+    /*
+     * ThemeLibrary opens an msstyles theme in one call. After loading the
+     * file, the structural resources (PACKTHEM_VERSION, CMAP, BCMAP, VMAP,
+     * VARIANT, RMAP and AMAP) are collected in one walk over the type
+     * directories and their maps are parsed concurrently on the given pool
+     * (or the global pool). The file is already in memory after loading,
+     * so there is no separate read phase. With indexImages set, the header
+     * metadata of the IMAGE resources is indexed as well.
+     *
+     * muiPath optionally names the theme's .mui file, which holds the
+     * localized RT_STRING resources that font and string properties
+     * refer to; strings() then reads them from there.
+     *
+     * The parsed maps reference the library's memory, so they are only
+     * valid as long as the ThemeLibrary is.
+     */
+    ThemeLibrary(const std::string& path, const std::string& muiPath = "", bool indexImages = false,
+                 ThreadPool *pool = nullptr);
+    ~ThemeLibrary();
+
+    /*
+     * Returns true if the theme was loaded and its class map and at least
+     * one variant could be parsed.
+     */
+    bool isValid() const;
+
+    WinLibrary& library() { return *m_library; }
+    /* Returns the .mui library, or nullptr if there is none */
+    WinLibrary* mui() { return m_mui.get(); }
+
+    /* PACKTHEM_VERSION, 0 if missing */
+    uint16_t packthemVersion() const { return m_packthemVersion; }
+    const ClassMap& classes() const { return m_classes; }
+    const std::vector<Variant>& variants() const { return m_variants; }
+    /* Returns the variant with the given name, or the first one if name is empty */
+    const PropertyTable* variant(const std::string& name = "") const;
+    const PropertyTable& rmap() const { return m_rmap; }
+    const PropertyTable& amap() const { return m_amap; }
+    /* Names from VMAP */
+    const std::vector<std::u16string_view>& variantNames() const { return m_variantNames; }
+    /* String resources of the .mui if given, of the theme otherwise */
+    const StringTable& strings() const { return *m_strings; }
+    /* Empty unless indexImages was set */
+    const ImageIndex& images() const { return m_images; }
+
+    const ThemeOpenTimings& timings() const { return m_timings; }
+
+private:
+    std::unique_ptr<WinLibrary> m_library;
+    std::unique_ptr<WinLibrary> m_mui;
+    std::unique_ptr<StringTable> m_strings;
+    bool m_isValid = false;
+    uint16_t m_packthemVersion = 0;
+    ClassMap m_classes;
+    std::vector<Variant> m_variants;
+    PropertyTable m_rmap;
+    PropertyTable m_amap;
+    std::vector<std::u16string_view> m_variantNames;
+    ImageIndex m_images;
+    ThemeOpenTimings m_timings;
+
+    bool load_maps(ThreadPool *pool);
+};
+
+}
+
+#endif // THEMELIBRARY_H
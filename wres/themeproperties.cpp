@@ -0,0 +1,147 @@
+#include "themeproperties.h"
+#include "wresutil.h"
+
+namespace wres
+{
+
+#define PROPERTY_HEADER_SIZE 32
+
+int32_t ThemeProperty::intValue() const
+{
+    return value != nullptr && size >= 4 ? (int32_t)read_le32(value) : 0;
+}
+
+std::u16string_view ThemeProperty::stringValue() const
+{
+    if (value == nullptr)
+        return std::u16string_view();
+    size_t length = 0;
+    while (length < size / 2 && read_le16(value + length * 2) != 0)
+        length++;
+    return utf16_view(value, length);
+}
+
+static inline uint64_t property_hash(uint32_t classId, uint32_t partId, uint32_t stateId, uint32_t nameId)
+{
+    uint64_t h = (((uint64_t)classId << 32) | partId) * 0x9E3779B97F4A7C15ull;
+    h ^= (((uint64_t)stateId << 32) | nameId) + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2);
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    return h ^ (h >> 29);
+}
+
+bool PropertyTable::parse(const uint8_t *data, size_t size)
+{
+    m_properties.clear();
+    m_slots.clear();
+    if (data == nullptr || size < PROPERTY_HEADER_SIZE)
+        return false;
+
+    // the smallest record is a bare header
+    m_properties.reserve(size / PROPERTY_HEADER_SIZE);
+    bool ok = true;
+    size_t offset = 0;
+    while (offset < size)
+    {
+        if (size - offset < PROPERTY_HEADER_SIZE)
+        {
+            ok = false;
+            break;
+        }
+        const uint8_t *p = data + offset;
+        ThemeProperty property;
+        property.nameId = read_le32(p);
+        property.type = read_le32(p + 4);
+        property.classId = read_le32(p + 8);
+        property.partId = read_le32(p + 12);
+        property.stateId = read_le32(p + 16);
+        property.reference = read_le32(p + 20);
+        property.size = read_le32(p + 28);
+        offset += PROPERTY_HEADER_SIZE;
+        if (property.reference == 0)
+        {
+            size_t padded = ((size_t)property.size + 7) & ~(size_t)7;
+            // the padding of the last record may be missing
+            if (property.size > size - offset)
+            {
+                ok = false;
+                break;
+            }
+            property.value = data + offset;
+            offset += padded < size - offset ? padded : size - offset;
+        }
+        m_properties.push_back(property);
+    }
+    build_index();
+    return ok;
+}
+
+void PropertyTable::build_index()
+{
+    size_t slots = 16;
+    while (slots < m_properties.size() * 2)
+        slots *= 2;
+    m_slots.assign(slots, 0);
+    size_t mask = slots - 1;
+    for (size_t i = 0; i < m_properties.size(); i++)
+    {
+        const ThemeProperty &p = m_properties[i];
+        size_t slot = property_hash(p.classId, p.partId, p.stateId, p.nameId) & mask;
+        for (;; slot = (slot + 1) & mask)
+        {
+            if (m_slots[slot] == 0)
+            {
+                m_slots[slot] = (uint32_t)(i + 1);
+                break;
+            }
+            const ThemeProperty &q = m_properties[m_slots[slot] - 1];
+            if (q.classId == p.classId && q.partId == p.partId && q.stateId == p.stateId && q.nameId == p.nameId)
+                break;
+        }
+    }
+}
+
+const ThemeProperty* PropertyTable::find(uint32_t classId, uint32_t partId, uint32_t stateId, uint32_t nameId) const
+{
+    if (m_slots.empty())
+        return nullptr;
+    size_t mask = m_slots.size() - 1;
+    for (size_t slot = property_hash(classId, partId, stateId, nameId) & mask; m_slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        const ThemeProperty &p = m_properties[m_slots[slot] - 1];
+        if (p.classId == classId && p.partId == partId && p.stateId == stateId && p.nameId == nameId)
+            return &p;
+    }
+    return nullptr;
+}
+
+const ThemeProperty* PropertyTable::resolve(uint32_t classId, uint32_t partId, uint32_t stateId, uint32_t nameId) const
+{
+    const ThemeProperty *p = find(classId, partId, stateId, nameId);
+    if (p == nullptr && stateId != 0)
+        p = find(classId, partId, 0, nameId);
+    if (p == nullptr && partId != 0)
+        p = find(classId, 0, 0, nameId);
+    return p;
+}
+
+bool read_variant_map(const uint8_t *data, size_t size, std::vector<std::u16string_view>& names)
+{
+    names.clear();
+    if (data == nullptr)
+        return false;
+    size_t offset = 0;
+    while (offset + 4 <= size)
+    {
+        size_t length = read_le32(data + offset);
+        offset += 4;
+        if (length == 0 || length > (size - offset) / 2)
+            return false;
+        // the length includes the terminator
+        names.push_back(utf16_view(data + offset, length - 1));
+        offset += (length * 2 + 3) & ~(size_t)3;
+    }
+    return offset >= size;
+}
+
+}
@@ -0,0 +1,113 @@
+#ifndef THEMEPROPERTIES_H
+#define THEMEPROPERTIES_H
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+namespace wres
+{
+
+/* Property types of msstyles property records (TMT_* type ids) */
+#define TMT_ENUM        200
+#define TMT_STRING      201
+#define TMT_INT         202
+#define TMT_BOOL        203
+#define TMT_COLOR       204
+#define TMT_MARGINS     205
+#define TMT_FILENAME    206
+#define TMT_SIZE        207
+#define TMT_POSITION    208
+#define TMT_RECT        209
+#define TMT_FONT        210
+#define TMT_INTLIST     211
+#define TMT_HBITMAP     212
+#define TMT_DISKSTREAM  213
+#define TMT_STREAM      214
+#define TMT_BITMAPREF   215
+#define TMT_FLOAT       216
+#define TMT_FLOATLIST   217
+
+/*
+ * One property record of a VARIANT, RMAP or AMAP resource. The value is a
+ * view of the resource data. Some values are not stored in the record but
+ * in another resource, which reference names: fonts and some strings are
+ * RT_STRING ids, file names IMAGE resources and disk streams STREAM
+ * resources. Those records have a size but no value.
+ */
+struct ThemeProperty
+{
+    uint32_t nameId = 0;
+    uint32_t type = 0;
+    /* index into the CMAP class list */
+    uint32_t classId = 0;
+    uint32_t partId = 0;
+    uint32_t stateId = 0;
+    uint32_t reference = 0;
+    uint32_t size = 0;
+    const uint8_t *value = nullptr;
+
+    /* The first 32 bits of the value: enums, ints, bools, colors, sizes */
+    int32_t intValue() const;
+    /* The value as UTF-16LE text, without the terminator; empty if not 2-byte aligned */
+    std::u16string_view stringValue() const;
+};
+
+class PropertyTable
+{
+public:
+    /*
+     * PropertyTable decodes the property records of an msstyles VARIANT,
+     * RMAP or AMAP resource in place and indexes them by class, part,
+     * state and property id.
+     *
+     * Each record is a 32 byte header (property id, type, class, part,
+     * state, reference, reserved and value size), followed by the value
+     * padded to 8 bytes unless the reference is set. The index is an
+     * open addressing hash table kept at most half full, so lookups take
+     * constant time and do not allocate. The table is immutable once
+     * parsed; the resource data has to outlive it.
+     */
+    PropertyTable() = default;
+
+    /*
+     * Parses the records. Returns false if the data is empty or a record
+     * runs past its end; the records before it are kept.
+     */
+    bool parse(const uint8_t *data, size_t size);
+
+    size_t size() const { return m_properties.size(); }
+    /* All records, in the order they are stored */
+    const std::vector<ThemeProperty>& properties() const { return m_properties; }
+
+    /*
+     * Returns the property with exactly this class, part, state and id,
+     * or nullptr. If a key appears more than once, the first record wins.
+     */
+    const ThemeProperty* find(uint32_t classId, uint32_t partId, uint32_t stateId, uint32_t nameId) const;
+    /*
+     * Like find(), but falls back to state 0 and then to part 0 the way
+     * the theme engine does. Base classes (BCMAP) are not followed.
+     */
+    const ThemeProperty* resolve(uint32_t classId, uint32_t partId, uint32_t stateId, uint32_t nameId) const;
+
+private:
+    std::vector<ThemeProperty> m_properties;
+    /* property index + 1 per slot, 0 for empty; the size is a power of two */
+    std::vector<uint32_t> m_slots;
+
+    void build_index();
+};
+
+/*
+ * Reads the variant names of a VMAP resource (e.g. "Normal", "NormalSize"
+ * and "NormalColor") as views of the resource data. Each name is stored as
+ * its length in characters, including the terminator, followed by the
+ * text, padded to 4 bytes. Returns false if the list is malformed.
+ * Names at an odd address are empty views, see utf16_view().
+ */
+bool read_variant_map(const uint8_t *data, size_t size, std::vector<std::u16string_view>& names);
+
+}
+
+#endif // THEMEPROPERTIES_H
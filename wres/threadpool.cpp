@@ -0,0 +1,116 @@
+#include "threadpool.h"
+#include <algorithm>
+#include <atomic>
+
+namespace wres
+{
+
+struct ThreadPool::Job
+{
+    const std::function<void(size_t)>* fn;
+    size_t count;
+    std::atomic<size_t> next { 0 };
+};
+
+/* Set on pool workers and on threads currently running a job */
+static thread_local bool in_pool_job = false;
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned i = 1; i < threads; i++)
+        m_workers.emplace_back(&ThreadPool::worker_loop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for(auto &t : m_workers)
+        t.join();
+}
+
+unsigned ThreadPool::threadCount() const
+{
+    return m_workers.size() + 1;
+}
+
+ThreadPool& ThreadPool::global()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::run_job(Job *job)
+{
+    size_t i;
+    while((i = job->next.fetch_add(1, std::memory_order_relaxed)) < job->count)
+        (*job->fn)(i);
+}
+
+void ThreadPool::worker_loop()
+{
+    unsigned long seen = 0;
+    in_pool_job = true;
+    for(;;)
+    {
+        Job *job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || (m_job != nullptr && m_generation != seen); });
+            if(m_stop)
+                return;
+            seen = m_generation;
+            job = m_job;
+            m_busy++;
+        }
+
+        run_job(job);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy--;
+        }
+        m_idle.notify_all();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn)
+{
+    if(count == 0)
+        return;
+
+    // Nested jobs and single items are not worth waking anybody up for
+    if(in_pool_job || m_workers.empty() || count == 1)
+    {
+        for(size_t i = 0; i < count; i++)
+            fn(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> serialize(m_jobMutex);
+    Job job;
+    job.fn = &fn;
+    job.count = count;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    in_pool_job = true;
+    run_job(&job);
+    in_pool_job = false;
+
+    // Every item has been claimed; wait for the workers still running one
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_job = nullptr;
+    m_idle.wait(lock, [&] { return m_busy == 0; });
+}
+
+}
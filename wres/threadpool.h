@@ -0,0 +1,64 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+#include <stddef.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wres
+{
+
+class ThreadPool
+{
+public:
+    /*
+     * ThreadPool is a fixed set of worker threads used by the batch APIs
+     * of libwres (image indexing, decoding, thumbnails, ...). Work is
+     * submitted with parallelFor(), which blocks until every item has been
+     * processed. The calling thread takes part in the work as well.
+     *
+     * A thread count of 0 uses one thread per hardware thread. A pool with
+     * a single thread runs everything on the caller.
+     */
+    ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+    /*
+     * Returns the number of threads that work on a job, including the
+     * calling thread.
+     */
+    unsigned threadCount() const;
+    /*
+     * Calls fn(i) for every i in [0, count) and returns once all calls
+     * have finished. Calls run concurrently and in no particular order.
+     * Only one job runs at a time; concurrent callers are serialized.
+     * Calling parallelFor() from inside a job runs the nested job on the
+     * current thread.
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+    /*
+     * Returns a process-wide pool that is created on first use.
+     */
+    static ThreadPool& global();
+
+private:
+    struct Job;
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_jobMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    Job* m_job = nullptr;
+    unsigned long m_generation = 0;
+    unsigned m_busy = 0;
+    bool m_stop = false;
+
+    void worker_loop();
+    static void run_job(Job *job);
+};
+
+}
+
+#endif // THREADPOOL_H
@@ -0,0 +1,307 @@
+#include "thumbnail.h"
+#include "dibdecoder.h"
+#include "imageinfo.h"
+#include "pngdecoder.h"
+#include "threadpool.h"
+#include "winlibrary.h"
+#include <atomic>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace wres
+{
+
+/* Scratch memory a thread keeps between thumbnails, enough for a 1024x1024 image */
+#define THUMBNAIL_SCRATCH_KEEP (4 << 20)
+
+/*
+ * Source pixels contributing to each destination pixel along one axis.
+ * Destination pixel d covers count[d] source pixels starting at first[d],
+ * with the weights at weights[offset[d]]; the weights of one destination
+ * pixel add up to 1.
+ */
+struct BoxAxis
+{
+    std::vector<uint32_t> first;
+    std::vector<uint32_t> count;
+    std::vector<uint32_t> offset;
+    std::vector<float> weights;
+};
+
+static void build_axis(uint32_t src, uint32_t dst, BoxAxis& axis)
+{
+    double scale = (double)src / dst;
+    axis.first.resize(dst);
+    axis.count.resize(dst);
+    axis.offset.resize(dst);
+    axis.weights.clear();
+    for (uint32_t d = 0; d < dst; d++)
+    {
+        double start = d * scale;
+        double end = std::min((double)src, (d + 1) * scale);
+        uint32_t i0 = (uint32_t)start;
+        uint32_t i1 = std::min(src, (uint32_t)ceil(end));
+        axis.first[d] = i0;
+        axis.count[d] = i1 - i0;
+        axis.offset[d] = (uint32_t)axis.weights.size();
+        for (uint32_t i = i0; i < i1; i++)
+        {
+            double covered = std::min(end, (double)i + 1) - std::max(start, (double)i);
+            axis.weights.push_back((float)(covered / scale));
+        }
+    }
+}
+
+#if defined(__SSE2__)
+static inline __m128 load_pixel_ps(const uint8_t *p)
+{
+    int v;
+    memcpy(&v, p, 4);
+    __m128i zero = _mm_setzero_si128();
+    __m128i x = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero), zero);
+    return _mm_cvtepi32_ps(x);
+}
+#endif
+
+/* Averages one source row horizontally into dst (4 floats per pixel) */
+static void reduce_row(const uint8_t *row, const BoxAxis& axis, size_t width, float *dst)
+{
+    for (size_t x = 0; x < width; x++)
+    {
+        const uint8_t *p = row + (size_t)axis.first[x] * 4;
+        const float *w = axis.weights.data() + axis.offset[x];
+        uint32_t count = axis.count[x];
+#if defined(__SSE2__)
+        __m128 acc = _mm_setzero_ps();
+        for (uint32_t k = 0; k < count; k++, p += 4)
+            acc = _mm_add_ps(acc, _mm_mul_ps(load_pixel_ps(p), _mm_set1_ps(w[k])));
+        _mm_storeu_ps(dst + x * 4, acc);
+#else
+        float acc[4] = { 0, 0, 0, 0 };
+        for (uint32_t k = 0; k < count; k++, p += 4)
+        {
+            for (int c = 0; c < 4; c++)
+                acc[c] += p[c] * w[k];
+        }
+        memcpy(dst + x * 4, acc, sizeof(acc));
+#endif
+    }
+}
+
+/* Adds weight * src to acc, count floats */
+static void accumulate_row(float *acc, const float *src, size_t count, float weight)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128 w = _mm_set1_ps(weight);
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(src + i), w)));
+#endif
+    for (; i < count; i++)
+        acc[i] += src[i] * weight;
+}
+
+/* Rounds and stores count floats as bytes */
+static void store_row(const float *acc, size_t count, uint8_t *dst)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128 half = _mm_set1_ps(0.5f);
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(acc + i), half));
+        __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(acc + i + 4), half));
+        __m128i c = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(acc + i + 8), half));
+        __m128i d = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(acc + i + 12), half));
+        __m128i v = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+    }
+#endif
+    for (; i < count; i++)
+        dst[i] = (uint8_t)std::min(255.0f, acc[i] + 0.5f);
+}
+
+bool box_downscale(const ImageBuffer& src, const ImageBuffer& dst)
+{
+    if (src.pixels == nullptr || dst.pixels == nullptr || src.format != dst.format ||
+        dst.width == 0 || dst.height == 0 || dst.width > src.width || dst.height > src.height)
+        return false;
+
+    static thread_local BoxAxis xaxis, yaxis;
+    static thread_local std::vector<float> rows;
+    build_axis(src.width, dst.width, xaxis);
+    build_axis(src.height, dst.height, yaxis);
+    size_t rowFloats = (size_t)dst.width * 4;
+    rows.resize(rowFloats * 2);
+    float *reduced = rows.data();
+    float *acc = reduced + rowFloats;
+
+    for (uint32_t y = 0; y < dst.height; y++)
+    {
+        memset(acc, 0, rowFloats * sizeof(float));
+        const float *w = yaxis.weights.data() + yaxis.offset[y];
+        for (uint32_t k = 0; k < yaxis.count[y]; k++)
+        {
+            reduce_row(src.pixels + (size_t)(yaxis.first[y] + k) * src.stride, xaxis, dst.width, reduced);
+            accumulate_row(acc, reduced, rowFloats, w[k]);
+        }
+        store_row(acc, rowFloats, dst.pixels + (size_t)y * dst.stride);
+    }
+    return true;
+}
+
+/* Converts premultiplied pixels back to straight alpha */
+static void unpremultiply_pixels(uint8_t *p, size_t count)
+{
+    for (size_t i = 0; i < count; i++, p += 4)
+    {
+        uint32_t a = p[3];
+        if (a == 255)
+            continue;
+        for (int c = 0; c < 3; c++)
+            p[c] = a == 0 ? 0 : (uint8_t)std::min<uint32_t>(255, (p[c] * 255 + a / 2) / a);
+    }
+}
+
+/* Decodes the image data of res into image, allocating its pixels from scratch */
+static bool decode_resource_image(WinLibrary& library, WinResource *res, const ImageBuffer& out,
+                                  std::vector<uint8_t>& scratch, ImageBuffer& image)
+{
+    const uint8_t *data = (const uint8_t*)res->offset();
+    size_t size = res->size();
+    int32_t type = -1;
+    parse_int32(res->type().c_str(), &type);
+
+    bool iconImage = false;
+    switch (type)
+    {
+    case RT_GROUP_ICON:
+    {
+        IconView view = library.selectIcon(res, std::max(out.width, out.height), 96, 32);
+        if (!view.isValid())
+            return false;
+        data = view.data;
+        size = view.size;
+        iconImage = true;
+        break;
+    }
+    case RT_CURSOR:
+        // skip the hotspot
+        if (size < 4)
+            return false;
+        data += 4;
+        size -= 4;
+        iconImage = true;
+        break;
+    case RT_ICON:
+        iconImage = true;
+        break;
+    }
+
+    ImageInfo info;
+    if (data == nullptr || !read_image_info(data, size, &info, iconImage))
+        return false;
+    // DIB headers can claim anything; refuse sizes no image resource has
+    if (info.width > 16384 || info.height > 16384 || !image_payload_fits(info, size))
+        return false;
+
+    scratch.resize((size_t)info.width * info.height * 4);
+    image.pixels = scratch.data();
+    image.width = info.width;
+    image.height = info.height;
+    image.stride = (size_t)info.width * 4;
+    image.format = out.format;
+    image.premultiplied = true;
+
+    if (info.format == ContentType::PNG)
+        return decode_png(data, size, image);
+    if (iconImage)
+        return decode_icon_image(data, size, image);
+    if (type == RT_BITMAP || info.format == ContentType::BMP || info.format == ContentType::DIB)
+        return decode_dib(data, size, image);
+    return false;
+}
+
+bool render_thumbnail(WinLibrary& library, WinResource *res, const ImageBuffer& out)
+{
+    if (res != nullptr && res->isDirectory())
+        res = res->children().empty() ? nullptr : &res->children()[0];
+    if (res == nullptr || res->offset() == nullptr || out.pixels == nullptr ||
+        out.width == 0 || out.height == 0 || out.stride < (size_t)out.width * 4)
+        return false;
+
+    static thread_local std::vector<uint8_t> scratch;
+    // pool threads live as long as the process; large images do not get to keep their memory
+    struct ScratchTrim
+    {
+        std::vector<uint8_t>& buffer;
+        ~ScratchTrim()
+        {
+            if (buffer.capacity() > THUMBNAIL_SCRATCH_KEEP)
+                std::vector<uint8_t>().swap(buffer);
+        }
+    } trim { scratch };
+    ImageBuffer image;
+    if (!decode_resource_image(library, res, out, scratch, image))
+        return false;
+
+    // fit into the thumbnail, keeping the aspect ratio
+    uint32_t width = image.width, height = image.height;
+    if (width > out.width || height > out.height)
+    {
+        if ((uint64_t)width * out.height > (uint64_t)height * out.width)
+        {
+            height = std::max<uint32_t>(1, (uint32_t)(((uint64_t)height * out.width + width / 2) / width));
+            width = out.width;
+        }
+        else
+        {
+            width = std::max<uint32_t>(1, (uint32_t)(((uint64_t)width * out.height + height / 2) / height));
+            height = out.height;
+        }
+    }
+
+    for (uint32_t y = 0; y < out.height; y++)
+        memset(out.pixels + (size_t)y * out.stride, 0, (size_t)out.width * 4);
+    ImageBuffer target = out;
+    target.width = width;
+    target.height = height;
+    target.pixels = out.pixels + (size_t)((out.height - height) / 2) * out.stride + (size_t)((out.width - width) / 2) * 4;
+
+    if (width == image.width && height == image.height)
+    {
+        for (uint32_t y = 0; y < height; y++)
+            memcpy(target.pixels + (size_t)y * target.stride, image.pixels + (size_t)y * image.stride, (size_t)width * 4);
+    }
+    else if (!box_downscale(image, target))
+        return false;
+
+    if (!out.premultiplied)
+    {
+        for (uint32_t y = 0; y < height; y++)
+            unpremultiply_pixels(target.pixels + (size_t)y * target.stride, width);
+    }
+    return true;
+}
+
+size_t render_thumbnails(WinLibrary& library, std::vector<ThumbnailJob>& jobs, ThreadPool *pool)
+{
+    std::atomic<size_t> rendered { 0 };
+    if (pool == nullptr)
+        pool = &ThreadPool::global();
+
+    pool->parallelFor(jobs.size(), [&](size_t i)
+    {
+        ThumbnailJob &job = jobs[i];
+        job.rendered = render_thumbnail(library, job.resource, job.output);
+        if (job.rendered)
+            rendered.fetch_add(1, std::memory_order_relaxed);
+    });
+    return rendered.load();
+}
+
+}
@@ -0,0 +1,65 @@
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "imagebuffer.h"
+
+namespace wres
+{
+
+class ThreadPool;
+class WinLibrary;
+class WinResource;
+
+/*
+ * Scales src down to the size of dst by area averaging: every destination
+ * pixel is the average of the source area it covers, with partially
+ * covered source pixels weighted by their coverage. Each pixel is handled
+ * as one SSE vector of its four channels.
+ *
+ * Both buffers must have the same pixel format, and dst must not be larger
+ * than src in either direction. Channels are averaged as they are, so src
+ * should be premultiplied for the alpha to come out right.
+ */
+bool box_downscale(const ImageBuffer& src, const ImageBuffer& dst);
+
+/*
+ * Renders a thumbnail of an image resource into out, whose dimensions are
+ * the thumbnail size. The image is scaled down to fit while keeping its
+ * aspect ratio and centered; the rest of out is transparent. Images that
+ * are smaller than out are not enlarged.
+ *
+ * Supported are RT_BITMAP, RT_ICON and RT_CURSOR resources, RT_GROUP_ICON
+ * resources (the image that best fits the thumbnail size is picked with
+ * WinLibrary::selectIcon(), so only that one is decoded), and resources
+ * whose content is PNG or BMP, like the IMAGE resources of msstyles. A
+ * name directory stands for its first language.
+ *
+ * This takes two passes: the whole image is decoded into a per-thread
+ * scratch buffer and then downscaled from there. The claimed image size is
+ * checked against the resource data first, and scratch buffers above 4 MiB
+ * are released after use. Returns false if the resource is not an image or
+ * cannot be decoded.
+ */
+bool render_thumbnail(WinLibrary& library, WinResource *res, const ImageBuffer& out);
+
+/*
+ * One thumbnail of a batch. rendered is set once it has been rendered.
+ */
+struct ThumbnailJob
+{
+    WinResource *resource = nullptr;
+    ImageBuffer output;
+    bool rendered = false;
+};
+
+/*
+ * Renders many thumbnails concurrently on the given pool (or the global
+ * pool). Returns the number of thumbnails that were rendered.
+ */
+size_t render_thumbnails(WinLibrary& library, std::vector<ThumbnailJob>& jobs, ThreadPool *pool = nullptr);
+
+}
+
+#endif // THUMBNAIL_H
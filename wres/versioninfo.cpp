@@ -0,0 +1,387 @@
+#include "versioninfo.h"
+#include "threadpool.h"
+#include "winlibrary.h"
+#include "wresutil.h"
+#include <atomic>
+#include <stddef.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace wres
+{
+
+/* Upper bound for RT_VERSION resources read in version only mode */
+#define VERSION_RESOURCE_MAX_SIZE (1024 * 1024)
+/* Upper bound for the section count, as enforced by the Windows loader */
+#define PE_MAX_SECTIONS 96
+
+/*
+ * One node of the VS_VERSIONINFO tree: wLength, wValueLength, wType, the
+ * null terminated key, padding, the value, padding and the children.
+ * Padding aligns to 32 bits relative to the start of the resource.
+ */
+struct VersionNode
+{
+    const uint8_t *end;
+    uint16_t type;
+    const uint8_t *key;
+    size_t keyLength;
+    const uint8_t *value;
+    size_t valueSize;
+    const uint8_t *children;
+};
+
+static inline const uint8_t* align4(const uint8_t *base, const uint8_t *p)
+{
+    return base + ((p - base + 3) & ~(size_t)3);
+}
+
+static bool parse_node(const uint8_t *base, const uint8_t *p, const uint8_t *limit, VersionNode *node)
+{
+    if (limit - p < 6)
+        return false;
+    size_t length = read_le16(p);
+    if (length < 6 || length > (size_t)(limit - p))
+        return false;
+    node->end = p + length;
+    uint16_t valueLength = read_le16(p + 2);
+    node->type = read_le16(p + 4);
+
+    node->key = p + 6;
+    const uint8_t *q = node->key;
+    while (q + 2 <= node->end && read_le16(q) != 0)
+        q += 2;
+    if (q + 2 > node->end)
+        return false;
+    node->keyLength = (q - node->key) / 2;
+
+    // text values count characters, binary values bytes
+    q = std::min(align4(base, q + 2), node->end);
+    node->value = q;
+    node->valueSize = std::min<size_t>(node->type == 1 ? valueLength * 2 : valueLength, node->end - q);
+    node->children = std::min(align4(base, q + node->valueSize), node->end);
+    return true;
+}
+
+static inline std::u16string_view node_key(const VersionNode& node)
+{
+    return utf16_view(node.key, node.keyLength);
+}
+
+/* Compares UTF-16LE text with an ASCII string */
+static bool key_equals(std::u16string_view key, const char *ascii)
+{
+    const uint8_t *p = (const uint8_t*)key.data();
+    size_t i = 0;
+    for (; i < key.size() && ascii[i] != '\0'; i++)
+    {
+        if (read_le16(p + i * 2) != (uint8_t)ascii[i])
+            return false;
+    }
+    return i == key.size() && ascii[i] == '\0';
+}
+
+/*
+ * The text of a String node. wValueLength is unreliable (some compilers
+ * store bytes, some characters, some 0), so the text is taken to be the
+ * rest of the node, up to the first null character.
+ */
+static std::u16string_view string_value(const VersionNode& node)
+{
+    const uint8_t *p = node.value;
+    while (p + 2 <= node.end && read_le16(p) != 0)
+        p += 2;
+    return utf16_view(node.value, (p - node.value) / 2);
+}
+
+bool VersionInfo::parse(const uint8_t *data, size_t size)
+{
+    m_isValid = false;
+    m_hasFixedFileInfo = false;
+    m_stringBlocks.clear();
+    m_translations.clear();
+
+    VersionNode root;
+    // all text is at an even offset from data, see utf16_view()
+    if (data == nullptr || ((uintptr_t)data & 1) != 0 || !parse_node(data, data, data + size, &root) ||
+        !key_equals(node_key(root), "VS_VERSION_INFO"))
+        return false;
+    m_isValid = true;
+
+    if (root.valueSize >= sizeof(Win32FixedFileInfo) && read_le32(root.value) == VS_FFI_SIGNATURE)
+    {
+        uint32_t *fields = (uint32_t*)&m_fixedFileInfo;
+        for (size_t i = 0; i < sizeof(Win32FixedFileInfo) / 4; i++)
+            fields[i] = read_le32(root.value + i * 4);
+        m_hasFixedFileInfo = true;
+    }
+
+    VersionNode info;
+    for (const uint8_t *p = root.children; parse_node(data, p, root.end, &info); p = align4(data, info.end))
+    {
+        if (key_equals(node_key(info), "StringFileInfo"))
+        {
+            VersionNode table;
+            for (const uint8_t *t = info.children; parse_node(data, t, info.end, &table); t = align4(data, table.end))
+            {
+                StringBlock block;
+                block.key = node_key(table);
+                VersionNode str;
+                for (const uint8_t *s = table.children; parse_node(data, s, table.end, &str); s = align4(data, str.end))
+                    block.strings.push_back({ node_key(str), string_value(str) });
+                m_stringBlocks.push_back(std::move(block));
+            }
+        }
+        else if (key_equals(node_key(info), "VarFileInfo"))
+        {
+            VersionNode var;
+            for (const uint8_t *v = info.children; parse_node(data, v, info.end, &var); v = align4(data, var.end))
+            {
+                if (!key_equals(node_key(var), "Translation"))
+                    continue;
+                for (size_t i = 0; i + 4 <= var.valueSize; i += 4)
+                    m_translations.push_back(read_le32(var.value + i));
+            }
+        }
+    }
+    return true;
+}
+
+bool VersionInfo::load(WinLibrary& library, const std::string& language)
+{
+    m_storage.clear();
+    WinResource *versions = library.findResource(std::string("16"), std::string(""), std::string(""));
+    for (auto r : library.collectResources(versions))
+    {
+        if (language.empty() || r->language() == language)
+            return parse((const uint8_t*)r->offset(), r->size());
+    }
+    m_isValid = false;
+    return false;
+}
+
+bool VersionInfo::loadFile(const std::string& path)
+{
+    m_isValid = false;
+    if (!read_version_resource(path, m_storage))
+        return false;
+    return parse(m_storage.data(), m_storage.size());
+}
+
+bool VersionInfo::isValid() const
+{
+    return m_isValid;
+}
+
+const Win32FixedFileInfo* VersionInfo::fixedFileInfo() const
+{
+    return m_hasFixedFileInfo ? &m_fixedFileInfo : nullptr;
+}
+
+static std::string format_version(uint32_t ms, uint32_t ls)
+{
+    return std::to_string(ms >> 16) + "." + std::to_string(ms & 0xffff) + "." +
+           std::to_string(ls >> 16) + "." + std::to_string(ls & 0xffff);
+}
+
+std::string VersionInfo::fileVersion() const
+{
+    if (!m_hasFixedFileInfo)
+        return std::string();
+    return format_version(m_fixedFileInfo.file_version_ms, m_fixedFileInfo.file_version_ls);
+}
+
+std::string VersionInfo::productVersion() const
+{
+    if (!m_hasFixedFileInfo)
+        return std::string();
+    return format_version(m_fixedFileInfo.product_version_ms, m_fixedFileInfo.product_version_ls);
+}
+
+const std::vector<VersionInfo::StringBlock>& VersionInfo::stringBlocks() const
+{
+    return m_stringBlocks;
+}
+
+std::u16string_view VersionInfo::value(const std::string& key) const
+{
+    for (auto &block : m_stringBlocks)
+    {
+        for (auto &str : block.strings)
+        {
+            if (key_equals(str.key, key.c_str()))
+                return str.value;
+        }
+    }
+    return std::u16string_view();
+}
+
+std::string VersionInfo::valueUtf8(const std::string& key) const
+{
+    std::string result;
+    std::u16string_view text = value(key);
+    append_utf16le_as_utf8(result, (const uint8_t*)text.data(), text.size());
+    return result;
+}
+
+const std::vector<uint32_t>& VersionInfo::translations() const
+{
+    return m_translations;
+}
+
+static bool read_at(int fd, uint64_t offset, void *buffer, size_t size)
+{
+    uint8_t *p = (uint8_t*)buffer;
+    while (size > 0)
+    {
+        ssize_t n = pread(fd, p, size, (off_t)offset);
+        if (n <= 0)
+            return false;
+        p += n;
+        offset += n;
+        size -= n;
+    }
+    return true;
+}
+
+/* Maps a relative virtual address to a file offset using the section table */
+static bool rva_to_offset(const uint8_t *sections, unsigned count, uint32_t rva, uint64_t *offset)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        const uint8_t *s = sections + i * sizeof(Win32ImageSectionHeader);
+        uint32_t va = read_le32(s + offsetof(Win32ImageSectionHeader, virtual_address));
+        uint32_t raw = read_le32(s + offsetof(Win32ImageSectionHeader, size_of_raw_data));
+        uint32_t ptr = read_le32(s + offsetof(Win32ImageSectionHeader, pointer_to_raw_data));
+        if (rva >= va && rva - va < raw)
+        {
+            *offset = (uint64_t)ptr + (rva - va);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Looks up an entry of the resource directory at dirOffset (relative to
+ * the resource section). With id < 0 the first entry is taken. Returns the
+ * entry's offset_to_data field.
+ */
+static bool find_directory_entry(int fd, uint64_t rsrc, uint32_t dirOffset, int id, uint32_t *entry)
+{
+    uint8_t header[sizeof(Win32ImageResourceDirectory)];
+    if (!read_at(fd, rsrc + dirOffset, header, sizeof(header)))
+        return false;
+    unsigned named = read_le16(header + offsetof(Win32ImageResourceDirectory, number_of_named_entries));
+    unsigned ids = read_le16(header + offsetof(Win32ImageResourceDirectory, number_of_id_entries));
+    if (named + ids == 0)
+        return false;
+
+    // named entries come first, then the ids in ascending order
+    unsigned first = id < 0 ? 0 : named;
+    unsigned count = id < 0 ? 1 : ids;
+    if (count == 0)
+        return false;
+    std::vector<uint8_t> entries(count * sizeof(Win32ImageResourceDirectoryEntry));
+    if (!read_at(fd, rsrc + dirOffset + sizeof(header) + first * sizeof(Win32ImageResourceDirectoryEntry),
+                 entries.data(), entries.size()))
+        return false;
+    for (unsigned i = 0; i < count; i++)
+    {
+        const uint8_t *e = entries.data() + i * sizeof(Win32ImageResourceDirectoryEntry);
+        if (id < 0 || read_le32(e) == (uint32_t)id)
+        {
+            *entry = read_le32(e + 4);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool read_version_resource(const std::string& path, std::vector<uint8_t>& out)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    bool ok = false;
+    do
+    {
+        uint8_t mz[sizeof(DOSImageHeader)];
+        if (!read_at(fd, 0, mz, sizeof(mz)) || read_le16(mz) != IMAGE_DOS_SIGNATURE)
+            break;
+        uint32_t lfanew = read_le32(mz + offsetof(DOSImageHeader, lfanew));
+
+        // signature and file header
+        uint8_t nt[4 + sizeof(Win32ImageFileHeader)];
+        if (!read_at(fd, lfanew, nt, sizeof(nt)) || read_le32(nt) != IMAGE_NT_SIGNATURE)
+            break;
+        unsigned sections = read_le16(nt + 4 + offsetof(Win32ImageFileHeader, number_of_sections));
+        unsigned optionalSize = read_le16(nt + 4 + offsetof(Win32ImageFileHeader, size_of_optional_header));
+        if (sections == 0 || sections > PE_MAX_SECTIONS || optionalSize < 2)
+            break;
+
+        // optional header and section table in one read
+        std::vector<uint8_t> headers(optionalSize + sections * sizeof(Win32ImageSectionHeader));
+        if (!read_at(fd, lfanew + sizeof(nt), headers.data(), headers.size()))
+            break;
+        const uint8_t *optional = headers.data();
+        size_t dirOffset;
+        if (read_le16(optional) == OPTIONAL_MAGIC_PE32)
+            dirOffset = offsetof(Win32ImageOptionalHeader, data_directory);
+        else if (read_le16(optional) == OPTIONAL_MAGIC_PE32_64)
+            dirOffset = offsetof(Win32ImageOptionalHeader64, data_directory);
+        else
+            break;
+        size_t resourceDir = dirOffset + IMAGE_DIRECTORY_ENTRY_RESOURCE * sizeof(Win32ImageDataDirectory);
+        if (resourceDir + sizeof(Win32ImageDataDirectory) > optionalSize)
+            break;
+        uint32_t rsrcRva = read_le32(optional + resourceDir);
+        uint64_t rsrc;
+        const uint8_t *sectionTable = headers.data() + optionalSize;
+        if (rsrcRva == 0 || !rva_to_offset(sectionTable, sections, rsrcRva, &rsrc))
+            break;
+
+        // type -> name -> language, then the data entry
+        uint32_t entry;
+        if (!find_directory_entry(fd, rsrc, 0, RT_VERSION, &entry) || !(entry & IMAGE_RESOURCE_DATA_IS_DIRECTORY) ||
+            !find_directory_entry(fd, rsrc, entry & ~IMAGE_RESOURCE_DATA_IS_DIRECTORY, -1, &entry) ||
+            !(entry & IMAGE_RESOURCE_DATA_IS_DIRECTORY) ||
+            !find_directory_entry(fd, rsrc, entry & ~IMAGE_RESOURCE_DATA_IS_DIRECTORY, -1, &entry) ||
+            (entry & IMAGE_RESOURCE_DATA_IS_DIRECTORY))
+            break;
+        uint8_t data[sizeof(Win32ImageResourceDataEntry)];
+        if (!read_at(fd, rsrc + entry, data, sizeof(data)))
+            break;
+        uint32_t rva = read_le32(data + offsetof(Win32ImageResourceDataEntry, offset_to_data));
+        uint32_t size = read_le32(data + offsetof(Win32ImageResourceDataEntry, size));
+        uint64_t offset;
+        if (size == 0 || size > VERSION_RESOURCE_MAX_SIZE || !rva_to_offset(sectionTable, sections, rva, &offset))
+            break;
+        out.resize(size);
+        ok = read_at(fd, offset, out.data(), size);
+    } while (false);
+
+    close(fd);
+    return ok;
+}
+
+size_t scan_versions(std::vector<VersionScanJob>& jobs, ThreadPool *pool)
+{
+    std::atomic<size_t> found { 0 };
+    if (pool == nullptr)
+        pool = &ThreadPool::global();
+
+    pool->parallelFor(jobs.size(), [&](size_t i)
+    {
+        VersionScanJob &job = jobs[i];
+        job.found = job.info.loadFile(job.path);
+        if (job.found)
+            found.fetch_add(1, std::memory_order_relaxed);
+    });
+    return found.load();
+}
+
+}
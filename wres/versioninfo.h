@@ -0,0 +1,133 @@
+#ifndef VERSIONINFO_H
+#define VERSIONINFO_H
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "win32.h"
+
+namespace wres
+{
+
+class ThreadPool;
+class WinLibrary;
+
+class VersionInfo
+{
+public:
+    /* One String node of a StringTable: a key such as "FileVersion" and its value */
+    struct String
+    {
+        std::u16string_view key;
+        std::u16string_view value;
+    };
+    /* A StringTable node; its key is the language and code page, e.g. "040904B0" */
+    struct StringBlock
+    {
+        std::u16string_view key;
+        std::vector<String> strings;
+    };
+
+    /*
+     * VersionInfo parses a VS_VERSIONINFO structure, the content of
+     * RT_VERSION resources. The VS_VERSION_INFO root carries the
+     * VS_FIXEDFILEINFO, StringFileInfo holds one StringTable per language
+     * and VarFileInfo lists the translations.
+     *
+     * Keys and values are views of the UTF-16LE text in the parsed data,
+     * nothing is copied. The data has to be 2-byte aligned for that;
+     * parse() rejects data at an odd address. When the data comes from parse() or load(), it
+     * has to outlive the VersionInfo; loadFile() keeps its own copy of the
+     * resource. Copying is disabled because of the views; moving is fine.
+     */
+    VersionInfo() = default;
+    VersionInfo(const VersionInfo&) = delete;
+    VersionInfo& operator=(const VersionInfo&) = delete;
+    VersionInfo(VersionInfo&&) = default;
+    VersionInfo& operator=(VersionInfo&&) = default;
+
+    /*
+     * Parses the given RT_VERSION data. Returns false if the data does not
+     * start with a VS_VERSION_INFO node. Malformed child nodes are skipped.
+     */
+    bool parse(const uint8_t *data, size_t size);
+    /*
+     * Parses the first RT_VERSION resource of the library (in the given
+     * language, if not empty).
+     */
+    bool load(WinLibrary& library, const std::string& language = "");
+    /*
+     * Version only mode: reads the RT_VERSION resource of a PE file without
+     * loading the file. Only the headers, the section table, the resource
+     * directory entries on the path to the first RT_VERSION resource and
+     * the resource itself are read, with a few positioned reads.
+     */
+    bool loadFile(const std::string& path);
+
+    bool isValid() const;
+    /*
+     * Returns the VS_FIXEDFILEINFO (in host byte order), or nullptr if the
+     * resource has none.
+     */
+    const Win32FixedFileInfo* fixedFileInfo() const;
+    /*
+     * Returns the file and product versions of the VS_FIXEDFILEINFO as
+     * "major.minor.build.revision", or an empty string if there is none.
+     */
+    std::string fileVersion() const;
+    std::string productVersion() const;
+
+    const std::vector<StringBlock>& stringBlocks() const;
+    /*
+     * Returns the value of the string with the given key (such as
+     * "CompanyName") from the first StringTable that has it, or an empty
+     * view.
+     */
+    std::u16string_view value(const std::string& key) const;
+    /*
+     * Same as value(), converted to UTF-8.
+     */
+    std::string valueUtf8(const std::string& key) const;
+    /*
+     * Returns the translations listed in VarFileInfo. Each one holds the
+     * language id in the low and the code page in the high 16 bits.
+     */
+    const std::vector<uint32_t>& translations() const;
+
+private:
+    std::vector<uint8_t> m_storage;
+    bool m_isValid = false;
+    bool m_hasFixedFileInfo = false;
+    Win32FixedFileInfo m_fixedFileInfo;
+    std::vector<StringBlock> m_stringBlocks;
+    std::vector<uint32_t> m_translations;
+};
+
+/*
+ * Reads the first RT_VERSION resource of the PE file at path into out, as
+ * done by VersionInfo::loadFile().
+ */
+bool read_version_resource(const std::string& path, std::vector<uint8_t>& out);
+
+/*
+ * One file of a batch version scan. found is set if the file has a valid
+ * RT_VERSION resource, which is then available in info.
+ */
+struct VersionScanJob
+{
+    std::string path;
+    VersionInfo info;
+    bool found = false;
+};
+
+/*
+ * Reads the versions of many files concurrently in version only mode, on
+ * the given pool (or the global pool). Returns the number of files that
+ * had version information.
+ */
+size_t scan_versions(std::vector<VersionScanJob>& jobs, ThreadPool *pool = nullptr);
+
+}
+
+#endif // VERSIONINFO_H
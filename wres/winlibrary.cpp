@@ -1,33 +1,56 @@
 #include "winlibrary.h"
+#include "imageinfo.h"
+#include "boundedspan.h"
+#include "log.h"
+#if WRES_IMAGE_CODECS
+#include "dibdecoder.h"
+#include "pngencoder.h"
+#endif
 #include <algorithm>
+#include <climits>
+#include <errno.h>
+#include <string.h>
 #include <inttypes.h>
+#include <fcntl.h>
 
 namespace wres
 {
 
-bool WinLibrary::compareResourceId(const WinResource& res, std::string id, WinResource::id_type idType)
+/* Library data comes from arbitrary files, so every range is checked */
+typedef BoundedSpan<CheckedBounds> LibrarySpan;
+
+void WinLibrary::fail(ParseError code, const void *at, const char *context)
+{
+    if (!m_status.ok())
+        return;
+    m_status.code = code;
+    m_status.offset = (uintptr_t)at >= (uintptr_t)m_data ? (uintptr_t)at - (uintptr_t)m_data : 0;
+    m_status.context = context;
+}
+
+bool WinLibrary::compareResourceId(const WinResource& res, const std::string& id, WinResource::id_type idType)
 {
     return id == res.id() && (idType == WinResource::Any || idType == res.idType());
 }
 
-WinResource* WinLibrary::findResource(std::string type, std::string name, std::string language,
-                                             WinResource::id_type tType,
-                                             WinResource::id_type nType,
-                                             WinResource::id_type lType)
+const WinResource* WinLibrary::findResource(const std::string& type, const std::string& name, const std::string& language,
+                                            WinResource::id_type tType,
+                                            WinResource::id_type nType,
+                                            WinResource::id_type lType) const
 {
-    auto find_with_resource_array = [&](WinResource* r, std::string str, WinResource::id_type t) -> WinResource*
+    auto find_with_resource_array = [&](const WinResource* r, const std::string& str, WinResource::id_type t) -> const WinResource*
     {
         auto it = std::find_if(r->children().begin(), r->children().end(), [&](const WinResource &a) { return WinLibrary::compareResourceId(a, str, t); });
         if(it == r->children().end()) return nullptr;
         return &(*it);
     };
 
-    if(!m_isValid || !isLoaded() || !m_isPEBinary)
+    if(!m_isValid || !isLoaded())
     {
-        warn("[wres] Cannot find resource from an invalid file.\n");
+        WRES_LOG_WARNING("cannot find resource from an invalid file");
         return nullptr;
     }
-    WinResource *wr = &m_root;
+    const WinResource *wr = &m_root;
 
     // Search by type first
     if (type == "" || type.empty())
@@ -50,18 +73,36 @@ WinResource* WinLibrary::findResource(std::string type, std::string name, std::s
     return wr;
 }
 
-WinLibrary::WinLibrary(std::string p)
+WinResource* WinLibrary::findResource(const std::string& type, const std::string& name, const std::string& language,
+                                      WinResource::id_type tType,
+                                      WinResource::id_type nType,
+                                      WinResource::id_type lType)
+{
+    // the tree is owned by this non-const library, so handing out mutable nodes is fine
+    const WinLibrary *self = this;
+    return const_cast<WinResource*>(self->findResource(type, name, language, tType, nType, lType));
+}
+
+WinLibrary::WinLibrary(std::string p, const ParseLimits& limits)
+    : m_limits(limits)
 {
     m_path = p;
-    m_length = file_size(p.c_str());
-    if(m_length == -1)
+    off_t length = file_size(p.c_str());
+    if(length == -1)
     {
-        warn("[wres] Failed to get file size of %s!\n", p.c_str());
+        fail(ParseError::OpenFailed, nullptr, "file size");
         return;
     }
-    if(m_length == 0)
+    if(length == 0)
     {
-        warn("[wres] File %s has a size of 0 bytes!\n", p.c_str());
+        fail(ParseError::EmptyFile, nullptr, "file size");
+        m_isValid = false;
+        return;
+    }
+    /* the whole file is held in memory and m_length is an int */
+    if((uint64_t)length > m_limits.maxAllocation || length > INT_MAX)
+    {
+        fail(ParseError::LimitExceeded, nullptr, "maxAllocation");
         m_isValid = false;
         return;
     }
@@ -69,23 +110,42 @@ WinLibrary::WinLibrary(std::string p)
     m_fi = fopen(p.c_str(), "rb");
     if(!m_fi)
     {
-        warn("[wres] Failed to open file %s!\n", p.c_str());
+        fail(ParseError::OpenFailed, nullptr, "open");
         m_isValid = false;
         return;
     }
 
+#if defined(POSIX_FADV_SEQUENTIAL)
+    /* the whole file is read front to back, let the kernel read ahead */
+    posix_fadvise(fileno(m_fi), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
     /* read all of file */
-    m_data = (char*)malloc(m_length);
-    if (fread(m_data, m_length, 1, m_fi) != 1)
+    m_data = (char*)malloc(length);
+    if (m_data == nullptr)
     {
-        warn("[wres] Error while reading file %s!\n", p.c_str());
+        fail(ParseError::LimitExceeded, nullptr, "maxAllocation");
+        fclose(m_fi);
+        m_fi = nullptr;
         m_isValid = false;
         return;
     }
+    if (fread(m_data, length, 1, m_fi) != 1)
+    {
+        fail(ParseError::ReadFailed, nullptr, "read");
+        fclose(m_fi);
+        m_fi = nullptr;
+        m_isValid = false;
+        return;
+    }
+    fclose(m_fi);
+    m_fi = nullptr;
+    /* only a file that was read completely counts as loaded */
+    m_length = (int)length;
 
     if(!this->read_library())
     {
-        warn("[wres] Something went wrong while parsing the library header\n");
+        fail(ParseError::BadHeader, m_data, "read_library");
         m_isValid = false;
         return;
     }
@@ -131,32 +191,47 @@ void WinLibrary::printResourceTree()
 
 void* WinLibrary::set_resource_entry(WinResource *wr)
 {
+    /* only the language level points at data */
+    if (wr->isDirectory())
+        return NULL;
+
     if (m_isPEBinary)
     {
-        Win32ImageResourceDataEntry *dataent;
-
-        dataent = (Win32ImageResourceDataEntry*)(wr->location());
-        CHECK_IF_BAD_POINTER(NULL, *dataent);
-        size_t size = dataent->size;
-        CHECK_IF_BAD_OFFSET(NULL, m_data + dataent->offset_to_data, size);
+        LibrarySpan file(m_data, m_length);
+        LibrarySpan dataent = file.array<Win32ImageResourceDataEntry>(file.offsetOf(wr->location()), 1);
+        if (!dataent.isValid())
+        {
+            fail(ParseError::Truncated, wr->location(), "resource data entry");
+            return NULL;
+        }
+        size_t offset = dataent.get<Win32ImageResourceDataEntry>().offset_to_data;
+        size_t size = dataent.get<Win32ImageResourceDataEntry>().size;
+        if (!file.sub(offset, size).isValid())
+        {
+            fail(ParseError::Truncated, m_data + offset, "resource data");
+            return NULL;
+        }
 
         wr->setSize(size);
-        wr->setOffset(m_data + dataent->offset_to_data);
-        return m_data + dataent->offset_to_data;
+        wr->setOffset(m_data + offset);
+        return m_data + offset;
     }
     else
     {
         Win16NENameInfo *nameinfo;
-        int sizeshift;
+        unsigned sizeshift;
 
         nameinfo = (Win16NENameInfo*)(wr->location());
+        CHECK_IF_BAD_POINTER(NULL, *nameinfo);
+        /* checked against NE_MAX_ALIGN_SHIFT by read_library() */
         sizeshift = *((uint16_t *) m_firstResource - 1);
-        size_t size = nameinfo->length << sizeshift;
-        CHECK_IF_BAD_OFFSET(NULL, m_data + (nameinfo->offset << sizeshift), size);
+        size_t offset = (size_t)nameinfo->offset << sizeshift;
+        size_t size = (size_t)nameinfo->length << sizeshift;
+        CHECK_IF_BAD_OFFSET(NULL, m_data + offset, size);
 
         wr->setSize(size);
-        wr->setOffset(m_data + (nameinfo->offset << sizeshift));
-        return m_data + (nameinfo->offset << sizeshift);
+        wr->setOffset(m_data + offset);
+        return m_data + offset;
     }
 }
 
@@ -165,21 +240,26 @@ bool WinLibrary::decode_pe_resource_id(WinResource *wr, uint32_t value)
     std::string s_id;
     if (value & IMAGE_RESOURCE_NAME_IS_STRING)
     {
-        /* numeric id */
-        int c, len;
-        uint16_t *mem = (uint16_t *)(m_firstResource + (value & ~IMAGE_RESOURCE_NAME_IS_STRING));
+        /* string id: a length prefixed UTF-16 string, of which only the low bytes are kept */
+        LibrarySpan file(m_data, m_length);
+        size_t offset = file.offsetOf(m_firstResource) + (value & ~IMAGE_RESOURCE_NAME_IS_STRING);
+        LibrarySpan length = file.sub(offset, sizeof(uint16_t));
+        LibrarySpan name = length.isValid() ? file.array<uint16_t>(offset + sizeof(uint16_t), length.le16(0)) : length;
+        if (!name.isValid())
+        {
+            fail(ParseError::Truncated, m_data + offset, "resource name");
+            return false;
+        }
 
-        /* copy each char of the string, and terminate it */
-        CHECK_IF_BAD_POINTER(false, *mem);
-        len = mem[0];
-        CHECK_IF_BAD_OFFSET(false, &mem[1], sizeof(uint16_t) * len);
-
-        len = std::min(mem[0], static_cast<uint16_t>(WINRES_ID_MAXLEN));
-        char tmp[len+1];
-        for (c = 0; c < len; c++)
-            tmp[c] = mem[c+1] & 0x00FF;
-        tmp[len] = '\0';
-        s_id = std::string(tmp);
+        size_t len = std::min<size_t>(name.size() / sizeof(uint16_t), WINRES_ID_MAXLEN);
+        s_id.reserve(len);
+        for (size_t c = 0; c < len; c++)
+        {
+            char ch = (char)(name.le16(c * sizeof(uint16_t)) & 0x00FF);
+            if (ch == '\0')
+                break;
+            s_id.push_back(ch);
+        }
     }
     else
     {
@@ -193,37 +273,135 @@ bool WinLibrary::decode_pe_resource_id(WinResource *wr, uint32_t value)
     wr->setId(s_id, (value & IMAGE_RESOURCE_NAME_IS_STRING ? WinResource::String : WinResource::Numeric));
     return true;
 }
-std::vector<WinResource> WinLibrary::list_pe_resources(WinResource &res)
+/* decode_ne_resource_id:
+ *   NE ids with the high bit set are numeric. Others are offsets of a
+ *   length prefixed ASCII name, relative to the resource table.
+ */
+bool WinLibrary::decode_ne_resource_id(WinResource *wr, uint16_t value)
+{
+    std::string s_id;
+    if (value & NE_RESOURCE_NAME_IS_NUMERIC)
+    {
+        s_id = std::to_string(value & ~NE_RESOURCE_NAME_IS_NUMERIC);
+    }
+    else
+    {
+        uint8_t *mem = (uint8_t*)NE_HEADER(m_data) + NE_HEADER(m_data)->rsrctab + value;
+
+        CHECK_IF_BAD_POINTER(false, *mem);
+        size_t len = mem[0];
+        CHECK_IF_BAD_OFFSET(false, &mem[1], len);
+        len = std::min(len, static_cast<size_t>(WINRES_ID_MAXLEN));
+        s_id = std::string((const char*)&mem[1], len);
+    }
+
+    wr->setId(s_id, (value & NE_RESOURCE_NAME_IS_NUMERIC ? WinResource::Numeric : WinResource::String));
+    return true;
+}
+
+/* list_ne_resources:
+ *   The NE resource table is a list of Win16NETypeInfo entries, each
+ *   followed by its Win16NENameInfo entries, and ends with a type id of 0.
+ *   NE resources have no language, so every name gets a single language
+ *   entry "0" (neutral) to give the tree the same shape as for PE files.
+ */
+std::vector<WinResource> WinLibrary::list_ne_resources(WinResource &res)
 {
-    Win32ImageResourceDirectory *pe_res = (Win32ImageResourceDirectory*)(res.location());
-    int level = res.level()+1;
     std::vector<WinResource> result;
+    int level = res.level()+1;
+
+    if (level == 0)
+    {
+        Win16NETypeInfo *typeinfo = (Win16NETypeInfo*)m_firstResource;
+        for (;;)
+        {
+            CHECK_IF_BAD_POINTER(std::vector<WinResource>(), typeinfo->type_id);
+            if (typeinfo->type_id == 0)
+                break;
+            CHECK_IF_BAD_POINTER(std::vector<WinResource>(), *typeinfo);
+            CHECK_IF_BAD_OFFSET(std::vector<WinResource>(), typeinfo + 1, typeinfo->count * sizeof(Win16NENameInfo));
+
+            WinResource r;
+            r.setParent(&res);
+            r.setLevel(level);
+            r.setIsDirectory(true);
+            r.setLocation((uint8_t*)typeinfo);
+            if (typeinfo->count != 0 && decode_ne_resource_id(&r, typeinfo->type_id))
+                result.push_back(r);
+            typeinfo = NE_TYPEINFO_NEXT(typeinfo);
+        }
+    }
+    else if (level == 1)
+    {
+        Win16NETypeInfo *typeinfo = (Win16NETypeInfo*)res.location();
+        Win16NENameInfo *nameinfo = (Win16NENameInfo*)(typeinfo + 1);
+        for (int c = 0; c < typeinfo->count; c++)
+        {
+            WinResource r;
+            r.setParent(&res);
+            r.setLevel(level);
+            r.setIsDirectory(true);
+            r.setLocation((uint8_t*)(nameinfo + c));
+            if (decode_ne_resource_id(&r, nameinfo[c].id))
+                result.push_back(r);
+        }
+    }
+    else if (level == 2)
+    {
+        WinResource r;
+        r.setParent(&res);
+        r.setLevel(level);
+        r.setIsDirectory(false);
+        r.setLocation(res.location());
+        r.setId("0", WinResource::Numeric);
+        result.push_back(r);
+    }
 
-    int dirent_c, rescnt;
-    Win32ImageResourceDirectoryEntry *dirent = (Win32ImageResourceDirectoryEntry*)(pe_res + 1);
+    return result;
+}
 
-    /* count number of `type' resources */
-    CHECK_IF_BAD_POINTER(std::vector<WinResource>(), *dirent);
-    rescnt = pe_res->number_of_named_entries + pe_res->number_of_id_entries;
+std::vector<WinResource> WinLibrary::list_pe_resources(WinResource &res)
+{
+    // the directory header and then all of its entries are validated with one range check each
+    LibrarySpan file(m_data, m_length);
+    size_t offset = file.offsetOf(res.location());
+    LibrarySpan header = file.array<Win32ImageResourceDirectory>(offset, 1);
+    if (!header.isValid())
+    {
+        fail(ParseError::Truncated, res.location(), "resource directory");
+        return {};
+    }
+    const Win32ImageResourceDirectory &pe_res = header.get<Win32ImageResourceDirectory>();
+    size_t rescnt = (size_t)pe_res.number_of_named_entries + pe_res.number_of_id_entries;
     if (rescnt == 0) return {};
+    LibrarySpan entries = file.array<Win32ImageResourceDirectoryEntry>(offset + sizeof(Win32ImageResourceDirectory), rescnt);
+    if (!entries.isValid())
+    {
+        fail(ParseError::Truncated, res.location(), "resource directory entries");
+        return {};
+    }
+
+    int level = res.level()+1;
+    std::vector<WinResource> result;
+    result.reserve(rescnt);
 
     /* fill in the WinResource's */
-    for (dirent_c = 0; dirent_c < rescnt; dirent_c++)
+    for (size_t dirent_c = 0; dirent_c < rescnt; dirent_c++)
     {
-        CHECK_IF_BAD_POINTER(std::vector<WinResource>(), dirent[dirent_c]);
+        const Win32ImageResourceDirectoryEntry &dirent = entries.get<Win32ImageResourceDirectoryEntry>(dirent_c);
         // Tracks the parent apparently instead of it being self-referential
         WinResource r;
         r.setParent(&res);
         r.setLevel(level);
-        r.setIsDirectory((dirent[dirent_c].u2.s.data_is_directory));
+        r.setIsDirectory((dirent.u2.s.data_is_directory));
 
         /* Require data to point somewhere after the directory */
-        if (dirent[dirent_c].u2.s.offset_to_directory < sizeof(Win32ImageResourceDirectory))
+        if (dirent.u2.s.offset_to_directory < sizeof(Win32ImageResourceDirectory))
             continue;
-        r.setLocation(m_firstResource + dirent[dirent_c].u2.s.offset_to_directory);
+        r.setLocation(m_firstResource + dirent.u2.s.offset_to_directory);
 
         /* fill in wr->id, wr->numeric_id */
-        if(!decode_pe_resource_id(&r, dirent[dirent_c].u1.name))
+        if(!decode_pe_resource_id(&r, dirent.u1.name))
             continue;
         result.push_back(r);
 
@@ -233,92 +411,125 @@ std::vector<WinResource> WinLibrary::list_pe_resources(WinResource &res)
 }
 bool WinLibrary::buildResourceTree(WinResource *res)
 {
-    if(!m_isValid || !isLoaded() || !m_isPEBinary)
+    if(!m_isValid || !isLoaded())
+    {
+        WRES_LOG_WARNING("cannot build resource tree from an invalid file");
+        return false;
+    }
+    TreeBudget budget;
+    budget.visited.reserve(256);
+    budget.visited.insert(TreeBudget::visit_key(*res));
+    return build_tree(res, budget);
+}
+
+bool WinLibrary::build_tree(WinResource *res, TreeBudget& budget)
+{
+    if(res->level() + 1 >= m_limits.maxDepth)
     {
-        warn("[wres] Cannot build resource tree from an invalid file.\n");
+        fail(ParseError::LimitExceeded, res->location(), "maxDepth");
         return false;
     }
     res->setChildren(list_resources(*res));
     if(res->children().size() == 0) return false;
 
+    budget.nodes += res->children().size();
+    if(budget.nodes > m_limits.maxNodes)
+    {
+        res->setChildren({});
+        fail(ParseError::LimitExceeded, res->location(), "maxNodes");
+        return false;
+    }
+
     for(int i = 0; i < res->children().size(); i++)
     {
-        if (res->children()[i].level() <= res->level() || (res->level() >= 3))
+        WinResource &child = res->children()[i];
+        if (child.level() <= res->level() || (res->level() >= 3))
         {
-            warn("[wres] %s: resource structure malformed\n", m_path.c_str());
+            fail(ParseError::Malformed, child.location(), "resource tree");
             return false;
         }
-        switch(res->children()[i].level())
+        switch(child.level())
         {
             case 0:
-                res->children()[i].setType(res->children()[i].id());
+                child.setType(child.id());
                 break;
             case 1: // Inherit type from parent
-                if(res->children()[i].parent() == nullptr)
+                if(child.parent() == nullptr)
                 {
-                    warn("[wres] Resource with nonzero level has a null parent!\n");
+                    fail(ParseError::Malformed, child.location(), "resource parent");
                     return false;
                 }
-                res->children()[i].setType(res->children()[i].parent()->type());
-                res->children()[i].setName(res->children()[i].id());
+                child.setType(child.parent()->type());
+                child.setName(child.id());
                 break;
             case 2: // Inherit type and name from parent
-                if(res->children()[i].parent() == nullptr)
+                if(child.parent() == nullptr)
                 {
-                    printf("[wres] Resource with nonzero level has a null parent!\n");
+                    fail(ParseError::Malformed, child.location(), "resource parent");
                     return false;
                 }
-                res->children()[i].setType(res->children()[i].parent()->type());
-                res->children()[i].setName(res->children()[i].parent()->name());
-                res->children()[i].setLanguage(res->children()[i].id());
+                child.setType(child.parent()->type());
+                child.setName(child.parent()->name());
+                child.setLanguage(child.id());
                 break;
         }
-        set_resource_entry(&(res->children()[i]));
-        if(res->children()[0].isDirectory())
+        if(child.isDirectory())
+        {
+            // directories are trees, not graphs: never walk one twice
+            if(!budget.visited.insert(TreeBudget::visit_key(child)).second)
+            {
+                fail(ParseError::Malformed, child.location(), "shared resource directory");
+                continue;
+            }
+            build_tree(&child, budget);
+            if(budget.nodes > m_limits.maxNodes || budget.declaredBytes > m_limits.maxDeclaredBytes)
+                return false;
+        }
+        else
         {
-            buildResourceTree(&(res->children()[i]));
+            set_resource_entry(&child);
+            budget.declaredBytes += child.size();
+            if(budget.declaredBytes > m_limits.maxDeclaredBytes)
+            {
+                fail(ParseError::LimitExceeded, child.location(), "maxDeclaredBytes");
+                return false;
+            }
         }
     }
 
     return true;
 }
 
-bool WinLibrary::extractResource(WinResource* res, std::string outpath, bool raw)
+bool WinLibrary::extractResource(WinResource* res, std::string outpath, bool raw, bool offsetOrder,
+                                 bool imagesAsPng)
 {
-    auto get_destination_name = [&]() -> std::string
-    {
-        std::string str(basename(this->m_path.c_str()));
-        std::string extension = res->getExtractExtension();
-
-        if(res->type() != "" && !res->type().empty())
-        {
-            str += std::string("_") + res->type();
-        }
-        if(res->name() != "" && !res->name().empty())
-            str += std::string("_") + res->name();
-        if(res->language() != "" && !res->language().empty())
-            str += std::string("_") + res->language();
-
-        str += extension;
-
-        return outpath + ((outpath.empty() || outpath == "") ? std::string("") : std::string("/")) + str;
-    };
-
-    if(!m_isValid || !isLoaded() || !m_isPEBinary)
+    if(!m_isValid || !isLoaded())
     {
-        warn("[wres] Cannot extract from an invalid file.\n");
+        WRES_LOG_WARNING("cannot extract from an invalid file");
         return false;
     }
     if(res == nullptr)
     {
-        warn("[wres] Cannot extract from a null resource.\n");
+        WRES_LOG_WARNING("cannot extract from a null resource");
         return false;
     }
-    if(res->isDirectory())
+    if(res->isDirectory() && offsetOrder)
     {
-        for(auto r : res->children())
+        // Walk the data in file order
+        std::vector<WinResource*> sorted = collectResources(res, true);
+        for(auto r : sorted)
         {
-            if(!extractResource(&r, outpath, raw))
+            if(!extract_to_file(r, outpath, raw, imagesAsPng))
+            {
+                return false;
+            }
+        }
+    }
+    else if(res->isDirectory())
+    {
+        for(auto &r : res->children())
+        {
+            if(!extractResource(&r, outpath, raw, false, imagesAsPng))
             {
                 return false;
             }
@@ -326,53 +537,305 @@ bool WinLibrary::extractResource(WinResource* res, std::string outpath, bool raw
     }
     else
     {
-        size_t size;
-        bool free_it;
-        void *memory;
-        std::string outname;
-        FILE *out;
+        return extract_to_file(res, outpath, raw, imagesAsPng);
+    }
+    return true;
+
+}
+
+std::string WinLibrary::destination_name(WinResource *res, const std::string& outpath,
+                                         const std::string& suffix, const std::string& extension) const
+{
+    std::string str(basename(m_path.c_str()));
+
+    if(res->type() != "" && !res->type().empty())
+    {
+        str += std::string("_") + res->type();
+    }
+    if(res->name() != "" && !res->name().empty())
+        str += std::string("_") + res->name();
+    if(res->language() != "" && !res->language().empty())
+        str += std::string("_") + res->language();
+
+    str += suffix + extension;
+
+    return outpath + ((outpath.empty() || outpath == "") ? std::string("") : std::string("/")) + str;
+}
+
+bool WinLibrary::extract_to_file(WinResource *res, const std::string& outpath, bool raw, bool imagesAsPng)
+{
+#if WRES_IMAGE_CODECS
+    if(imagesAsPng && !raw && extract_png_to_file(res, outpath))
+    {
+        return true;
+    }
+#else
+    (void)imagesAsPng;
+#endif
+
+    size_t size;
+    bool free_it;
+    void *memory;
+    std::string outname;
+    FILE *out;
+
+    memory = extract(res, &size, &free_it, raw);
+    if (memory == NULL)
+    {
+        WRES_LOG_WARNING("%s: resource returned a null reference during extraction", m_path.c_str());
+        return false;
+    }
 
-        memory = extract(res, &size, &free_it, raw);
-        if (memory == NULL)
+    /* determine where to extract to */
+    outname = destination_name(res, outpath, "", res->getExtractExtension());
+    WRES_LOG_INFO("%s", outname.c_str());
+    if (outname.empty() || outname == "")
+    {
+        out = stdout;
+    }
+    else
+    {
+        out = fopen(outname.c_str(), "wb");
+        if (out == NULL)
         {
-            warn("[wres] Resource returned a null reference during extraction.\n");
+            WRES_LOG_ERROR("%s: %s", outname.c_str(), strerror(errno));
+
+            if (free_it)
+                 free(memory);
             return false;
         }
+    }
+
+    /* write the actual data */
+    fwrite(memory, size, 1, out);
+
+    if (free_it)
+        free(memory);
+    if (out != NULL && out != stdout)
+        fclose(out);
+
+    return true;
+}
+
+#if WRES_IMAGE_CODECS
+/* extract_png_to_file:
+ *   Write RT_BITMAP, RT_ICON and the images of RT_GROUP_ICON resources as
+ *   PNG files. Returns false for other resource types and for images that
+ *   could not be decoded, which are then extracted as they are.
+ */
+bool WinLibrary::extract_png_to_file(WinResource *res, const std::string& outpath)
+{
+    int32_t type;
+    const uint8_t *data = (const uint8_t*)res->offset();
+    if(data == nullptr || !parse_int32(res->type().c_str(), &type))
+        return false;
+
+    switch(type)
+    {
+        case RT_BITMAP:
+            return write_png_file(data, res->size(), false, destination_name(res, outpath, "", ".png"));
+        case RT_ICON:
+            return write_png_file(data, res->size(), true, destination_name(res, outpath, "", ".png"));
+        case RT_GROUP_ICON:
+            break;
+        default:
+            return false;
+    }
+
+    const Win32CursorIconDir *icondir = (const Win32CursorIconDir*)data;
+    if(res->size() < sizeof(Win32CursorIconDir) ||
+       res->size() < sizeof(Win32CursorIconDir) + icondir->count * sizeof(Win32CursorIconDirEntry))
+    {
+        WRES_LOG_WARNING("%s: group_icon resource is truncated", m_path.c_str());
+        return false;
+    }
 
-        /* determine where to extract to */
-        outname = get_destination_name();
-        printf("%s\n\n", outname.c_str());
-        if (outname.empty() || outname == "")
+    int written = 0;
+    for(int c = 0; c < icondir->count; c++)
+    {
+        std::string name = std::to_string(icondir->entries[c].res_id);
+        WinResource *icon = findResource(std::string("3"), name, res->language(), WinResource::Numeric);
+        if(icon == nullptr || icon->offset() == nullptr || icon->size() == 0)
         {
-            out = stdout;
+            WRES_LOG_WARNING("%s: could not find `%s' in `group_icon' resource, skipping", m_path.c_str(), name.c_str());
+            continue;
         }
-        else
-        {
-            out = fopen(outname.c_str(), "wb");
-            if (out == NULL)
-            {
-                warn_errno("%s", outname.c_str());
+        if(write_png_file((const uint8_t*)icon->offset(), icon->size(), true,
+                          destination_name(res, outpath, "_" + name, ".png")))
+            written++;
+    }
+    return written > 0;
+}
 
-                if (free_it)
-                     free(memory);
-                if (out != NULL && out != stdout)
-                     fclose(out);
-                return false;
-            }
-        }
+/* write_png_file:
+ *   Decode a DIB or icon image and stream it into outname as PNG. Icon
+ *   images that already are PNG are written unchanged.
+ */
+bool WinLibrary::write_png_file(const uint8_t *data, size_t size, bool iconImage, const std::string& outname)
+{
+    ImageInfo info;
+    if(!read_image_info(data, size, &info, iconImage))
+        return false;
+    // DIB headers can claim anything; refuse sizes no icon or bitmap resource has
+    if(info.width > 16384 || info.height > 16384 || !image_payload_fits(info, size))
+        return false;
 
-        /* write the actual data */
-        fwrite(memory, size, 1, out);
+    std::vector<uint8_t> pixels;
+    ImageBuffer image;
+    if(info.format != ContentType::PNG)
+    {
+        pixels.resize((size_t)info.width * info.height * 4);
+        image.pixels = pixels.data();
+        image.width = info.width;
+        image.height = info.height;
+        image.stride = (size_t)info.width * 4;
+        image.format = PixelFormat::RGBA;
+        image.premultiplied = false;
+        if(!(iconImage ? decode_icon_image(data, size, image) : decode_dib(data, size, image)))
+            return false;
+    }
 
-        if (free_it)
-            free(memory);
-        if (out != NULL && out != stdout)
-            fclose(out);
+    FILE *out = fopen(outname.c_str(), "wb");
+    if(out == NULL)
+    {
+        WRES_LOG_ERROR("%s: %s", outname.c_str(), strerror(errno));
+        return false;
+    }
+    WRES_LOG_INFO("%s", outname.c_str());
 
+    bool ok;
+    if(info.format == ContentType::PNG)
+        ok = fwrite(data, size, 1, out) == 1;
+    else
+        ok = encode_png(image, [out](const uint8_t *p, size_t n) { return fwrite(p, 1, n, out) == n; });
+    fclose(out);
+    if(!ok)
+        WRES_LOG_ERROR("%s: could not write the PNG image", outname.c_str());
+    return ok;
+}
+#endif
+
+IconMatcher::IconMatcher(int desiredSize, int dpi, int bitDepth)
+    : m_target(dpi > 0 ? (desiredSize * dpi + 48) / 96 : desiredSize), m_bitDepth(bitDepth)
+{
+}
+
+void IconMatcher::offer(int index, uint8_t width, uint8_t height, uint8_t colorCount, int bits)
+{
+    // a width or height of 0 means 256
+    int w = width ? width : 256;
+    int h = height ? height : 256;
+    if(bits == 0 && colorCount != 0)
+        bits = colorCount <= 2 ? 1 : colorCount <= 16 ? 4 : 8;
+
+    int sizeDiff = abs(w - m_target) + abs(h - m_target);
+    int colorDiff = abs(m_bitDepth - bits);
+    if(sizeDiff < m_bestSizeDiff ||
+       (sizeDiff == m_bestSizeDiff && (w > m_bestWidth || (w == m_bestWidth && colorDiff < m_bestColorDiff))))
+    {
+        m_best = index;
+        m_bestBits = bits;
+        m_bestSizeDiff = sizeDiff;
+        m_bestWidth = w;
+        m_bestColorDiff = colorDiff;
     }
-    return true;
+}
+
+IconView WinLibrary::selectIcon(const WinResource *group, int desiredSize, int dpi, int bitDepth) const
+{
+    IconView view;
+    if(group != nullptr && group->isDirectory())
+        group = group->children().empty() ? nullptr : &group->children()[0];
+    if(group == nullptr || group->offset() == nullptr || group->size() < sizeof(Win32CursorIconDir) ||
+       desiredSize <= 0)
+        return view;
+
+    const Win32CursorIconDir *icondir = (const Win32CursorIconDir*)group->offset();
+    size_t count = std::min<size_t>(icondir->count,
+                                    (group->size() - sizeof(Win32CursorIconDir)) / sizeof(Win32CursorIconDirEntry));
+    IconMatcher matcher(desiredSize, dpi, bitDepth);
+    for(size_t i = 0; i < count; i++)
+    {
+        const Win32CursorIconDirEntry &entry = icondir->entries[i];
+        matcher.offer((int)i, entry.res_info.icon.width, entry.res_info.icon.height,
+                      entry.res_info.icon.color_count, entry.bit_count);
+    }
+    int best = matcher.best();
+    if(best < 0)
+        return view;
+
+    std::string name = std::to_string(icondir->entries[best].res_id);
+    const WinResource *icon = findResource(std::string("3"), name, group->language(), WinResource::Numeric);
+    if(icon == nullptr)
+    {
+        // the icon may only exist in another language than the group
+        icon = findResource(std::string("3"), name, std::string(""), WinResource::Numeric);
+        if(icon != nullptr && icon->isDirectory())
+            icon = icon->children().empty() ? nullptr : &icon->children()[0];
+    }
+    if(icon == nullptr || icon->isDirectory() || icon->offset() == nullptr)
+    {
+        WRES_LOG_WARNING("%s: could not find `%s' in `group_icon' resource", m_path.c_str(), name.c_str());
+        return view;
+    }
+
+    ImageInfo info;
+    if(!read_image_info((const uint8_t*)icon->offset(), icon->size(), &info, true))
+        return view;
+    view.resource = icon;
+    view.data = (const uint8_t*)icon->offset();
+    view.size = icon->size();
+    view.format = info.format;
+    view.width = info.width;
+    view.height = info.height;
+    view.bitCount = (uint16_t)matcher.bestBits();
+    return view;
+}
 
+/* Shared by the const and non-const collectResources() */
+template<class Resource>
+static std::vector<Resource*> collect_resources(Resource *res, bool offsetOrder)
+{
+    std::vector<Resource*> result;
+    if(res == nullptr)
+        return result;
+
+    std::vector<Resource*> pending = { res };
+    while(!pending.empty())
+    {
+        Resource *r = pending.back();
+        pending.pop_back();
+        if(!r->isDirectory())
+        {
+            if(r->offset() != nullptr)
+                result.push_back(r);
+            continue;
+        }
+        // Push in reverse so that children are visited in tree order
+        for(auto it = r->children().rbegin(); it != r->children().rend(); ++it)
+            pending.push_back(&(*it));
+    }
+
+    if(offsetOrder)
+    {
+        std::stable_sort(result.begin(), result.end(), [](const WinResource *a, const WinResource *b)
+        {
+            return a->offset() < b->offset();
+        });
+    }
+    return result;
+}
+
+std::vector<WinResource*> WinLibrary::collectResources(WinResource *res, bool offsetOrder)
+{
+    return collect_resources(res, offsetOrder);
+}
+
+std::vector<const WinResource*> WinLibrary::collectResources(const WinResource *res, bool offsetOrder) const
+{
+    return collect_resources(res, offsetOrder);
 }
+
 std::vector<WinResource> WinLibrary::list_resources(WinResource &res)
 {
     if (!res.isDirectory())
@@ -384,7 +847,7 @@ std::vector<WinResource> WinLibrary::list_resources(WinResource &res)
     }
     else
     {
-        return {};
+        return list_ne_resources(res);
     }
 }
 
@@ -458,21 +921,29 @@ void* WinLibrary::extract_group_icon_cursor_resource(WinResource *res, size_t *r
     }
 
     /* calculate total size of output file */
-    CHECK_IF_BAD_POINTER(nullptr, icondir->count);
+    if (!in_bounds(&icondir->count, sizeof(icondir->count)))
+    {
+        WRES_LOG_WARNING("%s: group resource is truncated", m_path.c_str());
+        return nullptr;
+    }
     skipped = 0;
     for (int c = 0; c < icondir->count; c++)
     {
         size_t iconsize;
         char name[14];
 
-        CHECK_IF_BAD_POINTER(nullptr, icondir->entries[c]);
+        if (!in_bounds(&icondir->entries[c], sizeof(icondir->entries[c])))
+        {
+            WRES_LOG_WARNING("%s: group resource is truncated", m_path.c_str());
+            return nullptr;
+        }
 
         /* find the corresponding icon resource */
         snprintf(name, sizeof(name)/sizeof(char), "%d", icondir->entries[c].res_id);
         WinResource *fwr = this->findResource((is_icon ? std::string("3") : std::string("1")), std::string(name), res->language(), WinResource::Numeric);
         if (fwr == nullptr)
         {
-            warn("[wres] %s: could not find `%s' in `%s' resource.", m_path, name, (is_icon ? "group_icon" : "group_cursor"));
+            WRES_LOG_WARNING("%s: could not find `%s' in `%s' resource", m_path.c_str(), name, (is_icon ? "group_icon" : "group_cursor"));
             return nullptr;
         }
 
@@ -480,13 +951,14 @@ void* WinLibrary::extract_group_icon_cursor_resource(WinResource *res, size_t *r
         {
             if (fwr->size() == 0)
             {
-                warn("[wres] %s: icon resource `%s' is empty, skipping", m_path, name);
+                WRES_LOG_WARNING("%s: icon resource `%s' is empty, skipping", m_path.c_str(), name);
                 skipped++;
                 continue;
             }
             if (fwr->size() != icondir->entries[c].bytes_in_res)
             {
-                warn("[wres] %s: mismatch of size in icon resource `%s' and group (%d vs %d)", m_path, name, fwr->size(), icondir->entries[c].bytes_in_res);
+                WRES_LOG_DEBUG("%s: mismatch of size in icon resource `%s' and group (%zu vs %" PRIu32 ")", m_path.c_str(), name,
+                               fwr->size(), (uint32_t)icondir->entries[c].bytes_in_res);
             }
             size += fwr->size() < icondir->entries[c].bytes_in_res ? icondir->entries[c].bytes_in_res : fwr->size();
 
@@ -521,7 +993,7 @@ void* WinLibrary::extract_group_icon_cursor_resource(WinResource *res, size_t *r
         WinResource *fwr = this->findResource((is_icon ? std::string("3") : std::string("1")), std::string(name), res->language(), WinResource::Numeric);
         if (fwr == nullptr)
         {
-            warn("[warn] %s: could not find `%s' in `%s' resource.", m_path, name, (is_icon ? "group_icon" : "group_cursor"));
+            WRES_LOG_WARNING("%s: could not find `%s' in `%s' resource", m_path.c_str(), name, (is_icon ? "group_icon" : "group_cursor"));
             return nullptr;
         }
 
@@ -667,15 +1139,16 @@ void* WinLibrary::extract_bitmap_resource(WinResource *res, size_t *ressize)
 
 /* calc_vma_size:
  *   Calculate the total amount of memory needed for a 32-bit Windows
- *   module. Returns -1 if file was too small.
+ *   module. Returns 0 if file was too small.
  */
-int WinLibrary::calc_vma_size()
+uint64_t WinLibrary::calc_vma_size()
 {
     Win32ImageSectionHeader *seg;
-    size_t c, segcount, size;
+    size_t c, segcount;
+    uint64_t size;
 
     size = 0;
-    CHECK_IF_BAD_POINTER(-1, PE_HEADER(m_data)->file_header.number_of_sections);
+    CHECK_IF_BAD_POINTER(0, PE_HEADER(m_data)->file_header.number_of_sections);
     segcount = PE_HEADER(m_data)->file_header.number_of_sections;
 
     /* If there are no segments, just process file like it is.
@@ -685,17 +1158,15 @@ int WinLibrary::calc_vma_size()
     if (segcount == 0)
         return m_length;
 
-    CHECK_IF_BAD_PE_SECTIONS(-1, m_data);
+    CHECK_IF_BAD_PE_SECTIONS(0, m_data);
     seg = PE_SECTIONS(m_data);
-    CHECK_IF_BAD_POINTER(-1, *seg);
 
     for (c = 0; c < segcount; c++)
     {
-        CHECK_IF_BAD_POINTER(0, *seg);
-
-        size = std::max(size, static_cast<size_t>(seg->virtual_address + seg->size_of_raw_data));
+        /* the sum of two 32-bit fields may not fit in 32 bits */
+        size = std::max(size, (uint64_t)seg->virtual_address + seg->size_of_raw_data);
         /* I have no idea what misc.virtual_size is for... */
-        size = std::max(size, static_cast<size_t>(seg->virtual_address + seg->misc.virtual_size));
+        size = std::max(size, (uint64_t)seg->virtual_address + seg->misc.virtual_size);
         seg++;
     }
 
@@ -742,7 +1213,7 @@ bool WinLibrary::read_library()
         CHECK_IF_BAD_POINTER(false, mz_header->lfanew);
         if (mz_header->lfanew < sizeof (DOSImageHeader))
         {
-            warn("[wres] %s: not a PE library", m_path.c_str());
+            fail(ParseError::BadHeader, &mz_header->lfanew, "DOS header");
             return false;
         }
 
@@ -761,7 +1232,7 @@ bool WinLibrary::read_library()
         CHECK_IF_BAD_POINTER(false, header->restab);
         if (header->rsrctab >= header->restab)
         {
-            warn("[wres] %s: no resource directory found", m_path.c_str());
+            fail(ParseError::NoResources, &header->rsrctab, "NE header");
             return false;
         }
 
@@ -769,8 +1240,21 @@ bool WinLibrary::read_library()
         alignshift = (uint16_t*)((uint8_t*)NE_HEADER(m_data) + header->rsrctab);
         m_firstResource = ((uint8_t*)alignshift) + sizeof(uint16_t);
         CHECK_IF_BAD_POINTER(false, *(Win16NETypeInfo*)m_firstResource);
+        /* every resource offset and length is shifted by it */
+        if (*alignshift > NE_MAX_ALIGN_SHIFT)
+        {
+            fail(ParseError::Malformed, m_firstResource - 2, "NE alignment shift");
+            return false;
+        }
 
-        return false;
+        /* the first entry of the resident name table is the module name */
+        uint8_t *restab = (uint8_t*)NE_HEADER(m_data) + header->restab;
+        if (in_bounds(restab, 1) && in_bounds(restab + 1, restab[0]))
+        {
+            m_moduleName = std::string((const char*)restab + 1, restab[0]);
+        }
+
+        return true;
     }
 
     /* check for NT header signature `PE' */
@@ -783,13 +1267,29 @@ bool WinLibrary::read_library()
         int d;
 
         /* allocate new memory */
-        m_length = this->calc_vma_size();
-        if (m_length <= 0)
+        uint64_t vma_size = this->calc_vma_size();
+        if (vma_size == 0)
         {
             /* calc_vma_size has reported error */
             return false;
         }
-        m_data = (char*)realloc(m_data, m_length);
+        /* the section sizes come from the file, don't trust them */
+        if (vma_size > m_limits.maxAllocation || vma_size > INT_MAX)
+        {
+            fail(ParseError::LimitExceeded, PE_SECTIONS(m_data), "maxAllocation");
+            return false;
+        }
+        char *image = (char*)realloc(m_data, vma_size);
+        if (image == nullptr)
+        {
+            fail(ParseError::LimitExceeded, PE_SECTIONS(m_data), "maxAllocation");
+            return false;
+        }
+        /* space past the end of the file is read as zeros, not as stale heap memory */
+        if (vma_size > (uint64_t)m_length)
+            memset(image + m_length, 0, vma_size - m_length);
+        m_data = image;
+        m_length = (int)vma_size;
 
         /* relocate memory, start from last section */
         pe_header = PE_HEADER(m_data);
@@ -811,7 +1311,7 @@ bool WinLibrary::read_library()
             if ((uint8_t*)(m_data + pe_sec->virtual_address)
                 < (uint8_t*)(pe_sections + pe_header->file_header.number_of_sections))
             {
-                warn("[wres] %s: invalid sections layout", m_path.c_str());
+                fail(ParseError::BadSections, pe_sec, "section table");
                 return false;
             }
 
@@ -827,10 +1327,14 @@ bool WinLibrary::read_library()
 
         /* find resource directory */
         dir = this->get_data_directory_entry(IMAGE_DIRECTORY_ENTRY_RESOURCE);
-        if (dir == NULL) return false;
+        if (dir == NULL)
+        {
+            fail(ParseError::BadHeader, &pe_header->optional_header, "optional header");
+            return false;
+        }
         if (dir->size == 0)
         {
-            warn("[wres] %s: file contains no resources", m_path.c_str());
+            fail(ParseError::NoResources, dir, "resource data directory");
             return false;
         }
 
@@ -840,7 +1344,7 @@ bool WinLibrary::read_library()
     }
 
     /* other (unknown) header signature was found */
-    warn("[wres] %s: not a PE or NE library", m_path.c_str());
+    fail(ParseError::BadHeader, PE_HEADER(m_data), "signature");
     return false;
 }
 
@@ -876,6 +1380,10 @@ bool WinLibrary::isPEBinary() const
 {
     return m_isPEBinary;
 }
+std::string WinLibrary::moduleName() const
+{
+    return m_moduleName;
+}
 uint8_t* WinLibrary::firstResource() const
 {
     return m_firstResource;
@@ -884,5 +1392,9 @@ WinResource& WinLibrary::root()
 {
     return m_root;
 }
+const WinResource& WinLibrary::root() const
+{
+    return m_root;
+}
 
 }
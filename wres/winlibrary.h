@@ -1,19 +1,75 @@
 #ifndef WINLIBRARY_H
 #define WINLIBRARY_H
 #include <string>
+#include <unordered_set>
+#include <vector>
 #include <stdint.h>
+#include <limits.h>
 #include "io-utils.h"
 #include "intutil.h"
 #include "error.h"
 #include "win32.h"
 #include "win32-endian.h"
 #include "wresutil.h"
+#include "parsestatus.h"
 
 #include "winresource.h"
 
 namespace wres
 {
 
+/*
+ * IconView points at the data of a single RT_ICON image inside the
+ * library's memory, as returned by WinLibrary::selectIcon(). Nothing is
+ * copied, so the view is only valid as long as the WinLibrary is. format
+ * is ContentType::PNG or ContentType::DIB; width and height are those of
+ * the image itself, bitCount is taken from the group entry.
+ */
+struct IconView
+{
+    const WinResource* resource = nullptr;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    ContentType format = ContentType::Unknown;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint16_t bitCount = 0;
+    /* hotspot of cursor images, 0 for icons */
+    uint16_t hotspotX = 0;
+    uint16_t hotspotY = 0;
+
+    bool isValid() const { return data != nullptr; }
+};
+
+/*
+ * IconMatcher holds the scoring that WinLibrary::selectIcon() applies to
+ * the images of an icon directory, so that other directories (e.g. the
+ * .ico frames of animated cursors) pick images the same way. Each image is
+ * passed to offer(); best() is then the index of the winner, or -1.
+ */
+class IconMatcher
+{
+public:
+    IconMatcher(int desiredSize, int dpi, int bitDepth);
+    /*
+     * width and height are the directory values (0 means 256). If bits is
+     * 0 it is derived from colorCount.
+     */
+    void offer(int index, uint8_t width, uint8_t height, uint8_t colorCount, int bits);
+
+    int best() const { return m_best; }
+    int bestBits() const { return m_bestBits; }
+
+private:
+    int m_target;
+    int m_bitDepth;
+    int m_best = -1;
+    int m_bestBits = 0;
+    int m_bestSizeDiff = INT_MAX;
+    int m_bestWidth = 0;
+    int m_bestColorDiff = INT_MAX;
+};
+
 class WinLibrary
 {
 public:
@@ -28,8 +84,18 @@ public:
      * method will return the tree structure that's constructed on initialization
      * of the WinLibrary instance.
      *
+     * Once constructed, a library is not modified by any const method, and
+     * the const methods (along with the const methods of the resources of
+     * its tree) may be called from any number of threads at once without
+     * locking. The values that resources compute lazily are published
+     * atomically. Only buildResourceTree() and the non-const accessors,
+     * which hand out mutable resources, must not run concurrently with
+     * anything else on the same library.
+     *
+     * limits bounds the memory and work spent on the file; the defaults
+     * are far above what real libraries need.
      */
-    WinLibrary(std::string p);
+    WinLibrary(std::string p, const ParseLimits& limits = ParseLimits());
     ~WinLibrary();
     /*
      * Returns the path of the file being loaded into memory.
@@ -47,6 +113,11 @@ public:
      * Returns true if the file is a PE executable, returns false otherwise.
      */
     bool isPEBinary() const;
+    /*
+     * Returns the module name of an NE (Win16) file, the first entry of its
+     * resident name table. Empty for PE files.
+     */
+    std::string moduleName() const;
     /*
      * Returns true if the file is valid. If the value is false, it can mean one
      * of the following:
@@ -56,6 +127,14 @@ public:
      *  - The file format is invalid and does not represent a PE executable
      */
     bool isValid() const;
+    /*
+     * Returns the first problem found while opening the file and building
+     * the resource tree. A library can be valid with a failed status, in
+     * which case the parts of the tree that could not be read are missing.
+     * format_parse_status() turns it into a message.
+     */
+    const ParseStatus& status() const { return m_status; }
+    const ParseLimits& limits() const { return m_limits; }
     /*
      * Returns true if the file has been successfully read and loaded into memory.
      */
@@ -69,6 +148,7 @@ public:
      * Returns the root of the resource tree structure.
      */
     WinResource& root();
+    const WinResource& root() const;
     /*
      * Extracts the contents of the resource onto the filesystem. Outpath
      * is defined as the output directory. The raw parameter can be used
@@ -78,53 +158,136 @@ public:
      * If the provided resource is a directory, this method will recursively
      * extract everything from that directory. Passing the root resource thus
      * extracts all the resources.
+     *
+     * When offsetOrder is set, the data resources below a directory are
+     * extracted in the order they appear in the file instead of the
+     * type -> name -> language order of the tree. This only changes the
+     * order: the whole file is read into memory when the library is opened,
+     * so there is no file I/O left for the order to make sequential.
+     *
+     * When imagesAsPng is set and the library is built with the image
+     * codecs, RT_BITMAP and RT_ICON resources are decoded and written as
+     * .png files, and RT_GROUP_ICON resources as one .png per icon image
+     * (named after the RT_ICON id) instead of an .ico file. The PNG data is
+     * streamed into the file while it is encoded. Resources that cannot be
+     * decoded are extracted as usual.
+     */
+    bool extractResource(WinResource* res, std::string outpath, bool raw = false, bool offsetOrder = false,
+                         bool imagesAsPng = false);
+
+    /*
+     * Returns every data (non-directory) resource found below res, or res
+     * itself if it is not a directory. By default the resources are in tree
+     * order; if offsetOrder is set, they are sorted by their data offset.
+     */
+    std::vector<WinResource*> collectResources(WinResource *res, bool offsetOrder = false);
+    std::vector<const WinResource*> collectResources(const WinResource *res, bool offsetOrder = false) const;
+
+    /*
+     * Picks the image of an RT_GROUP_ICON resource that best fits an icon of
+     * desiredSize x desiredSize logical pixels at the given dpi and color
+     * depth, and returns a view of its RT_ICON data. Only the group
+     * directory and the header of the chosen image are read.
+     *
+     * As with LookupIconIdFromDirectoryEx(), the image with the smallest
+     * size difference wins, then the closest bit depth. When a smaller and
+     * a larger image are equally far off, the larger one is taken since
+     * scaling down looks better. group may also be the name directory of
+     * the group, in which case its first language is used. Returns an
+     * invalid view if the group is malformed or the image is missing.
      */
-    bool extractResource(WinResource* res, std::string outpath, bool raw = false);
+    IconView selectIcon(const WinResource *group, int desiredSize, int dpi = 96, int bitDepth = 32) const;
 
     /*
      * Builds the resource tree structure which can be traversed by accessing
      * the root of the tree, its children, and so on. Alternatively, resources
      * can be searched for by using the find_resource method. This method is
      * called by the constructor.
+     *
+     * The walk is bounded by the library's limits, and a directory that is
+     * reached a second time (a loop, or one shared by several parents) is
+     * not descended into again.
      */
     bool buildResourceTree(WinResource *res);
 
-    static bool compareResourceId(const WinResource& res, std::string id, WinResource::id_type idType);
+    static bool compareResourceId(const WinResource& res, const std::string& id, WinResource::id_type idType);
 
     /*
      * Searches the tree structure and returns a pointer to the resource if found.
      * This returns a pointer to a single resource, which can be a directory.
      * Returns nullptr if the resource couldn't be found.
      */
-    WinResource *findResource(std::string type, std::string name, std::string language,
-                                     WinResource::id_type tType = WinResource::Any,
-                                     WinResource::id_type nType = WinResource::Any,
-                                     WinResource::id_type lType = WinResource::Any);
+    WinResource *findResource(const std::string& type, const std::string& name, const std::string& language,
+                              WinResource::id_type tType = WinResource::Any,
+                              WinResource::id_type nType = WinResource::Any,
+                              WinResource::id_type lType = WinResource::Any);
+    const WinResource *findResource(const std::string& type, const std::string& name, const std::string& language,
+                                    WinResource::id_type tType = WinResource::Any,
+                                    WinResource::id_type nType = WinResource::Any,
+                                    WinResource::id_type lType = WinResource::Any) const;
 
     void printResourceTree();
 
 private:
     std::string m_path;
     char* m_data = nullptr;
-    int m_length;
+    int m_length = -1;
     bool m_isPEBinary = false;
     bool m_isValid = false;
     uint8_t* m_firstResource = nullptr;
+    std::string m_moduleName;
+    ParseStatus m_status;
+    ParseLimits m_limits;
     WinResource m_root;
-    FILE* m_fi;
+    FILE* m_fi = nullptr;
+
+    /* Returns true if [p, p + size) lies within the data */
+    bool in_bounds(const void *p, size_t size) const
+    {
+        uintptr_t offset = (uintptr_t)p - (uintptr_t)m_data;
+        return m_length > 0 && (uintptr_t)p >= (uintptr_t)m_data && offset < (size_t)m_length && size <= (size_t)m_length - offset;
+    }
+    /* Records the first problem found in the status */
+    void fail(ParseError code, const void *at, const char *context);
+
+    /* Work done so far by one buildResourceTree() call */
+    struct TreeBudget
+    {
+        size_t nodes = 0;
+        uint64_t declaredBytes = 0;
+        /* directory locations and levels, see visit_key() */
+        std::unordered_set<uintptr_t> visited;
+
+        /* NE type directories start where the root does, so the level is part of the key */
+        static uintptr_t visit_key(const WinResource& dir)
+        {
+            return ((uintptr_t)dir.location() << 2) | (uintptr_t)(dir.level() + 1);
+        }
+    };
+    bool build_tree(WinResource *res, TreeBudget& budget);
 
     // mostly retained functions from wrestool
-    int calc_vma_size();
+    uint64_t calc_vma_size();
     bool read_library();
     Win32ImageDataDirectory* get_data_directory_entry(unsigned int entry);
     std::vector<WinResource> list_resources(WinResource &res);
     std::vector<WinResource> list_pe_resources(WinResource &res);
+    std::vector<WinResource> list_ne_resources(WinResource &res);
     void* set_resource_entry(WinResource *wr);
     bool decode_pe_resource_id(WinResource *wr, uint32_t value);
+    bool decode_ne_resource_id(WinResource *wr, uint16_t value);
 
     void* extract(WinResource *wr, size_t *size,
                   bool *free_it, bool raw);
 
+    bool extract_to_file(WinResource *res, const std::string& outpath, bool raw, bool imagesAsPng);
+    std::string destination_name(WinResource *res, const std::string& outpath,
+                                 const std::string& suffix, const std::string& extension) const;
+#if WRES_IMAGE_CODECS
+    bool extract_png_to_file(WinResource *res, const std::string& outpath);
+    bool write_png_file(const uint8_t *data, size_t size, bool iconImage, const std::string& outname);
+#endif
+
     void* extract_group_icon_cursor_resource(WinResource *res, size_t *ressize, bool is_icon);
     void* extract_bitmap_resource(WinResource *res, size_t *ressize);
 
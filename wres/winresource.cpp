@@ -2,18 +2,22 @@
 #include "macros.h"
 #include "wresutil.h"
 #include "intutil.h"
+#include "log.h"
 #include <stdexcept>
 
 namespace wres
 {
 
+/* Value of m_contentType before the content is classified */
+#define CONTENT_UNCLASSIFIED 0xFF
+
 WinResource::WinResource() {}
 
 bool WinResource::setId(std::string i, id_type t)
 {
     if(i.size() > WINRES_ID_MAXLEN)
     {
-        printf("[wres] Can't set resource ID longer than %d characters!\n", WINRES_ID_MAXLEN);
+        WRES_LOG_WARNING("cannot set a resource id longer than %d characters", WINRES_ID_MAXLEN);
         return false;
     }
     m_id = i;
@@ -24,6 +28,7 @@ bool WinResource::setId(std::string i, id_type t)
 void WinResource::setType(std::string t)
 {
     m_type = t;
+    m_extractExtension = nullptr;
 }
 void WinResource::setLanguage(std::string lang)
 {
@@ -37,7 +42,7 @@ bool WinResource::setLevel(int l)
 {
     if(l >= 3)
     {
-        printf("[wres] Level provided (%d) is higher than the maximum allowed value of 2.\n", l);
+        WRES_LOG_WARNING("level %d is higher than the maximum allowed value of 2", l);
         return false;
     }
     m_level = l;
@@ -46,6 +51,8 @@ bool WinResource::setLevel(int l)
 void WinResource::setIsDirectory(bool isDir)
 {
     m_isDirectory = isDir;
+    m_contentType = CONTENT_UNCLASSIFIED;
+    m_extractExtension = nullptr;
 }
 void WinResource::setParent(WinResource *res)
 {
@@ -58,8 +65,10 @@ void WinResource::setLocation(uint8_t* loc)
 void WinResource::setSize(size_t s)
 {
     m_size = s;
+    m_contentType = CONTENT_UNCLASSIFIED;
+    m_extractExtension = nullptr;
 }
-std::string WinResource::id() const
+const std::string& WinResource::id() const
 {
     return m_id;
 }
@@ -67,15 +76,15 @@ WinResource::id_type WinResource::idType() const
 {
     return m_idType;
 }
-std::string WinResource::type() const
+const std::string& WinResource::type() const
 {
     return m_type;
 }
-std::string WinResource::language() const
+const std::string& WinResource::language() const
 {
     return m_language;
 }
-std::string WinResource::name() const
+const std::string& WinResource::name() const
 {
     return m_name;
 }
@@ -114,37 +123,42 @@ std::string WinResource::typeAsString() const
 std::string WinResource::getExtractExtension() const
 {
     if(m_type.empty() || m_type == "") return "";
+    const char *extension = m_extractExtension.load(std::memory_order_acquire);
+    if(extension != nullptr) return extension;
+
     uint16_t value;
     auto type_c = res_type_string_to_id(m_type.c_str());
+    extension = "";
     if (parse_uint16(type_c, &value))
     {
-        if (value == 2)
-            return ".bmp";
-        if (value == 14)
-            return ".ico";
-        if (value == 12)
-            return ".cur";
+        if (value == RT_BITMAP)
+            extension = ".bmp";
+        else if (value == RT_GROUP_ICON)
+            extension = ".ico";
+        else if (value == RT_GROUP_CURSOR)
+            extension = ".cur";
     }
 
-    // Try recognizing if the resource is a PNG image
-    if(m_size > 8 && m_offset != nullptr)
-    {
-        if(memcmp((uint8_t*)m_offset, png_signature, 8) == 0)
-        {
-            return ".png";
-        }
-    }
-    // Try recognizing if the resource is a JPG image
-    if(m_size > 3 && m_offset != nullptr)
+    // Otherwise, recognize the resource by its contents
+    if(*extension == '\0')
+        extension = content_type_extension(contentType());
+
+    m_extractExtension.store(extension, std::memory_order_release);
+    return extension;
+}
+
+ContentType WinResource::contentType() const
+{
+    uint8_t type = m_contentType.load(std::memory_order_relaxed);
+    if(type == CONTENT_UNCLASSIFIED)
     {
-        if(memcmp((uint8_t*)m_offset, jpg_signature, 3) == 0)
-        {
-            return ".jpg";
-        }
+        ContentType detected = ContentType::Unknown;
+        if(!m_isDirectory && m_offset != nullptr)
+            detected = classify_content((const uint8_t*)m_offset, m_size);
+        type = (uint8_t)detected;
+        m_contentType.store(type, std::memory_order_relaxed);
     }
-
-    // Otherwise, return no extension
-    return "";
+    return (ContentType)type;
 }
 
 
@@ -177,6 +191,10 @@ std::vector<WinResource>& WinResource::children()
 {
     return m_children;
 }
+const std::vector<WinResource>& WinResource::children() const
+{
+    return m_children;
+}
 void WinResource::setChildren(std::vector<WinResource> res)
 {
     m_children = res;
@@ -188,6 +206,8 @@ void WinResource::addChild(WinResource res)
 void WinResource::setOffset(char* o)
 {
     m_offset = o;
+    m_contentType = CONTENT_UNCLASSIFIED;
+    m_extractExtension = nullptr;
 }
 
 
@@ -1,13 +1,33 @@
 #ifndef WINRESOURCE_H
 #define WINRESOURCE_H
+#include <atomic>
 #include <string>
 #include <stdint.h>
 #include <vector>
 #include "wresutil.h"
+#include "contenttype.h"
 
 namespace wres
 {
 
+/*
+ * An atomic member that is copied along with the node holding it, for the
+ * lazily computed values of WinResource.
+ */
+template<class T>
+class CopyableAtomic : public std::atomic<T>
+{
+public:
+    CopyableAtomic(T value) : std::atomic<T>(value) {}
+    CopyableAtomic(const CopyableAtomic& other) : std::atomic<T>(other.load(std::memory_order_relaxed)) {}
+    CopyableAtomic& operator=(const CopyableAtomic& other)
+    {
+        this->store(other.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+    using std::atomic<T>::operator=;
+};
+
 class WinResource
 {
 public:
@@ -28,7 +48,7 @@ public:
     /*
      * Returns the ID and ID type of the resource.
      */
-    std::string id() const;
+    const std::string& id() const;
     id_type idType() const;
     /*
      * Resources have three main attributes:
@@ -48,9 +68,9 @@ public:
      * its own ID), while other values are inherited
      * from its parent(s).
      */
-    std::string type() const;
-    std::string name() const;
-    std::string language() const;
+    const std::string& type() const;
+    const std::string& name() const;
+    const std::string& language() const;
     /*
      * Returns the resource type in its human readable
      * string representation, if possible. Otherwise
@@ -82,6 +102,7 @@ public:
      * the resource item is not a directory.
      */
     std::vector<WinResource>& children();
+    const std::vector<WinResource>& children() const;
     /*
      * Returns the location (first byte) of the resource
      * in the PE file's memory representation. Usually not
@@ -118,7 +139,18 @@ public:
     void setSize(size_t s);
     void setChildren(std::vector<WinResource> res);
 
+    /*
+     * Returns the extension (including the dot) that should be used
+     * when the resource is extracted to a file. The value is computed
+     * once from the resource type and content, then cached.
+     */
     std::string getExtractExtension() const;
+    /*
+     * Returns the kind of data held by the resource, as detected from
+     * its first bytes. Directories are always ContentType::Unknown.
+     * The result is cached in the node after the first call.
+     */
+    ContentType contentType() const;
 
 private:
     std::string m_id = "";
@@ -133,6 +165,10 @@ private:
     size_t m_size = 0;
     std::vector<WinResource> m_children;
     char* m_offset = nullptr;
+
+    /* 0xFF (CONTENT_UNCLASSIFIED) until contentType() ran */
+    mutable CopyableAtomic<uint8_t> m_contentType { 0xFF };
+    mutable CopyableAtomic<const char*> m_extractExtension { nullptr };
 };
 
 }
@@ -21,6 +21,7 @@
 #include "intutil.h"
 #include "error.h"
 #include "wresutil.h"
+#include "log.h"
 
 namespace wres
 {
@@ -42,7 +43,7 @@ bool check_offset(const char *memory, size_t total_size,
 	if (((memory > memory_end) || (block > block_end))
 		|| (block < memory) || (block >= memory_end) || (block_end > memory_end))
     {
-		warn("[wres] %s: premature end", name);
+		WRES_LOG_WARNING("%s: premature end", name);
 		return false;
 	}
 
@@ -82,5 +83,48 @@ const char *res_type_string_to_id (const char *type)
     return type;
 }
 
+/* append_utf16le_as_utf8:
+ *   Convert UTF-16LE text as found in resources to UTF-8. The text is
+ *   read byte-wise, so it does not need to be aligned.
+ */
+void append_utf16le_as_utf8(std::string &out, const uint8_t *text, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t c = read_le16(text + i * 2);
+		if (c < 0x80)
+		{
+			out += (char)c;
+			continue;
+		}
+		if (c >= 0xD800 && c <= 0xDFFF)
+		{
+			uint32_t low = i + 1 < count ? read_le16(text + (i + 1) * 2) : 0;
+			if (c <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF)
+			{
+				c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+				i++;
+			}
+			else
+				c = 0xFFFD;
+		}
+		if (c < 0x800)
+		{
+			out += (char)(0xC0 | (c >> 6));
+		}
+		else if (c < 0x10000)
+		{
+			out += (char)(0xE0 | (c >> 12));
+			out += (char)(0x80 | ((c >> 6) & 0x3F));
+		}
+		else
+		{
+			out += (char)(0xF0 | (c >> 18));
+			out += (char)(0x80 | ((c >> 12) & 0x3F));
+			out += (char)(0x80 | ((c >> 6) & 0x3F));
+		}
+		out += (char)(0x80 | (c & 0x3F));
+	}
 }
 
+}
@@ -28,6 +28,8 @@
 #include <string.h>
 #include <errno.h>
 #include <getopt.h>
+#include <string>
+#include <string_view>
 #include "win32.h"
 #include "common.h"
 #include "macros.h"
@@ -65,6 +67,34 @@ const char *res_type_string_to_id (const char*);
 static const uint8_t png_signature[] = { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A };
 static const uint8_t jpg_signature[] = { 0xFF, 0xD8, 0xFF };
 
+// Unaligned reads of little and big endian values from resource data
+static inline uint16_t read_le16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+static inline uint32_t read_le32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static inline uint32_t read_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+// A view of count UTF-16LE code units at p. char16_t must be 2-byte aligned,
+// so the view is empty if p is odd; well-formed resources never store text
+// at an odd address, only malformed ones (an odd data offset or length) do.
+static inline std::u16string_view utf16_view(const uint8_t *p, size_t count)
+{
+	if (((uintptr_t)p & 1) != 0)
+		return std::u16string_view();
+	return std::u16string_view((const char16_t*)p, count);
+}
+
+// Appends count UTF-16LE code units starting at text to out as UTF-8.
+// Unpaired surrogates become U+FFFD.
+void append_utf16le_as_utf8(std::string &out, const uint8_t *text, size_t count);
+
 }
 
 #endif